@@ -0,0 +1,72 @@
+﻿using System.Runtime.CompilerServices;
+using System.Text;
+
+namespace ManagedApp
+{
+    /// <summary>
+    /// Reads the arguments packed by the native NetHost::ArgPack (see arg_pack.h) in place, for methods with the default
+    /// signature: `static int Method(IntPtr args, int sizeBytes)`. The values are read in the same order they were
+    /// added, and nothing is copied or allocated unless a string is requested.
+    /// </summary>
+    public unsafe ref struct ArgReader
+    {
+        private readonly byte* _args;
+        private readonly int _sizeBytes;
+        private int _offset;
+
+        public ArgReader(IntPtr args, int sizeBytes)
+        {
+            _args = (byte*)args;
+            _sizeBytes = sizeBytes;
+            _offset = 0;
+        }
+
+        /// <summary>
+        /// The number of bytes after the current position.
+        /// </summary>
+        public int Remaining => _sizeBytes - Math.Min(_offset, _sizeBytes);
+
+        /// <summary>
+        /// Read a value added with ArgPack::Add().
+        /// </summary>
+        public T Read<T>() where T : unmanaged
+        {
+            return Unsafe.ReadUnaligned<T>(Take(sizeof(T)));
+        }
+
+        /// <summary>
+        /// Get a span over the elements added with ArgPack::AddSpan(). It points into the native buffer, so it's only
+        /// valid during the call.
+        /// </summary>
+        public ReadOnlySpan<T> ReadSpan<T>() where T : unmanaged
+        {
+            int count = Unsafe.ReadUnaligned<int>(Take(8));
+            if (count < 0)
+                throw new InvalidOperationException("The packed arguments are malformed");
+
+            return new ReadOnlySpan<T>(Take(checked(count * sizeof(T))), count);
+        }
+
+        /// <summary>
+        /// Get the UTF-8 bytes of a string added with ArgPack::AddString(), without decoding them.
+        /// </summary>
+        public ReadOnlySpan<byte> ReadUtf8() => ReadSpan<byte>();
+
+        /// <summary>
+        /// Read a string added with ArgPack::AddString(). Unlike everything else, it allocates.
+        /// </summary>
+        public string ReadString() => Encoding.UTF8.GetString(ReadUtf8());
+
+        private byte* Take(int bytes)
+        {
+            // Every item starts at an 8-byte aligned offset, like ArgPack lays them out.
+            // Written so it can't overflow, however large a malformed count is.
+            int offset = (_offset + 7) & ~7;
+            if (bytes < 0 || offset > _sizeBytes || bytes > _sizeBytes - offset)
+                throw new InvalidOperationException("Reading past the end of the packed arguments");
+
+            _offset = offset + bytes;
+            return _args + offset;
+        }
+    }
+}
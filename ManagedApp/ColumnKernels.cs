@@ -0,0 +1,51 @@
+﻿using System.Numerics;
+
+namespace ManagedApp
+{
+    /// <summary>
+    /// Example column kernels (see host_columns.h), vectorized with <see cref="Vector{T}"/>, which is as wide as the
+    /// widest vectors the CPU has (e.g. 8 floats with AVX2).
+    /// </summary>
+    public static class ColumnKernels
+    {
+        /// <summary>
+        /// Columns: xs (float), ys (float), and lengths (float, written). Writes the length of every (x, y) vector.
+        /// </summary>
+        /// <returns>How many of the vectors are in the unit circle.</returns>
+        public static long UnitCircleHits(ColumnBatch batch)
+        {
+            ReadOnlySpan<float> xs = batch.ReadColumn<float>(0);
+            ReadOnlySpan<float> ys = batch.ReadColumn<float>(1);
+            Span<float> lengths = batch.GetColumn<float>(2);
+
+            long hits = 0;
+            int i = 0;
+
+            if (Vector.IsHardwareAccelerated)
+            {
+                // Every lane of a comparison is -1 where it holds, so the hits are counted per lane and summed up once.
+                Vector<int> laneHits = Vector<int>.Zero;
+                for (; i <= xs.Length - Vector<float>.Count; i += Vector<float>.Count)
+                {
+                    var x = new Vector<float>(xs.Slice(i));
+                    var y = new Vector<float>(ys.Slice(i));
+
+                    Vector<float> length = Vector.SquareRoot(x * x + y * y);
+                    length.CopyTo(lengths.Slice(i));
+                    laneHits -= Vector.LessThanOrEqual(length, Vector<float>.One);
+                }
+
+                hits = Vector.Sum(laneHits);
+            }
+
+            for (; i < xs.Length; i++)
+            {
+                lengths[i] = MathF.Sqrt(xs[i] * xs[i] + ys[i] * ys[i]);
+                if (lengths[i] <= 1)
+                    hits++;
+            }
+
+            return hits;
+        }
+    }
+}
@@ -0,0 +1,188 @@
+// <auto-generated>
+// Generated by NativeUtilityBindgen from NativeNetHostApp/src/native_utility_list.h. Don't edit it manually.
+// </auto-generated>
+
+namespace ManagedApp
+{
+    /// <summary>
+    /// Direct function pointers to the typed native utilities. They're bound by <see cref="HostComm"/> when it's
+    /// initialized, and rebound whenever it notices the native utilities have changed.
+    /// </summary>
+    public static unsafe class NativeUtilities
+    {
+        public const uint TestUtilityId = 0xd0f2d6da;
+        public static delegate* unmanaged<void> TestUtilityPointer;
+        public static void TestUtility()
+        {
+            var pointer = TestUtilityPointer;
+            if (pointer == null)
+                throw NotRegistered("test_utility");
+
+            pointer();
+        }
+
+        public const uint HostcommOpenChannelId = 0x5e554200;
+        public static delegate* unmanaged<byte*, void*> HostcommOpenChannelPointer;
+        public static void* HostcommOpenChannel(byte* arg0)
+        {
+            var pointer = HostcommOpenChannelPointer;
+            if (pointer == null)
+                throw NotRegistered("hostcomm_open_channel");
+
+            return pointer(arg0);
+        }
+
+        public const uint HostcommWaitChannelId = 0xc8c98311;
+        public static delegate* unmanaged<void*, int, int> HostcommWaitChannelPointer;
+        public static int HostcommWaitChannel(void* arg0, int arg1)
+        {
+            var pointer = HostcommWaitChannelPointer;
+            if (pointer == null)
+                throw NotRegistered("hostcomm_wait_channel");
+
+            return pointer(arg0, arg1);
+        }
+
+        public const uint HostcommNotifyChannelId = 0x51cb9419;
+        public static delegate* unmanaged<void*, void> HostcommNotifyChannelPointer;
+        public static void HostcommNotifyChannel(void* arg0)
+        {
+            var pointer = HostcommNotifyChannelPointer;
+            if (pointer == null)
+                throw NotRegistered("hostcomm_notify_channel");
+
+            pointer(arg0);
+        }
+
+        public const uint HostcommCompleteAsyncId = 0x978af788;
+        public static delegate* unmanaged<ulong, int, void*, int, void> HostcommCompleteAsyncPointer;
+        public static void HostcommCompleteAsync(ulong arg0, int arg1, void* arg2, int arg3)
+        {
+            var pointer = HostcommCompleteAsyncPointer;
+            if (pointer == null)
+                throw NotRegistered("hostcomm_complete_async");
+
+            pointer(arg0, arg1, arg2, arg3);
+        }
+
+        public const uint HostcommMapWindowId = 0xb6cb7227;
+        public static delegate* unmanaged<void*, long, void*> HostcommMapWindowPointer;
+        public static void* HostcommMapWindow(void* arg0, long arg1)
+        {
+            var pointer = HostcommMapWindowPointer;
+            if (pointer == null)
+                throw NotRegistered("hostcomm_map_window");
+
+            return pointer(arg0, arg1);
+        }
+
+        public const uint HostcommReleaseWindowId = 0x78a8b436;
+        public static delegate* unmanaged<void*, long, void> HostcommReleaseWindowPointer;
+        public static void HostcommReleaseWindow(void* arg0, long arg1)
+        {
+            var pointer = HostcommReleaseWindowPointer;
+            if (pointer == null)
+                throw NotRegistered("hostcomm_release_window");
+
+            pointer(arg0, arg1);
+        }
+
+        public const uint HostcommLendBufferId = 0x7f432df8;
+        public static delegate* unmanaged<void*, int, void*, int, void> HostcommLendBufferPointer;
+        public static void HostcommLendBuffer(void* arg0, int arg1, void* arg2, int arg3)
+        {
+            var pointer = HostcommLendBufferPointer;
+            if (pointer == null)
+                throw NotRegistered("hostcomm_lend_buffer");
+
+            pointer(arg0, arg1, arg2, arg3);
+        }
+
+        public const uint HostcommReturnBufferId = 0xf2d0912d;
+        public static delegate* unmanaged<void*, int, uint, void> HostcommReturnBufferPointer;
+        public static void HostcommReturnBuffer(void* arg0, int arg1, uint arg2)
+        {
+            var pointer = HostcommReturnBufferPointer;
+            if (pointer == null)
+                throw NotRegistered("hostcomm_return_buffer");
+
+            pointer(arg0, arg1, arg2);
+        }
+
+        public const uint HostcommMemoryStatsPublishedId = 0x14ff5ed6;
+        public static delegate* unmanaged<void> HostcommMemoryStatsPublishedPointer;
+        public static void HostcommMemoryStatsPublished()
+        {
+            var pointer = HostcommMemoryStatsPublishedPointer;
+            if (pointer == null)
+                throw NotRegistered("hostcomm_memory_stats_published");
+
+            pointer();
+        }
+
+        public const uint HostcommGetUtilityStatsId = 0xb06d36b3;
+        public static delegate* unmanaged<void*, int, ulong*, int> HostcommGetUtilityStatsPointer;
+        public static int HostcommGetUtilityStats(void* arg0, int arg1, ulong* arg2)
+        {
+            var pointer = HostcommGetUtilityStatsPointer;
+            if (pointer == null)
+                throw NotRegistered("hostcomm_get_utility_stats");
+
+            return pointer(arg0, arg1, arg2);
+        }
+
+        public const uint HostcommTraceNameId = 0xb56a2715;
+        public static delegate* unmanaged<byte*, uint> HostcommTraceNamePointer;
+        public static uint HostcommTraceName(byte* arg0)
+        {
+            var pointer = HostcommTraceNamePointer;
+            if (pointer == null)
+                throw NotRegistered("hostcomm_trace_name");
+
+            return pointer(arg0);
+        }
+
+        public const uint HostcommTraceBeginId = 0xec276fab;
+        public static delegate* unmanaged<uint, void> HostcommTraceBeginPointer;
+        public static void HostcommTraceBegin(uint arg0)
+        {
+            var pointer = HostcommTraceBeginPointer;
+            if (pointer == null)
+                throw NotRegistered("hostcomm_trace_begin");
+
+            pointer(arg0);
+        }
+
+        public const uint HostcommTraceEndId = 0x074bb573;
+        public static delegate* unmanaged<uint, void> HostcommTraceEndPointer;
+        public static void HostcommTraceEnd(uint arg0)
+        {
+            var pointer = HostcommTraceEndPointer;
+            if (pointer == null)
+                throw NotRegistered("hostcomm_trace_end");
+
+            pointer(arg0);
+        }
+
+        private static InvalidOperationException NotRegistered(string utilityName) =>
+            new($"The native utility '{utilityName}' isn't registered");
+
+        internal static void Bind()
+        {
+            TestUtilityPointer = (delegate* unmanaged<void>)HostComm.FindTypedNativeUtility(TestUtilityId, "test_utility");
+            HostcommOpenChannelPointer = (delegate* unmanaged<byte*, void*>)HostComm.FindTypedNativeUtility(HostcommOpenChannelId, "hostcomm_open_channel");
+            HostcommWaitChannelPointer = (delegate* unmanaged<void*, int, int>)HostComm.FindTypedNativeUtility(HostcommWaitChannelId, "hostcomm_wait_channel");
+            HostcommNotifyChannelPointer = (delegate* unmanaged<void*, void>)HostComm.FindTypedNativeUtility(HostcommNotifyChannelId, "hostcomm_notify_channel");
+            HostcommCompleteAsyncPointer = (delegate* unmanaged<ulong, int, void*, int, void>)HostComm.FindTypedNativeUtility(HostcommCompleteAsyncId, "hostcomm_complete_async");
+            HostcommMapWindowPointer = (delegate* unmanaged<void*, long, void*>)HostComm.FindTypedNativeUtility(HostcommMapWindowId, "hostcomm_map_window");
+            HostcommReleaseWindowPointer = (delegate* unmanaged<void*, long, void>)HostComm.FindTypedNativeUtility(HostcommReleaseWindowId, "hostcomm_release_window");
+            HostcommLendBufferPointer = (delegate* unmanaged<void*, int, void*, int, void>)HostComm.FindTypedNativeUtility(HostcommLendBufferId, "hostcomm_lend_buffer");
+            HostcommReturnBufferPointer = (delegate* unmanaged<void*, int, uint, void>)HostComm.FindTypedNativeUtility(HostcommReturnBufferId, "hostcomm_return_buffer");
+            HostcommMemoryStatsPublishedPointer = (delegate* unmanaged<void>)HostComm.FindTypedNativeUtility(HostcommMemoryStatsPublishedId, "hostcomm_memory_stats_published");
+            HostcommGetUtilityStatsPointer = (delegate* unmanaged<void*, int, ulong*, int>)HostComm.FindTypedNativeUtility(HostcommGetUtilityStatsId, "hostcomm_get_utility_stats");
+            HostcommTraceNamePointer = (delegate* unmanaged<byte*, uint>)HostComm.FindTypedNativeUtility(HostcommTraceNameId, "hostcomm_trace_name");
+            HostcommTraceBeginPointer = (delegate* unmanaged<uint, void>)HostComm.FindTypedNativeUtility(HostcommTraceBeginId, "hostcomm_trace_begin");
+            HostcommTraceEndPointer = (delegate* unmanaged<uint, void>)HostComm.FindTypedNativeUtility(HostcommTraceEndId, "hostcomm_trace_end");
+        }
+    }
+}
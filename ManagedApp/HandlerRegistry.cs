@@ -0,0 +1,139 @@
+﻿using System.Diagnostics.CodeAnalysis;
+using System.Reflection;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace ManagedApp
+{
+    /// <summary>
+    /// The static methods the native side registers by type and method name with one of the HostComm modules (batch and
+    /// async entrypoints, file and buffer handlers, column kernels), looked up by ID without locking. The handlers are called
+    /// from [UnmanagedCallersOnly] methods, which must catch whatever they throw: an exception can't go through to the
+    /// native side. The methods of a reloadable assembly are looked up in its current version, and rebound to the next one
+    /// when it's swapped in (see <see cref="HostReload"/>).
+    /// </summary>
+    internal sealed class HandlerRegistry<[DynamicallyAccessedMembers(DynamicallyAccessedMemberTypes.PublicMethods)] THandler> : HostReload.IRegistry
+    {
+        private readonly Type _returnType;
+        private readonly Type[] _parameterTypes;
+        private readonly Func<MethodInfo, THandler> _bind;
+
+        // Replaced as a whole on registration (and rebinding), so the handlers can be looked up without locking. Both are
+        // only replaced under HostReload.VersionsLock.
+        private volatile THandler[] _handlers = Array.Empty<THandler>();
+        private MethodInfo[] _methods = Array.Empty<MethodInfo>();
+
+        /// <summary>
+        /// Registers the methods as delegates of THandler, whose signature they must have.
+        /// </summary>
+        public HandlerRegistry()
+        {
+            MethodInfo invoke = typeof(THandler).GetMethod("Invoke");
+
+            _returnType = invoke.ReturnType;
+            _parameterTypes = Array.ConvertAll(invoke.GetParameters(), parameter => parameter.ParameterType);
+            _bind = method => (THandler)(object)method.CreateDelegate(typeof(THandler));
+
+            HostReload.AddRegistry(this);
+        }
+
+        /// <summary>
+        /// Registers whatever `bind` makes of the methods, like function pointers.
+        /// </summary>
+        public HandlerRegistry(Type returnType, Type[] parameterTypes, Func<MethodInfo, THandler> bind)
+        {
+            _returnType = returnType;
+            _parameterTypes = parameterTypes;
+            _bind = bind;
+
+            HostReload.AddRegistry(this);
+        }
+
+        /// <summary>
+        /// All the handlers, indexed by their IDs, for looking up several at once.
+        /// </summary>
+        public THandler[] Handlers => _handlers;
+
+        public THandler this[int id] => _handlers[id];
+
+        /// <summary>
+        /// Find a static method with the registry's signature, and add it.
+        /// </summary>
+        /// <returns>The ID of the handler, -1 if the method is not found, or -2 in a NativeAOT build.</returns>
+        [UnconditionalSuppressMessage("Trimming", "IL2057", Justification = "NativeAOT builds are rejected before the lookup, and the JIT-ed app isn't trimmed.")]
+        public int Register(IntPtr typeName, IntPtr methodName)
+        {
+            // The method is looked up by a name only known at run time, which the NativeAOT compiler can't see, so it may
+            // have trimmed the method (or its metadata) away.
+            if (!RuntimeFeature.IsDynamicCodeSupported)
+                return -2;
+
+            try
+            {
+                lock (HostReload.VersionsLock)
+                {
+                    // The strings are char_t on the native side, which is what the Auto charset is on each platform too.
+                    MethodInfo method = FindMethod(HostReload.FindRegisteredType(Marshal.PtrToStringAuto(typeName)), Marshal.PtrToStringAuto(methodName));
+                    if (method == null)
+                        return -1;
+
+                    THandler handler = _bind(method);
+
+                    var methods = new MethodInfo[_methods.Length + 1];
+                    _methods.CopyTo(methods, 0);
+                    methods[^1] = method;
+
+                    var handlers = new THandler[_handlers.Length + 1];
+                    _handlers.CopyTo(handlers, 0);
+                    handlers[^1] = handler;
+
+                    _methods = methods;
+                    _handlers = handlers;
+                    return handlers.Length - 1;
+                }
+            }
+            catch (Exception e)
+            {
+                Console.WriteLine($"[HandlerRegistry::Register] Failed to register the method: {e}");
+                return -1;
+            }
+        }
+
+        Action HostReload.IRegistry.PrepareRebind(Func<Type, Type> replaceType)
+        {
+            MethodInfo[] methods = null;
+            THandler[] handlers = null;
+
+            for (int id = 0; id < _methods.Length; id++)
+            {
+                Type type = replaceType(_methods[id].DeclaringType);
+                if (type == _methods[id].DeclaringType)
+                    continue;
+
+                MethodInfo method = FindMethod(type, _methods[id].Name);
+                if (method == null)
+                    return null;
+
+                methods ??= (MethodInfo[])_methods.Clone();
+                handlers ??= (THandler[])_handlers.Clone();
+                methods[id] = method;
+                handlers[id] = _bind(method);
+            }
+
+            if (methods == null)
+                return static () => { };
+
+            return () =>
+            {
+                _methods = methods;
+                _handlers = handlers;
+            };
+        }
+
+        private MethodInfo FindMethod(Type type, string methodName)
+        {
+            MethodInfo method = type?.GetMethod(methodName, BindingFlags.Static | BindingFlags.Public | BindingFlags.NonPublic, _parameterTypes);
+            return method != null && method.ReturnType == _returnType ? method : null;
+        }
+    }
+}
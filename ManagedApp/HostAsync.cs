@@ -0,0 +1,78 @@
+﻿using System.Runtime.InteropServices;
+using System.Text;
+
+namespace ManagedApp
+{
+    /// <summary>
+    /// The managed side of async calls (see host_async.h). The native side starts a call and suspends its coroutine, and
+    /// the `hostcomm_complete_async` native utility is called back with the result once the Task completes.
+    /// </summary>
+    internal static unsafe class HostAsync
+    {
+        /// <summary>
+        /// Mirrors AsyncStatus in host_async.h.
+        /// </summary>
+        private enum Status
+        {
+            Succeeded = 0,
+            Faulted = 1,
+            Canceled = 2,
+        }
+
+        private static readonly HandlerRegistry<Func<byte[], Task<byte[]>>> _entrypoints = new();
+
+        /// <summary>
+        /// Find a `static Task&lt;byte[]&gt; Method(byte[] args)` method and make it callable asynchronously.
+        /// </summary>
+        /// <returns>See <see cref="HandlerRegistry{THandler}.Register"/>.</returns>
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostAsync_RegisterEntrypoint")]
+        internal static int RegisterEntrypoint(IntPtr typeName, IntPtr methodName) => _entrypoints.Register(typeName, methodName);
+
+        /// <summary>
+        /// Start an async call. Its completion is always reported through the native utility, even if the method throws
+        /// right away, and may be reported before this returns.
+        /// </summary>
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostAsync_Start")]
+        internal static void Start(int entrypointId, byte* args, int sizeBytes, ulong token)
+        {
+            Task<byte[]> task;
+            try
+            {
+                task = _entrypoints[entrypointId](new ReadOnlySpan<byte>(args, sizeBytes).ToArray());
+            }
+            catch (Exception e)
+            {
+                task = Task.FromException<byte[]>(e);
+            }
+
+            if (task.IsCompleted)
+            {
+                Complete(task, token);
+                return;
+            }
+
+            task.ContinueWith(static (completed, state) => Complete(completed, (ulong)state), token,
+                CancellationToken.None, TaskContinuationOptions.ExecuteSynchronously, TaskScheduler.Default);
+        }
+
+        private static void Complete(Task<byte[]> task, ulong token)
+        {
+            if (task.IsCompletedSuccessfully)
+            {
+                byte[] result = task.Result ?? Array.Empty<byte>();
+                fixed (byte* resultPointer = result)
+                    NativeUtilities.HostcommCompleteAsync(token, (int)Status.Succeeded, resultPointer, result.Length);
+            }
+            else if (task.IsCanceled)
+            {
+                NativeUtilities.HostcommCompleteAsync(token, (int)Status.Canceled, null, 0);
+            }
+            else
+            {
+                byte[] message = Encoding.UTF8.GetBytes(task.Exception.InnerException?.ToString() ?? task.Exception.ToString());
+                fixed (byte* messagePointer = message)
+                    NativeUtilities.HostcommCompleteAsync(token, (int)Status.Faulted, messagePointer, message.Length);
+            }
+        }
+    }
+}
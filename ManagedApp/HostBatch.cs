@@ -0,0 +1,72 @@
+﻿using System.Reflection;
+using System.Runtime.InteropServices;
+
+namespace ManagedApp
+{
+    /// <summary>
+    /// The managed side of batched calls (see host_batch.h). The native side appends calls to a batch and flushes it
+    /// with a single transition into <see cref="Dispatch"/>, which runs all of them in a loop.
+    /// </summary>
+    internal static unsafe class HostBatch
+    {
+        /// <summary>
+        /// Mirrors CallBatch::Record in host_batch.h.
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential)]
+        internal struct Record
+        {
+            public int EntrypointId;
+            public int SizeBytes;
+            public uint ArgsOffset;
+            public uint Reserved;
+        }
+
+        /// <summary>
+        /// Mirrors BATCH_CALL_FAILED in host_batch.h.
+        /// </summary>
+        private const int CallFailed = int.MinValue;
+
+        // Function pointers rather than delegates, so the dispatcher calls them without going through a delegate. The method
+        // is kept along with its pointer, so a reloaded version (see HostReload) isn't collected under a running dispatch.
+        private readonly record struct Entrypoint(IntPtr Pointer, MethodInfo Method);
+
+        private static readonly HandlerRegistry<Entrypoint> _entrypoints = new(typeof(int), new[] { typeof(IntPtr), typeof(int) },
+            method => new Entrypoint(method.MethodHandle.GetFunctionPointer(), method));
+
+        /// <summary>
+        /// Find a `static int Method(IntPtr args, int sizeBytes)` method and make it callable in batches.
+        /// </summary>
+        /// <returns>See <see cref="HandlerRegistry{THandler}.Register"/>.</returns>
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostBatch_RegisterEntrypoint")]
+        internal static int RegisterEntrypoint(IntPtr typeName, IntPtr methodName) => _entrypoints.Register(typeName, methodName);
+
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostBatch_Dispatch")]
+        internal static void Dispatch(Record* records, int count, byte* args, int* results)
+        {
+            Entrypoint[] entrypoints = _entrypoints.Handlers;
+
+            for (int i = 0; i < count; i++)
+            {
+                ref Record record = ref records[i];
+
+                // A call that throws shouldn't break the other calls in the batch.
+                try
+                {
+                    if ((uint)record.EntrypointId >= (uint)entrypoints.Length)
+                        throw new ArgumentOutOfRangeException(nameof(record.EntrypointId), record.EntrypointId, "No batch entrypoint has this ID");
+
+                    var entrypoint = (delegate*<IntPtr, int, int>)entrypoints[record.EntrypointId].Pointer;
+                    results[i] = entrypoint((IntPtr)(args + record.ArgsOffset), record.SizeBytes);
+                }
+                catch (Exception e)
+                {
+                    Console.WriteLine($"[HostBatch::Dispatch] A batched call has thrown an exception: {e}");
+                    results[i] = CallFailed;
+                }
+            }
+
+            // Keeps the methods (and so their versions) alive until the last call has returned.
+            GC.KeepAlive(entrypoints);
+        }
+    }
+}
@@ -0,0 +1,182 @@
+﻿using System.Runtime.InteropServices;
+
+namespace ManagedApp
+{
+    /// <summary>
+    /// A buffer of a native buffer pool (see host_buffer_pool.h) the native side has written into and delivered to a
+    /// handler. The bytes are read in place, and the buffer must be given back with <see cref="Return"/> exactly once,
+    /// when nothing uses them anymore. Until then, the handler may keep it (and pass it to other threads). A copy returning
+    /// it again is ignored, even once the buffer has been rented again.
+    /// </summary>
+    public readonly struct PooledBuffer
+    {
+        private readonly HostBufferPool.Pool _pool;
+        private readonly uint _generation;
+
+        public int Id { get; }
+
+        /// <summary>
+        /// How many bytes the native side has written.
+        /// </summary>
+        public int Length { get; }
+
+        /// <summary>
+        /// The whole pinned array, which may be longer than <see cref="Length"/>.
+        /// </summary>
+        public byte[] Array => _pool.Arrays[Id];
+
+        public Span<byte> Span => new(Array, 0, Length);
+        public Memory<byte> Memory => new(Array, 0, Length);
+
+        internal PooledBuffer(HostBufferPool.Pool pool, int id, uint generation, int length)
+        {
+            _pool = pool;
+            _generation = generation;
+            Id = id;
+            Length = length;
+        }
+
+        public void Return() => _pool.Return(Id, _generation);
+    }
+
+    /// <summary>
+    /// The managed side of the native buffer pools (see host_buffer_pool.h). The buffers are arrays allocated on the pinned
+    /// object heap, so they never move and the native side can write into them through plain pointers.
+    /// </summary>
+    internal static unsafe class HostBufferPool
+    {
+        internal sealed class Pool
+        {
+            public readonly void* Native;
+            public readonly byte[][] Arrays;
+
+            // Set once the native pool is going away, so the buffers returned later (which have been leaked) don't reach it.
+            private volatile bool _isClosed;
+
+            // The returns between checking that the pool is open and calling into it, which closing waits for.
+            private int _activeReturns;
+
+            public Pool(void* native, byte[][] arrays)
+            {
+                Native = native;
+                Arrays = arrays;
+            }
+
+            public void Return(int id, uint generation)
+            {
+                // Both sides write their flag, then read the other's (with full fences in between), so either the return
+                // sees the pool closed, or closing sees the return and waits for it.
+                Interlocked.Increment(ref _activeReturns);
+                try
+                {
+                    if (!_isClosed)
+                        NativeUtilities.HostcommReturnBuffer(Native, id, generation);
+                }
+                finally
+                {
+                    Interlocked.Decrement(ref _activeReturns);
+                }
+            }
+
+            public void Close()
+            {
+                _isClosed = true;
+                Interlocked.MemoryBarrier();
+
+                var spinner = new SpinWait();
+                while (Volatile.Read(ref _activeReturns) != 0)
+                    spinner.SpinOnce();
+            }
+        }
+
+        private static readonly HandlerRegistry<Action<PooledBuffer>> _handlers = new();
+
+        private static readonly object _poolsLock = new();
+
+        // Copied on every change, so the pools can be looked up without locking.
+        private static volatile Pool[] _pools = Array.Empty<Pool>();
+
+        /// <summary>
+        /// Find a `static void Method(PooledBuffer buffer)` method and make it usable to deliver buffers to.
+        /// </summary>
+        /// <returns>See <see cref="HandlerRegistry{THandler}.Register"/>.</returns>
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostBufferPool_RegisterHandler")]
+        internal static int RegisterHandler(IntPtr typeName, IntPtr methodName) => _handlers.Register(typeName, methodName);
+
+        /// <summary>
+        /// Allocate `counts[i]` pinned arrays of `sizes[i]` bytes for every class, and lend them to the native pool in order.
+        /// </summary>
+        /// <returns>The ID of the pool, or -1 if the arrays couldn't be allocated.</returns>
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostBufferPool_Create")]
+        internal static int Create(void* nativePool, int* sizes, int* counts, int classCount)
+        {
+            var arrays = new List<byte[]>();
+
+            try
+            {
+                for (int i = 0; i < classCount; i++)
+                {
+                    for (int j = 0; j < counts[i]; j++)
+                        arrays.Add(GC.AllocateUninitializedArray<byte>(sizes[i], pinned: true));
+                }
+            }
+            catch (OutOfMemoryException e)
+            {
+                Console.WriteLine($"[HostBufferPool::Create] Failed to allocate the buffers: {e.Message}");
+                return -1;
+            }
+
+            for (int id = 0; id < arrays.Count; id++)
+            {
+                fixed (byte* data = arrays[id])
+                    NativeUtilities.HostcommLendBuffer(nativePool, id, data, arrays[id].Length);
+            }
+
+            lock (_poolsLock)
+            {
+                var pools = new Pool[_pools.Length + 1];
+                _pools.CopyTo(pools, 0);
+                pools[^1] = new Pool(nativePool, arrays.ToArray());
+
+                _pools = pools;
+                return pools.Length - 1;
+            }
+        }
+
+        /// <summary>
+        /// Close the pool (waiting for the returns already calling into it), and let the GC have its arrays unless some of
+        /// them are still rented (and may be written to).
+        /// </summary>
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostBufferPool_Destroy")]
+        internal static void Destroy(int poolId, int isLeaking)
+        {
+            lock (_poolsLock)
+            {
+                var pools = (Pool[])_pools.Clone();
+                pools[poolId].Close();
+
+                // The leaked arrays stay referenced by their closed pool for good.
+                if (isLeaking == 0)
+                    pools[poolId] = null;
+
+                _pools = pools;
+            }
+        }
+
+        /// <returns>0 if the handler has returned, or -1 if it has thrown (the native side returns the buffer then).</returns>
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostBufferPool_Deliver")]
+        internal static int Deliver(int handlerId, int poolId, int bufferId, uint generation, int length)
+        {
+            try
+            {
+                _handlers[handlerId](new PooledBuffer(_pools[poolId], bufferId, generation, length));
+                return 0;
+            }
+            catch (Exception e)
+            {
+                Console.WriteLine($"[HostBufferPool::Deliver] The buffer handler has thrown an exception: {e}");
+                return -1;
+            }
+        }
+    }
+}
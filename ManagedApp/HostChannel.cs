@@ -0,0 +1,193 @@
+﻿using System.Runtime.InteropServices;
+using System.Text;
+
+namespace ManagedApp
+{
+    /// <summary>
+    /// A lock-free ring buffer of records in native memory, shared with the native side (see host_channel.h). Both sides
+    /// write to it and drain it directly, without calling each other. Any number of producers are allowed, but only one
+    /// consumer at a time.
+    /// </summary>
+    public sealed unsafe class HostChannel
+    {
+        /// <summary>
+        /// Handles a single record. The span is only valid until the handler returns.
+        /// </summary>
+        public delegate void RecordHandler(ReadOnlySpan<byte> record);
+
+        // Mirrors ChannelHeader and ChannelRecordHeader in host_channel.h.
+        private const int HeaderSize = 256;
+        private const int CapacityOffset = 0;
+        private const int WakeHandleOffset = 8;
+        private const int HeadOffset = 64;
+        private const int TailOffset = 128;
+        private const int ConsumerWaitingOffset = 192;
+        private const int RecordHeaderSize = 8;
+
+        private const uint RecordFree = 0;
+        private const uint RecordCommitted = 1;
+        private const uint RecordPadding = 2;
+
+        private readonly byte* _header;
+        private readonly byte* _data;
+        private readonly ulong _capacity;
+        private readonly bool _hasWakeups;
+
+        private ref long Head => ref *(long*)(_header + HeadOffset);
+        private ref long Tail => ref *(long*)(_header + TailOffset);
+        private ref int ConsumerWaiting => ref *(int*)(_header + ConsumerWaitingOffset);
+
+        public int Capacity => (int)_capacity;
+
+        private HostChannel(byte* header)
+        {
+            _header = header;
+            _data = header + HeaderSize;
+            _capacity = *(ulong*)(header + CapacityOffset);
+            _hasWakeups = *(long*)(header + WakeHandleOffset) != -1;
+        }
+
+        /// <summary>
+        /// Open a channel the native side has created with the specified name.
+        /// </summary>
+        /// <returns>The channel, or null if there's no channel with this name.</returns>
+        public static HostChannel Open(string name)
+        {
+            if (!HostComm.IsInitialized)
+                throw new InvalidOperationException("Host communcation hasn't initialized yet");
+
+            int byteCount = Encoding.UTF8.GetByteCount(name);
+            Span<byte> nameBytes = byteCount < 256 ? stackalloc byte[byteCount + 1] : new byte[byteCount + 1];
+            Encoding.UTF8.GetBytes(name, nameBytes);
+            nameBytes[byteCount] = 0;
+
+            void* header;
+            fixed (byte* namePointer = nameBytes)
+                header = NativeUtilities.HostcommOpenChannel(namePointer);
+
+            return header != null ? new HostChannel((byte*)header) : null;
+        }
+
+        /// <summary>
+        /// Copy the record into the channel.
+        /// </summary>
+        /// <returns>False if there's not enough free space right now.</returns>
+        public bool TryWrite(ReadOnlySpan<byte> record)
+        {
+            ulong recordSize = AlignRecord((ulong)(RecordHeaderSize + record.Length));
+            if (recordSize > _capacity)
+                return false;
+
+            ulong tail = (ulong)Volatile.Read(ref Tail);
+            ulong padding;
+
+            while (true)
+            {
+                // A record that doesn't fit before the end of the ring is moved to its beginning.
+                ulong offset = tail & (_capacity - 1);
+                padding = offset + recordSize > _capacity ? _capacity - offset : 0;
+
+                if (tail + padding + recordSize - (ulong)Volatile.Read(ref Head) > _capacity)
+                    return false;
+
+                ulong observed = (ulong)Interlocked.CompareExchange(ref Tail, (long)(tail + padding + recordSize), (long)tail);
+                if (observed == tail)
+                    break;
+
+                tail = observed;
+            }
+
+            if (padding != 0)
+            {
+                byte* paddingRecord = RecordAt(tail);
+                *(uint*)paddingRecord = (uint)padding;
+                Volatile.Write(ref *(uint*)(paddingRecord + 4), RecordPadding);
+            }
+
+            byte* recordHeader = RecordAt(tail + padding);
+            *(uint*)recordHeader = (uint)record.Length;
+            record.CopyTo(new Span<byte>(recordHeader + RecordHeaderSize, record.Length));
+            Volatile.Write(ref *(uint*)(recordHeader + 4), RecordCommitted);
+
+            if (_hasWakeups)
+            {
+                // Pairs with the fence in the native Channel::Wait(), so either the consumer sees the record or we see it waiting.
+                Interlocked.MemoryBarrier();
+                if (Volatile.Read(ref ConsumerWaiting) != 0)
+                    NativeUtilities.HostcommNotifyChannel(_header);
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Pass the committed records to the handler in order, and free them all at once afterwards.
+        /// Only one thread at a time is allowed to drain a channel.
+        /// </summary>
+        /// <returns>How many records were handled.</returns>
+        public int Drain(RecordHandler handler, int maxRecords = int.MaxValue)
+        {
+            ulong start = (ulong)Volatile.Read(ref Head);
+            ulong head = start;
+            int count = 0;
+
+            // The consumed records are freed only at the end, so a single drain must not go around the whole ring.
+            while (count < maxRecords && head - start < _capacity)
+            {
+                byte* record = RecordAt(head);
+                uint state = Volatile.Read(ref *(uint*)(record + 4));
+
+                if (state == RecordFree)
+                    break;
+
+                uint size = *(uint*)record;
+                if (state == RecordPadding)
+                {
+                    head += size;
+                    continue;
+                }
+
+                handler(new ReadOnlySpan<byte>(record + RecordHeaderSize, (int)size));
+
+                head += AlignRecord(RecordHeaderSize + size);
+                count++;
+            }
+
+            if (head != start)
+                Release(start, head);
+
+            return count;
+        }
+
+        /// <summary>
+        /// Block until there's a record to drain, or the timeout expires (-1 to wait forever).
+        /// </summary>
+        /// <returns>Whether there's a record to drain.</returns>
+        public bool Wait(int timeoutMs)
+        {
+            if (!_hasWakeups)
+                throw new InvalidOperationException("Wakeups are disabled for this channel");
+
+            return NativeUtilities.HostcommWaitChannel(_header, timeoutMs) != 0;
+        }
+
+        private byte* RecordAt(ulong position) => _data + (position & (_capacity - 1));
+
+        private static ulong AlignRecord(ulong size) => (size + 7) & ~7UL;
+
+        private void Release(ulong from, ulong to)
+        {
+            // Producers rely on free space being zeroed (see Channel::Release() on the native side).
+            while (from != to)
+            {
+                ulong offset = from & (_capacity - 1);
+                ulong length = Math.Min(to - from, _capacity - offset);
+
+                new Span<byte>(_data + offset, (int)length).Clear();
+                from += length;
+            }
+
+            Volatile.Write(ref Head, (long)to);
+        }
+    }
+}
@@ -0,0 +1,146 @@
+﻿using System.Runtime.InteropServices;
+
+namespace ManagedApp
+{
+    /// <summary>
+    /// The element types of the columns (mirrors HostComm::ColumnType in host_columns.h).
+    /// </summary>
+    public enum ColumnType
+    {
+        Int8,
+        UInt8,
+        Int16,
+        UInt16,
+        Int32,
+        UInt32,
+        Int64,
+        UInt64,
+        Float32,
+        Float64,
+    }
+
+    /// <summary>
+    /// A batch of records passed by the native side as columns (see host_columns.h): every column is an array of
+    /// <see cref="Count"/> elements in native memory, read and written in place as a span. It's only valid while the
+    /// kernel it's passed to runs.
+    /// </summary>
+    public readonly unsafe struct ColumnBatch
+    {
+        private readonly HostColumns.ColumnDescriptor* _columns;
+
+        /// <summary>
+        /// How many records the batch has, so how many elements every column has.
+        /// </summary>
+        public int Count { get; }
+
+        public int ColumnCount { get; }
+
+        internal ColumnBatch(HostColumns.ColumnDescriptor* columns, int columnCount, int count)
+        {
+            _columns = columns;
+            ColumnCount = columnCount;
+            Count = count;
+        }
+
+        public ColumnType GetColumnType(int index) => GetDescriptor(index).Type;
+        public bool IsReadOnly(int index) => GetDescriptor(index).IsReadOnly != 0;
+
+        /// <summary>
+        /// Get a column to read. Throws if it has another element type than T.
+        /// </summary>
+        public ReadOnlySpan<T> ReadColumn<T>(int index) where T : unmanaged
+        {
+            return new ReadOnlySpan<T>(GetData<T>(index), Count);
+        }
+
+        /// <summary>
+        /// Get a column to write (and read). Throws if it has another element type than T, or it's read-only (passed as
+        /// a pointer to const by the native side).
+        /// </summary>
+        public Span<T> GetColumn<T>(int index) where T : unmanaged
+        {
+            if (IsReadOnly(index))
+                throw new InvalidOperationException($"The column {index} is read-only");
+
+            return new Span<T>(GetData<T>(index), Count);
+        }
+
+        private void* GetData<T>(int index) where T : unmanaged
+        {
+            ref readonly HostColumns.ColumnDescriptor column = ref GetDescriptor(index);
+            if (column.Type != HostColumns.ColumnTypeOf<T>.Type)
+                throw new InvalidCastException($"The column {index} has {column.Type} elements, not {typeof(T).Name}");
+
+            return column.Data;
+        }
+
+        private ref readonly HostColumns.ColumnDescriptor GetDescriptor(int index)
+        {
+            if ((uint)index >= (uint)ColumnCount)
+                throw new ArgumentOutOfRangeException(nameof(index));
+
+            return ref _columns[index];
+        }
+    }
+
+    /// <summary>
+    /// The managed side of the column kernels (see host_columns.h).
+    /// </summary>
+    internal static unsafe class HostColumns
+    {
+        /// <summary>
+        /// Mirrors HostComm::Column in host_columns.h.
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential)]
+        internal struct ColumnDescriptor
+        {
+            public void* Data;
+            public ColumnType Type;
+            public int IsReadOnly;
+        }
+
+        /// <summary>
+        /// The column type of T, resolved once per type (and folded into a constant by the JIT).
+        /// </summary>
+        internal static class ColumnTypeOf<T> where T : unmanaged
+        {
+            public static readonly ColumnType Type =
+                typeof(T) == typeof(sbyte) ? ColumnType.Int8 :
+                typeof(T) == typeof(byte) ? ColumnType.UInt8 :
+                typeof(T) == typeof(short) ? ColumnType.Int16 :
+                typeof(T) == typeof(ushort) ? ColumnType.UInt16 :
+                typeof(T) == typeof(int) ? ColumnType.Int32 :
+                typeof(T) == typeof(uint) ? ColumnType.UInt32 :
+                typeof(T) == typeof(long) ? ColumnType.Int64 :
+                typeof(T) == typeof(ulong) ? ColumnType.UInt64 :
+                typeof(T) == typeof(float) ? ColumnType.Float32 :
+                typeof(T) == typeof(double) ? ColumnType.Float64 :
+                (ColumnType)(-1);
+        }
+
+        private static readonly HandlerRegistry<Func<ColumnBatch, long>> _kernels = new();
+
+        /// <summary>
+        /// Find a `static long Method(ColumnBatch batch)` method and make it usable to run batches with.
+        /// </summary>
+        /// <returns>See <see cref="HandlerRegistry{THandler}.Register"/>.</returns>
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostColumns_RegisterKernel")]
+        internal static int RegisterKernel(IntPtr typeName, IntPtr methodName) => _kernels.Register(typeName, methodName);
+
+        /// <returns>0 if the kernel has returned (its result is written to `result`), or -1 if it has thrown.</returns>
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostColumns_Run")]
+        internal static int Run(int kernelId, ColumnDescriptor* columns, int columnCount, int count, long* result)
+        {
+            try
+            {
+                *result = _kernels[kernelId](new ColumnBatch(columns, columnCount, count));
+                return 0;
+            }
+            catch (Exception e)
+            {
+                Console.WriteLine($"[HostColumns::Run] The column kernel has thrown an exception: {e}");
+                return -1;
+            }
+        }
+    }
+}
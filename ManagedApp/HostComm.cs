@@ -1,4 +1,6 @@
-﻿using System.Runtime.InteropServices;
+﻿using System.Collections.Concurrent;
+using System.Runtime.InteropServices;
+using System.Text;
 
 namespace ManagedApp
 {
@@ -7,31 +9,116 @@ namespace ManagedApp
     /// </summary>
     public static class HostComm
     {
+        [StructLayout(LayoutKind.Sequential)]
+        internal unsafe struct UtilityTableEntry
+        {
+            public byte* Name;
+            public IntPtr Callback;
+            public uint Id;
+        }
+
+        /// <summary>
+        /// What the native side passes to <see cref="Init"/> (mirrors InitParameters in host_comm.cpp).
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential)]
+        internal unsafe struct InitParameters
+        {
+            public delegate* unmanaged[Cdecl]<byte*, IntPtr> UtilityLocator;
+            public UtilityTableEntry* UtilityTable;
+            public int UtilityCount;
+            public uint TableGeneration;
+            public uint* Generation;
+            public delegate* unmanaged[Cdecl]<UtilityTableEntry*, int, uint*, int> TableProvider;
+        }
+
         /// <summary>
-        /// A native hostcom handler that locates a native registered function and returns it, or nullptr otherwise.
+        /// A copy of the native utilities handed off by the native side, indexed by name and by ordinal.
         /// </summary>
-        [UnmanagedFunctionPointer(CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
-        private delegate IntPtr UtilityLocator(string utilityName);
+        private sealed class UtilityTable
+        {
+            public readonly uint Generation;
+            public readonly Dictionary<string, int> Ordinals;
+            public readonly Dictionary<uint, int> IdOrdinals;
+            public readonly IntPtr[] Pointers;
+
+            public unsafe UtilityTable(UtilityTableEntry* entries, int count, uint generation)
+            {
+                Generation = generation;
+                Ordinals = new Dictionary<string, int>(count);
+                IdOrdinals = new Dictionary<uint, int>(count);
+                Pointers = new IntPtr[count];
+
+                for (int i = 0; i < count; i++)
+                {
+                    Ordinals[Marshal.PtrToStringUTF8((IntPtr)entries[i].Name)] = i;
+                    IdOrdinals[entries[i].Id] = i;
+                    Pointers[i] = entries[i].Callback;
+                }
+            }
+        }
 
         public static bool IsInitialized => _isInitialized;
 
-        private static bool _isInitialized = false;
-        private static UtilityLocator _utilityLocator;
+        /// <summary>
+        /// The version of the native utilities set. It changes whenever a native utility is registered or unregistered,
+        /// which also makes previously taken ordinals invalid.
+        /// </summary>
+        public static uint UtilityGeneration
+        {
+            get
+            {
+                ThrowIfUninitialized();
+                return ReadGeneration();
+            }
+        }
+
+        /// <summary>
+        /// A delegate made by <see cref="GetNativeUtility{T}(string)"/>, which is current while the generation is.
+        /// </summary>
+        private readonly record struct CachedUtility(uint Generation, IntPtr Pointer, Delegate Utility);
+
+        // Set last in Init, so other threads that see it set see everything else initialized too.
+        private static volatile bool _isInitialized = false;
+
+        // The native hostcom handler that locates a registered native utility by its (null-terminated UTF-8) name, and
+        // returns it, or nullptr if it's not found.
+        private static unsafe delegate* unmanaged[Cdecl]<byte*, IntPtr> _utilityLocator;
+
+        private static readonly ConcurrentDictionary<(string Name, Type DelegateType), CachedUtility> _utilityDelegates = new();
+
+        private static unsafe uint* _generation;
+        private static unsafe delegate* unmanaged[Cdecl]<UtilityTableEntry*, int, uint*, int> _tableProvider;
+        private static volatile UtilityTable _utilityTable;
+        private static uint _boundGeneration;
+        private static readonly object _utilityTableLock = new();
 
         /// <summary>
         /// Asks hostcom on the native side to locate a special utility with the specified name,
         /// and converts it to a callable managed delegate.
+        /// The delegates (and the misses) are cached by the name and the delegate type until the native utilities change,
+        /// so looking the same utility up again doesn't allocate nor call into the native side.
         /// </summary>
         /// <returns>The managed delegate to call the native utility, or null if not found.</returns>
         public static T GetNativeUtility<T>(string utilityName) where T : Delegate
         {
             ThrowIfUninitialized();
 
-            IntPtr utility = _utilityLocator.Invoke(utilityName);
-            if (utility == IntPtr.Zero)
-                return null;
+            // Read before looking the utility up, so a delegate made while the registry changes is never taken as current.
+            uint generation = ReadGeneration();
+
+            var key = (utilityName, typeof(T));
+            bool isCached = _utilityDelegates.TryGetValue(key, out CachedUtility cached);
+            if (isCached && cached.Generation == generation)
+                return (T)cached.Utility;
 
-            return Marshal.GetDelegateForFunctionPointer<T>(utility);
+            IntPtr utility = FindNativeUtility(utilityName);
+
+            // Most registry changes are about other utilities, so the delegate is kept if the pointer hasn't changed.
+            Delegate created = isCached && cached.Pointer == utility ? cached.Utility :
+                utility == IntPtr.Zero ? null : Marshal.GetDelegateForFunctionPointer<T>(utility);
+
+            _utilityDelegates[key] = new CachedUtility(generation, utility, created);
+            return (T)created;
         }
 
         /// <summary>
@@ -45,22 +132,250 @@ namespace ManagedApp
                 throw new InvalidOperationException($"Required native utility '{utilityName}' is missing");
         }
 
-        [UnmanagedCallersOnly]
-        internal static void Init(IntPtr hostUtilsLocator)
+        /// <summary>
+        /// Get the ordinal of a native utility in the table handed off by the native side, or -1 if it's not found (or
+        /// there's no table). The ordinal is only valid in the table of the <paramref name="generation"/> it's taken from.
+        /// </summary>
+        public static int GetNativeUtilityOrdinal(string utilityName, out uint generation)
+        {
+            ThrowIfUninitialized();
+
+            UtilityTable table = GetCurrentUtilityTable();
+            generation = table?.Generation ?? 0;
+
+            if (table == null || !table.Ordinals.TryGetValue(utilityName, out int ordinal))
+                return -1;
+
+            return ordinal;
+        }
+
+        /// <summary>
+        /// Get a raw pointer to a native utility by the ordinal taken from <see cref="GetNativeUtilityOrdinal(string, out uint)"/>,
+        /// along with the generation it was taken in. Throws <see cref="InvalidOperationException"/> if the native
+        /// utilities have changed since, as the ordinal may be of another utility by now.
+        /// </summary>
+        public static IntPtr GetNativeUtilityPointer(int ordinal, uint generation)
+        {
+            ThrowIfUninitialized();
+
+            UtilityTable table = GetCurrentUtilityTable() ??
+                throw new InvalidOperationException("The native side hasn't handed off the utility table");
+
+            if (table.Generation != generation)
+                throw new InvalidOperationException("The native utilities have changed since the ordinal was taken");
+
+            if ((uint)ordinal >= (uint)table.Pointers.Length)
+                throw new ArgumentOutOfRangeException(nameof(ordinal));
+
+            return table.Pointers[ordinal];
+        }
+
+        /// <summary>
+        /// Rebind the function pointers in <see cref="NativeUtilities"/> if the native utilities have changed since they were
+        /// bound. It happens automatically when the handed off table is refreshed, but without the table it must be called
+        /// manually after the native side changes the registry.
+        /// </summary>
+        public static void RefreshNativeUtilities()
+        {
+            ThrowIfUninitialized();
+
+            if (_utilityTable != null)
+            {
+                GetCurrentUtilityTable();
+                return;
+            }
+
+            lock (_utilityTableLock)
+            {
+                uint generation = ReadGeneration();
+                if (generation != _boundGeneration)
+                {
+                    _boundGeneration = generation;
+                    NativeUtilities.Bind();
+                }
+            }
+        }
+
+        /// <summary>
+        /// Used by the generated <see cref="NativeUtilities"/> to find the typed native utilities. Looks up by the ID if
+        /// the table is handed off, or by the name otherwise.
+        /// </summary>
+        internal static IntPtr FindTypedNativeUtility(uint utilityId, string utilityName)
+        {
+            UtilityTable table = _utilityTable;
+            if (table == null)
+                return LocateNativeUtility(utilityName);
+
+            return table.IdOrdinals.TryGetValue(utilityId, out int ordinal) ? table.Pointers[ordinal] : IntPtr.Zero;
+        }
+
+        // The entry points name the exports of a NativeAOT build (see NetHost::HostBackend::NativeAot), and are ignored otherwise.
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostComm_Init")]
+        internal static unsafe void Init(InitParameters* parameters)
         {
             if (_isInitialized)
                 throw new InvalidOperationException("Double init happened");
 
-            if (hostUtilsLocator == IntPtr.Zero)
+            if (parameters == null || parameters->UtilityLocator == null)
             {
                 Console.WriteLine("[HostComm::Init Failure] The native side didn't provide an utility locator. Crashing...");
                 Environment.Exit(-1);
             }
 
+            _utilityLocator = parameters->UtilityLocator;
+            _generation = parameters->Generation;
+            _tableProvider = parameters->TableProvider;
+
+            if (parameters->UtilityTable != null)
+                _utilityTable = new UtilityTable(parameters->UtilityTable, parameters->UtilityCount, parameters->TableGeneration);
+
+            _boundGeneration = ReadGeneration();
+            NativeUtilities.Bind();
+
             _isInitialized = true;
-            _utilityLocator = Marshal.GetDelegateForFunctionPointer<UtilityLocator>(hostUtilsLocator);
         }
 
+        /// <summary>
+        /// Called by the native HostComm::AttachCurrentThread() on a native thread, so the thread is set up in the runtime
+        /// before its first real call.
+        /// </summary>
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostComm_AttachThread")]
+        internal static void AttachThread()
+        {
+            // The managed thread object, and the allocation context of the thread.
+            GC.KeepAlive(Thread.CurrentThread);
+            GC.KeepAlive(new object());
+        }
+
+        /// <summary>
+        /// The calls counted into the native utilities so far, by all threads. Empty unless the native side has enabled
+        /// the utility stats (HostComm::EnableUtilityStats()).
+        /// </summary>
+        public static unsafe UtilityStats[] GetUtilityStats()
+        {
+            ThrowIfUninitialized();
+
+            var bucketUpperNs = stackalloc ulong[UtilityStatsEntry.LatencyBuckets];
+            var entries = Array.Empty<UtilityStatsEntry>();
+            int count;
+
+            // More utilities may start being counted between the calls.
+            while (true)
+            {
+                fixed (UtilityStatsEntry* buffer = entries)
+                    count = NativeUtilities.HostcommGetUtilityStats(buffer, entries.Length, bucketUpperNs);
+
+                if (count <= entries.Length)
+                    break;
+
+                entries = new UtilityStatsEntry[count];
+            }
+
+            var stats = new UtilityStats[count];
+            for (int i = 0; i < count; i++)
+            {
+                var histogram = new (ulong UpperNs, ulong Calls)[UtilityStatsEntry.LatencyBuckets];
+                for (int bucket = 0; bucket < histogram.Length; bucket++)
+                    histogram[bucket] = (bucketUpperNs[bucket], entries[i].Histogram[bucket]);
+
+                stats[i] = new UtilityStats
+                {
+                    Name = Marshal.PtrToStringUTF8((IntPtr)entries[i].Name),
+                    Calls = entries[i].Calls,
+                    SampledCalls = entries[i].SampledCalls,
+                    TotalNs = entries[i].TotalNs,
+                    P50Ns = entries[i].P50Ns,
+                    P90Ns = entries[i].P90Ns,
+                    P99Ns = entries[i].P99Ns,
+                    Histogram = histogram,
+                };
+            }
+
+            return stats;
+        }
+
+        /// <summary>
+        /// Called by the native side when it changes the registry after the init, so the typed bindings are rebound before
+        /// the change is used.
+        /// </summary>
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostComm_RefreshUtilities")]
+        internal static void RefreshUtilities()
+        {
+            RefreshNativeUtilities();
+        }
+
+        private static IntPtr FindNativeUtility(string utilityName)
+        {
+            UtilityTable table = GetCurrentUtilityTable();
+            if (table == null)
+                return LocateNativeUtility(utilityName);
+
+            return table.Ordinals.TryGetValue(utilityName, out int ordinal) ? table.Pointers[ordinal] : IntPtr.Zero;
+        }
+
+        /// <summary>
+        /// Ask the native side for a utility by its name, without a table. The name is encoded on the stack unless it's
+        /// unusually long, so it doesn't allocate.
+        /// </summary>
+        private static unsafe IntPtr LocateNativeUtility(string utilityName)
+        {
+            if (utilityName == null)
+                return IntPtr.Zero;
+
+            const int MaxStackBytes = 256;
+            int maxBytes = Encoding.UTF8.GetMaxByteCount(utilityName.Length) + 1;
+            Span<byte> name = maxBytes <= MaxStackBytes ? stackalloc byte[MaxStackBytes] : new byte[maxBytes];
+
+            name[Encoding.UTF8.GetBytes(utilityName, name)] = 0;
+
+            fixed (byte* pointer = name)
+                return _utilityLocator(pointer);
+        }
+
+        /// <summary>
+        /// Get the handed off utility table, taking a new copy from the native side if the registry has changed since.
+        /// Returns null if the native side didn't hand off the table.
+        /// </summary>
+        private static unsafe UtilityTable GetCurrentUtilityTable()
+        {
+            UtilityTable table = _utilityTable;
+            if (table == null || table.Generation == ReadGeneration())
+                return table;
+
+            lock (_utilityTableLock)
+            {
+                table = _utilityTable;
+                if (table.Generation == ReadGeneration())
+                    return table;
+
+                // The native side copies the entries out, and more utilities may be registered between the calls.
+                var entries = new UtilityTableEntry[table.Pointers.Length];
+                int count;
+                uint generation;
+
+                while (true)
+                {
+                    fixed (UtilityTableEntry* buffer = entries)
+                        count = _tableProvider(buffer, entries.Length, &generation);
+
+                    if (count <= entries.Length)
+                        break;
+
+                    entries = new UtilityTableEntry[count];
+                }
+
+                fixed (UtilityTableEntry* buffer = entries)
+                    table = new UtilityTable(buffer, count, generation);
+
+                _utilityTable = table;
+
+                NativeUtilities.Bind();
+                return table;
+            }
+        }
+
+        private static unsafe uint ReadGeneration() => Volatile.Read(ref *_generation);
+
         private static void ThrowIfUninitialized()
         {
             if (!_isInitialized)
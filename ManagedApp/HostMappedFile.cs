@@ -0,0 +1,205 @@
+﻿using System.Buffers;
+using System.Runtime.InteropServices;
+
+namespace ManagedApp
+{
+    /// <summary>
+    /// A file memory-mapped by the native side (see host_mapped_file.h), read window by window in place. Every window is
+    /// <see cref="WindowSize"/> bytes (except the last one), and at most <see cref="MaxMappedWindows"/> of them can be
+    /// mapped at once, so a window must be released before mapping one more above the limit.
+    /// It's only valid while the handler it's passed to runs.
+    /// </summary>
+    public sealed unsafe class MappedFileReader
+    {
+        private readonly void* _file;
+        private bool _isClosed;
+
+        public long Length { get; }
+        public long WindowSize { get; }
+        public long WindowCount { get; }
+        public int MaxMappedWindows { get; }
+
+        internal MappedFileReader(void* file, long length, long windowSize, int maxMappedWindows)
+        {
+            _file = file;
+            Length = length;
+            WindowSize = windowSize;
+            WindowCount = (length + windowSize - 1) / windowSize;
+            MaxMappedWindows = maxMappedWindows;
+        }
+
+        /// <summary>
+        /// Map a window (or take one more reference to it) and get its bytes. They stay valid until the window is released
+        /// as many times as it has been mapped.
+        /// </summary>
+        public ReadOnlySpan<byte> MapWindow(long index)
+        {
+            return new ReadOnlySpan<byte>(MapWindowPointer(index), GetWindowLength(index));
+        }
+
+        public void ReleaseWindow(long index)
+        {
+            ThrowIfClosed();
+            NativeUtilities.HostcommReleaseWindow(_file, index);
+        }
+
+        /// <summary>
+        /// Map `count` consecutive windows starting at `firstIndex` as a single sequence, for data crossing the window
+        /// boundaries. Release them with <see cref="ReleaseWindows"/>.
+        /// </summary>
+        public ReadOnlySequence<byte> MapWindows(long firstIndex, int count)
+        {
+            if (count <= 0 || firstIndex < 0 || firstIndex + count > WindowCount)
+                throw new ArgumentOutOfRangeException(nameof(count));
+
+            WindowSegment first = null;
+            WindowSegment last = null;
+
+            try
+            {
+                for (int i = 0; i < count; i++)
+                {
+                    long index = firstIndex + i;
+                    var segment = new WindowSegment(new WindowMemory(MapWindowPointer(index), GetWindowLength(index)), index * WindowSize);
+
+                    if (first == null)
+                        first = segment;
+                    else
+                        last.SetNext(segment);
+
+                    last = segment;
+                }
+            }
+            catch
+            {
+                for (WindowSegment segment = first; segment != null; segment = (WindowSegment)segment.Next)
+                    ReleaseWindow(segment.RunningIndex / WindowSize);
+
+                throw;
+            }
+
+            return new ReadOnlySequence<byte>(first, 0, last, last.Memory.Length);
+        }
+
+        public void ReleaseWindows(long firstIndex, int count)
+        {
+            for (int i = 0; i < count; i++)
+                ReleaseWindow(firstIndex + i);
+        }
+
+        /// <summary>
+        /// Map the windows one after another, and release each one once the action has processed it.
+        /// </summary>
+        public void ForEachWindow(ReadOnlySpanAction<byte, long> action)
+        {
+            for (long index = 0; index < WindowCount; index++)
+            {
+                ReadOnlySpan<byte> window = MapWindow(index);
+                try
+                {
+                    action(window, index * WindowSize);
+                }
+                finally
+                {
+                    ReleaseWindow(index);
+                }
+            }
+        }
+
+        internal void Close() => _isClosed = true;
+
+        private int GetWindowLength(long index)
+        {
+            if (index < 0 || index >= WindowCount)
+                throw new ArgumentOutOfRangeException(nameof(index));
+
+            return (int)Math.Min(WindowSize, Length - index * WindowSize);
+        }
+
+        private byte* MapWindowPointer(long index)
+        {
+            ThrowIfClosed();
+            GetWindowLength(index);
+
+            byte* window = (byte*)NativeUtilities.HostcommMapWindow(_file, index);
+            if (window == null)
+                throw new InvalidOperationException($"Failed to map the window {index}, or more than {MaxMappedWindows} windows would be mapped");
+
+            return window;
+        }
+
+        private void ThrowIfClosed()
+        {
+            if (_isClosed)
+                throw new ObjectDisposedException(nameof(MappedFileReader), "The file is only readable while its handler runs");
+        }
+
+        /// <summary>
+        /// Exposes a mapped window as Memory, without copying it. The native side owns the memory, so there's nothing to free.
+        /// </summary>
+        private sealed class WindowMemory : MemoryManager<byte>
+        {
+            private readonly byte* _pointer;
+            private readonly int _length;
+
+            public WindowMemory(byte* pointer, int length)
+            {
+                _pointer = pointer;
+                _length = length;
+            }
+
+            public override Span<byte> GetSpan() => new(_pointer, _length);
+            public override MemoryHandle Pin(int elementIndex = 0) => new(_pointer + elementIndex);
+            public override void Unpin() { }
+            protected override void Dispose(bool disposing) { }
+        }
+
+        private sealed class WindowSegment : ReadOnlySequenceSegment<byte>
+        {
+            public WindowSegment(MemoryManager<byte> memory, long runningIndex)
+            {
+                Memory = memory.Memory;
+                RunningIndex = runningIndex;
+            }
+
+            public void SetNext(WindowSegment next) => Next = next;
+        }
+    }
+
+    /// <summary>
+    /// The managed side of streaming memory-mapped files (see host_mapped_file.h).
+    /// </summary>
+    internal static unsafe class HostMappedFile
+    {
+        private static readonly HandlerRegistry<Func<MappedFileReader, long>> _handlers = new();
+
+        /// <summary>
+        /// Find a `static long Method(MappedFileReader file)` method and make it usable to stream files into.
+        /// </summary>
+        /// <returns>See <see cref="HandlerRegistry{THandler}.Register"/>.</returns>
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostMappedFile_RegisterHandler")]
+        internal static int RegisterHandler(IntPtr typeName, IntPtr methodName) => _handlers.Register(typeName, methodName);
+
+        /// <returns>0 if the handler has returned (its result is written to `result`), or -1 if it has thrown.</returns>
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostMappedFile_Run")]
+        internal static int Run(int handlerId, void* file, long length, long windowSize, int maxMappedWindows, long* result)
+        {
+            var reader = new MappedFileReader(file, length, windowSize, maxMappedWindows);
+
+            try
+            {
+                *result = _handlers[handlerId](reader);
+                return 0;
+            }
+            catch (Exception e)
+            {
+                Console.WriteLine($"[HostMappedFile::Run] The file handler has thrown an exception: {e}");
+                return -1;
+            }
+            finally
+            {
+                reader.Close();
+            }
+        }
+    }
+}
@@ -0,0 +1,182 @@
+﻿using System.Runtime;
+using System.Runtime.InteropServices;
+
+namespace ManagedApp
+{
+    /// <summary>
+    /// Publishes the GC heap statistics into native memory for the native side to read without calling in (see
+    /// host_memory.h), on a timer or on demand.
+    /// </summary>
+    internal static unsafe class HostMemory
+    {
+        /// <summary>
+        /// Mirrors HostComm::ManagedMemoryStats in host_memory.h.
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential)]
+        internal struct MemoryStats
+        {
+            public ulong Publications;
+            public ulong GcIndex;
+
+            public ulong HeapSizeBytes;
+            public ulong FragmentedBytes;
+            public ulong CommittedBytes;
+            public ulong CurrentHeapBytes;
+
+            public fixed ulong GenerationBytes[5];
+            public ulong PinnedObjects;
+
+            public ulong MemoryLoadBytes;
+            public ulong TotalAvailableMemoryBytes;
+            public ulong HighMemoryLoadThresholdBytes;
+            public ulong WorkingSetBytes;
+
+            public ulong TotalAllocatedBytes;
+            public fixed ulong Collections[3];
+            public double PauseTimePercentage;
+        }
+
+        // Serializes the publications, since there must be a single writer at a time.
+        private static readonly object _publishLock = new();
+
+        private static ulong* _sequence;
+        private static MemoryStats* _stats;
+        private static Timer _timer;
+
+        // Set on the timer's thread while it publishes, so stopping from a threshold handler doesn't wait for itself.
+        [ThreadStatic]
+        private static bool _isPublishingOnTimer;
+
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostMemory_Attach")]
+        internal static void Attach(ulong* sequence, MemoryStats* stats)
+        {
+            lock (_publishLock)
+            {
+                _sequence = sequence;
+                _stats = stats;
+            }
+        }
+
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostMemory_Start")]
+        internal static void Start(int intervalMs)
+        {
+            lock (_publishLock)
+            {
+                if (_timer == null)
+                    _timer = new Timer(_ => PublishOnTimer(), null, 0, intervalMs);
+                else
+                    _timer.Change(0, intervalMs);
+            }
+        }
+
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostMemory_Stop")]
+        internal static void Stop()
+        {
+            Timer timer;
+            lock (_publishLock)
+            {
+                timer = _timer;
+                _timer = null;
+            }
+
+            if (timer == null)
+                return;
+
+            if (_isPublishingOnTimer)
+            {
+                timer.Dispose();
+                return;
+            }
+
+            // Waited for outside of the lock, since the publication in progress may be about to take it.
+            using var drained = new ManualResetEvent(false);
+            if (timer.Dispose(drained))
+                drained.WaitOne();
+        }
+
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostMemory_Publish")]
+        internal static void Publish() => PublishAndNotify();
+
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostMemory_Collect")]
+        internal static void Collect(int isCompacting)
+        {
+            if (isCompacting != 0)
+                GCSettings.LargeObjectHeapCompactionMode = GCLargeObjectHeapCompactionMode.CompactOnce;
+
+            GC.Collect(GC.MaxGeneration, GCCollectionMode.Forced, blocking: true, compacting: isCompacting != 0);
+            PublishAndNotify();
+        }
+
+        private static void PublishOnTimer()
+        {
+            _isPublishingOnTimer = true;
+            try
+            {
+                PublishAndNotify();
+            }
+            finally
+            {
+                _isPublishingOnTimer = false;
+            }
+        }
+
+        private static void PublishAndNotify()
+        {
+            // An exception can't go through to the native side (nor be left unhandled on the timer's thread).
+            try
+            {
+                lock (_publishLock)
+                {
+                    if (_stats == null)
+                        return;
+
+                    MemoryStats stats = ReadStats();
+
+                    // Odd while the snapshot is being written, so the readers retry meanwhile.
+                    ulong sequence = *_sequence;
+                    Interlocked.Exchange(ref *_sequence, sequence + 1);
+                    stats.Publications = _stats->Publications + 1;
+                    *_stats = stats;
+                    Interlocked.Exchange(ref *_sequence, sequence + 2);
+                }
+
+                // The native threshold handlers may collect, which publishes again.
+                NativeUtilities.HostcommMemoryStatsPublished();
+            }
+            catch (Exception e)
+            {
+                Console.WriteLine($"[HostMemory::Publish] Failed to publish the memory statistics: {e}");
+            }
+        }
+
+        private static MemoryStats ReadStats()
+        {
+            GCMemoryInfo info = GC.GetGCMemoryInfo();
+
+            var stats = new MemoryStats
+            {
+                GcIndex = (ulong)info.Index,
+                HeapSizeBytes = (ulong)info.HeapSizeBytes,
+                FragmentedBytes = (ulong)info.FragmentedBytes,
+                CommittedBytes = (ulong)info.TotalCommittedBytes,
+                CurrentHeapBytes = (ulong)GC.GetTotalMemory(forceFullCollection: false),
+                PinnedObjects = (ulong)info.PinnedObjectsCount,
+                MemoryLoadBytes = (ulong)info.MemoryLoadBytes,
+                TotalAvailableMemoryBytes = (ulong)info.TotalAvailableMemoryBytes,
+                HighMemoryLoadThresholdBytes = (ulong)info.HighMemoryLoadThresholdBytes,
+                WorkingSetBytes = (ulong)Environment.WorkingSet,
+                TotalAllocatedBytes = (ulong)GC.GetTotalAllocatedBytes(),
+                PauseTimePercentage = info.PauseTimePercentage,
+            };
+
+            ReadOnlySpan<GCGenerationInfo> generations = info.GenerationInfo;
+            for (int i = 0; i < Math.Min(generations.Length, 5); i++)
+                stats.GenerationBytes[i] = (ulong)generations[i].SizeAfterBytes;
+
+            for (int i = 0; i < 3; i++)
+                stats.Collections[i] = (ulong)GC.CollectionCount(i);
+
+            return stats;
+        }
+    }
+}
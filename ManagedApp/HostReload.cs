@@ -0,0 +1,280 @@
+﻿using System.Reflection;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using System.Runtime.Loader;
+
+namespace ManagedApp
+{
+    /// <summary>
+    /// The managed side of reloadable assemblies (see host_reload.h). Every version of an assembly is loaded into its own
+    /// collectible load context, which is unloaded once the native side has swapped in a newer version. The registries
+    /// (see <see cref="HandlerRegistry{THandler}"/>) look the types of a reloadable assembly up in its current version, and
+    /// their methods are rebound to the new version on every swap.
+    /// </summary>
+    internal static unsafe class HostReload
+    {
+        /// <summary>
+        /// A registry holding methods that may be from a reloadable version.
+        /// </summary>
+        internal interface IRegistry
+        {
+            /// <summary>
+            /// Find the methods of a swapped out version in the version replacing it, without changing anything yet.
+            /// </summary>
+            /// <param name="replaceType">Gives the new version's type for a type of the old version (null if it has none), and
+            /// any other type as it is.</param>
+            /// <returns>Puts the found methods in place, or null if one of them isn't found.</returns>
+            Action PrepareRebind(Func<Type, Type> replaceType);
+        }
+
+        /// <summary>
+        /// Loads the assembly and its dependencies (the ones next to it) from memory, so the files aren't locked and can be
+        /// overwritten by the next version.
+        /// </summary>
+        private sealed class ReloadableLoadContext : AssemblyLoadContext
+        {
+            private readonly AssemblyDependencyResolver _resolver;
+
+            public ReloadableLoadContext(string assemblyPath, int id) : base($"Reloadable #{id}: {Path.GetFileName(assemblyPath)}", isCollectible: true)
+            {
+                _resolver = new AssemblyDependencyResolver(assemblyPath);
+            }
+
+            public Assembly LoadFromFileContents(string path)
+            {
+                using var assembly = new MemoryStream(File.ReadAllBytes(path));
+
+                string symbolsPath = Path.ChangeExtension(path, ".pdb");
+                if (!File.Exists(symbolsPath))
+                    return LoadFromStream(assembly);
+
+                using var symbols = new MemoryStream(File.ReadAllBytes(symbolsPath));
+                return LoadFromStream(assembly, symbols);
+            }
+
+            protected override Assembly Load(AssemblyName assemblyName)
+            {
+                // Not found next to the assembly means it's shared with the default context, like the framework.
+                string path = _resolver.ResolveAssemblyToPath(assemblyName);
+                return path != null ? LoadFromFileContents(path) : null;
+            }
+        }
+
+        private sealed class Version
+        {
+            public ReloadableLoadContext Context;
+            public Assembly Assembly;
+        }
+
+        /// <summary>
+        /// How many times the GC runs at most to collect an unloaded context.
+        /// </summary>
+        private const int UnloadAttempts = 10;
+
+        /// <summary>
+        /// Held by the registries while they register a method too, so a method is never registered from a version that is
+        /// being swapped out.
+        /// </summary>
+        internal static readonly object VersionsLock = new();
+
+        private static readonly Dictionary<int, Version> _versions = new();
+        private static int _nextId = 0;
+
+        // The version the types of each reloadable assembly (by its simple name) are looked up in.
+        private static readonly Dictionary<string, Version> _currentVersions = new();
+        private static readonly List<IRegistry> _registries = new();
+
+        internal static void AddRegistry(IRegistry registry)
+        {
+            lock (VersionsLock)
+                _registries.Add(registry);
+        }
+
+        /// <summary>
+        /// Look a type up by its name, in the current version if it's assembly qualified with a reloadable assembly.
+        /// Requires <see cref="VersionsLock"/> to be held.
+        /// </summary>
+        internal static Type FindRegisteredType(string typeName)
+        {
+            int separator = typeName.IndexOf(',');
+            if (separator >= 0 && _currentVersions.Count != 0)
+            {
+                var assemblyName = new AssemblyName(typeName.Substring(separator + 1).Trim());
+                if (_currentVersions.TryGetValue(assemblyName.Name, out Version version))
+                    return version.Assembly.GetType(typeName.Substring(0, separator).Trim());
+            }
+
+            return Type.GetType(typeName);
+        }
+
+        /// <summary>
+        /// Rebind the registries' methods of a version to the version replacing it, which becomes the one its assembly's
+        /// types are looked up in. Called right before the native side swaps the versions.
+        /// </summary>
+        /// <returns>1 if done, or 0 if a registered method isn't found in the new version (nothing is changed then).</returns>
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostReload_Swap")]
+        internal static int Swap(int oldId, int newId)
+        {
+            try
+            {
+                lock (VersionsLock)
+                {
+                    if (!_versions.TryGetValue(oldId, out Version oldVersion) || !_versions.TryGetValue(newId, out Version newVersion))
+                        return 0;
+
+                    var rebinds = new List<Action>(_registries.Count);
+                    foreach (IRegistry registry in _registries)
+                    {
+                        Action rebind = registry.PrepareRebind(type => ReplaceType(type, oldVersion, newVersion));
+                        if (rebind == null)
+                        {
+                            Console.WriteLine($"[HostReload::Swap] A registered method is missing in {newVersion.Context.Name}");
+                            return 0;
+                        }
+
+                        rebinds.Add(rebind);
+                    }
+
+                    foreach (Action rebind in rebinds)
+                        rebind();
+
+                    _currentVersions[newVersion.Assembly.GetName().Name] = newVersion;
+                    return 1;
+                }
+            }
+            catch (Exception e)
+            {
+                Console.WriteLine($"[HostReload::Swap] Failed to rebind the registered methods: {e}");
+                return 0;
+            }
+        }
+
+        /// <summary>
+        /// Load the assembly into a new collectible load context.
+        /// </summary>
+        /// <returns>The ID of the loaded version, or -1 if it couldn't be loaded.</returns>
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostReload_Load")]
+        internal static int Load(IntPtr assemblyPath)
+        {
+            string path = Path.GetFullPath(Marshal.PtrToStringAuto(assemblyPath));
+
+            try
+            {
+                lock (VersionsLock)
+                {
+                    int id = _nextId++;
+                    var context = new ReloadableLoadContext(path, id);
+                    var version = new Version { Context = context, Assembly = context.LoadFromFileContents(path) };
+
+                    // The first version is current right away, the next ones once they're swapped in.
+                    _versions[id] = version;
+                    _currentVersions.TryAdd(version.Assembly.GetName().Name, version);
+                    return id;
+                }
+            }
+            catch (Exception e)
+            {
+                Console.WriteLine($"[HostReload::Load] Failed to load {path}: {e}");
+                return -1;
+            }
+        }
+
+        /// <summary>
+        /// Get a pointer to an [UnmanagedCallersOnly] static method in a loaded version. The type is looked up in the
+        /// loaded assembly, unless its name is assembly qualified, in which case that assembly is loaded into the same context.
+        /// </summary>
+        /// <returns>The pointer, or zero if the method is not found (or isn't [UnmanagedCallersOnly]).</returns>
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostReload_GetFunction")]
+        internal static IntPtr GetFunction(int id, IntPtr typeName, IntPtr methodName)
+        {
+            Version version;
+            lock (VersionsLock)
+            {
+                if (!_versions.TryGetValue(id, out version))
+                    return IntPtr.Zero;
+            }
+
+            try
+            {
+                Type type = FindType(version, Marshal.PtrToStringAuto(typeName));
+                MethodInfo method = type?.GetMethod(Marshal.PtrToStringAuto(methodName), BindingFlags.Static | BindingFlags.Public | BindingFlags.NonPublic);
+
+                if (method == null || method.GetCustomAttribute<UnmanagedCallersOnlyAttribute>() == null)
+                    return IntPtr.Zero;
+
+                return method.MethodHandle.GetFunctionPointer();
+            }
+            catch (Exception)
+            {
+                return IntPtr.Zero;
+            }
+        }
+
+        /// <summary>
+        /// Unload a version, and wait a bit for its load context to be collected.
+        /// </summary>
+        /// <returns>1 if the context has been collected, 0 if something still references it (it's collected later then).</returns>
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostReload_Unload")]
+        internal static int Unload(int id)
+        {
+            WeakReference context = StartUnload(id);
+            if (context == null)
+                return 1;
+
+            for (int i = 0; i < UnloadAttempts && context.IsAlive; i++)
+            {
+                GC.Collect();
+                GC.WaitForPendingFinalizers();
+            }
+
+            return context.IsAlive ? 0 : 1;
+        }
+
+        // Not inlined, so no reference to the context stays on the stack of Unload.
+        [MethodImpl(MethodImplOptions.NoInlining)]
+        private static WeakReference StartUnload(int id)
+        {
+            Version version;
+            lock (VersionsLock)
+            {
+                if (!_versions.Remove(id, out version))
+                    return null;
+
+                string assemblyName = version.Assembly.GetName().Name;
+                if (_currentVersions.TryGetValue(assemblyName, out Version current) && current == version)
+                    _currentVersions.Remove(assemblyName);
+            }
+
+            version.Context.Unload();
+            return new WeakReference(version.Context);
+        }
+
+        private static Type ReplaceType(Type type, Version oldVersion, Version newVersion)
+        {
+            if (AssemblyLoadContext.GetLoadContext(type.Assembly) != oldVersion.Context)
+                return type;
+
+            Assembly assembly = newVersion.Context.LoadFromAssemblyName(type.Assembly.GetName());
+            if (AssemblyLoadContext.GetLoadContext(assembly) != newVersion.Context)
+                return null;
+
+            return assembly.GetType(type.FullName);
+        }
+
+        private static Type FindType(Version version, string typeName)
+        {
+            int separator = typeName.IndexOf(',');
+            if (separator < 0)
+                return version.Assembly.GetType(typeName);
+
+            var assemblyName = new AssemblyName(typeName.Substring(separator + 1).Trim());
+            Assembly assembly = version.Context.LoadFromAssemblyName(assemblyName);
+
+            // A type from an assembly shared with another context isn't a part of this version.
+            if (AssemblyLoadContext.GetLoadContext(assembly) != version.Context)
+                return null;
+
+            return assembly.GetType(typeName.Substring(0, separator).Trim());
+        }
+    }
+}
@@ -0,0 +1,53 @@
+﻿using System.Collections.Concurrent;
+using System.Text;
+
+namespace ManagedApp
+{
+    /// <summary>
+    /// Marks spans of managed code in the host's trace (see host_trace.h), on the same timeline as the native side's
+    /// entrypoint calls and utility calls. Nothing is recorded unless the native side runs a trace.
+    /// </summary>
+    /// <example>
+    /// using (HostTrace.Begin("Parse request"))
+    /// {
+    ///     ...
+    /// }
+    /// </example>
+    public static unsafe class HostTrace
+    {
+        private static readonly ConcurrentDictionary<string, uint> _nameIds = new();
+
+        /// <summary>
+        /// Ends the span on disposal. Spans must end on the thread they've begun on, so they can't span an await.
+        /// </summary>
+        public readonly struct Span : IDisposable
+        {
+            private readonly uint _nameId;
+
+            internal Span(uint nameId) => _nameId = nameId;
+
+            public void Dispose() => NativeUtilities.HostcommTraceEnd(_nameId);
+        }
+
+        /// <summary>
+        /// Get the ID of a span name, to begin spans without looking the name up every time.
+        /// </summary>
+        public static uint GetNameId(string name)
+        {
+            return _nameIds.GetOrAdd(name, static name =>
+            {
+                byte[] utf8 = Encoding.UTF8.GetBytes(name + '\0');
+                fixed (byte* pointer = utf8)
+                    return NativeUtilities.HostcommTraceName(pointer);
+            });
+        }
+
+        public static Span Begin(string name) => Begin(GetNameId(name));
+
+        public static Span Begin(uint nameId)
+        {
+            NativeUtilities.HostcommTraceBegin(nameId);
+            return new Span(nameId);
+        }
+    }
+}
@@ -0,0 +1,143 @@
+﻿using System.Reflection;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using System.Runtime.Loader;
+
+namespace ManagedApp
+{
+    /// <summary>
+    /// The managed side of warming methods up ahead of their first calls (see host_warmup.h).
+    /// </summary>
+    internal static unsafe class HostWarmup
+    {
+        [StructLayout(LayoutKind.Sequential)]
+        internal struct Entry
+        {
+            public IntPtr AssemblyPath;
+            public IntPtr TypeName;
+            public IntPtr MethodName;
+        }
+
+        // The counters of the native WarmupReport (the duration is measured there).
+        [StructLayout(LayoutKind.Sequential)]
+        internal struct Report
+        {
+            public int InitializedTypes;
+            public int PreparedMethods;
+            public int Failures;
+        }
+
+        private const BindingFlags AllDeclared = BindingFlags.Static | BindingFlags.Instance | BindingFlags.Public | BindingFlags.NonPublic | BindingFlags.DeclaredOnly;
+
+        /// <summary>
+        /// Run the static constructors of the entries' types, and JIT-compile their methods, in parallel.
+        /// </summary>
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_HostWarmup_Run")]
+        internal static void Run(Entry* entries, int count, int maxParallelism, Report* report)
+        {
+            var types = new List<Type>();
+            var methods = new List<MethodBase>();
+            int failures = 0;
+
+            for (int i = 0; i < count; i++)
+            {
+                // An exception can't go through to the native side, and a bad entry shouldn't keep the others from warming up.
+                try
+                {
+                    // The strings are char_t on the native side, which is what the Auto charset is on each platform too.
+                    string assemblyPath = Marshal.PtrToStringAuto(entries[i].AssemblyPath);
+                    string typeName = Marshal.PtrToStringAuto(entries[i].TypeName);
+                    string methodName = Marshal.PtrToStringAuto(entries[i].MethodName);
+
+                    Type type = FindType(assemblyPath, typeName);
+                    if (type == null || type.ContainsGenericParameters)
+                    {
+                        failures++;
+                        continue;
+                    }
+
+                    if (!types.Contains(type))
+                        types.Add(type);
+
+                    if (string.IsNullOrEmpty(methodName))
+                    {
+                        methods.AddRange(type.GetConstructors(AllDeclared).Where(IsPreparable));
+                        methods.AddRange(type.GetMethods(AllDeclared).Where(IsPreparable));
+                    }
+                    else
+                    {
+                        methods.AddRange(type.GetMethods(AllDeclared).Where(method => method.Name == methodName && IsPreparable(method)));
+                    }
+                }
+                catch (Exception)
+                {
+                    failures++;
+                }
+            }
+
+            var options = new ParallelOptions { MaxDegreeOfParallelism = maxParallelism > 0 ? maxParallelism : Environment.ProcessorCount };
+            int initializedTypes = 0;
+            int preparedMethods = 0;
+
+            // An exception can't go through to the native side.
+            Parallel.ForEach(types, options, type =>
+            {
+                try
+                {
+                    RuntimeHelpers.RunClassConstructor(type.TypeHandle);
+                    Interlocked.Increment(ref initializedTypes);
+                }
+                catch (Exception)
+                {
+                    Interlocked.Increment(ref failures);
+                }
+            });
+
+            Parallel.ForEach(methods.Distinct(), options, method =>
+            {
+                try
+                {
+                    RuntimeHelpers.PrepareMethod(method.MethodHandle);
+                    Interlocked.Increment(ref preparedMethods);
+                }
+                catch (Exception)
+                {
+                    Interlocked.Increment(ref failures);
+                }
+            });
+
+            report->InitializedTypes = initializedTypes;
+            report->PreparedMethods = preparedMethods;
+            report->Failures = failures;
+        }
+
+        /// <summary>
+        /// Look the type up in the load context the native side gets it from: the default one, or the isolated one
+        /// load_assembly_and_get_function_pointer has loaded the assembly into. Throws if the path or the name is malformed.
+        /// </summary>
+        private static Type FindType(string assemblyPath, string typeName)
+        {
+            AssemblyLoadContext context = string.IsNullOrEmpty(assemblyPath) ? AssemblyLoadContext.Default : null;
+
+            if (context == null)
+            {
+                string fullPath = Path.GetFullPath(assemblyPath);
+                context = AssemblyLoadContext.All.FirstOrDefault(loaded => loaded.Assemblies.Any(assembly =>
+                    !assembly.IsDynamic && string.Equals(assembly.Location, fullPath, StringComparison.OrdinalIgnoreCase)));
+
+                // Not loaded yet, so there's no telling which context it'll end up in.
+                if (context == null)
+                    return null;
+            }
+
+            using (context.EnterContextualReflection())
+                return Type.GetType(typeName);
+        }
+
+        // Generic definitions can't be compiled without their type arguments, and abstract methods have nothing to compile.
+        private static bool IsPreparable(MethodBase method)
+        {
+            return !method.IsAbstract && !method.ContainsGenericParameters;
+        }
+    }
+}
@@ -1,4 +1,6 @@
-﻿namespace ManagedApp
+﻿using System.Runtime.InteropServices;
+
+namespace ManagedApp
 {
     public class Program
     {
@@ -6,8 +8,16 @@
         {
             Console.WriteLine($"Hello, World in C#! The HostComm::IsInitialized is {HostComm.IsInitialized}.");
 
-            Action testUtility = HostComm.RequireNativeUtility<Action>("test_utility");
-            testUtility.Invoke();
+            using (HostTrace.Begin("Program.CallTestUtility"))
+                NativeUtilities.TestUtility();
+
+            // Empty unless the native side counts the utility calls (NETHOST_UTILITY_STATS).
+            foreach (UtilityStats stats in HostComm.GetUtilityStats().Where(stats => stats.Calls != 0))
+                Console.WriteLine(stats);
         }
+
+        // What the native side calls as Main in a NativeAOT build, which has no delegates to the managed methods.
+        [UnmanagedCallersOnly(EntryPoint = "ManagedApp_Program_Main")]
+        private static void MainExport() => Main();
     }
 }
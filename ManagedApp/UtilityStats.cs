@@ -0,0 +1,57 @@
+﻿using System.Runtime.InteropServices;
+
+namespace ManagedApp
+{
+    /// <summary>
+    /// The calls counted into a native utility (see host_utility_stats.h), from <see cref="HostComm.GetUtilityStats"/>.
+    /// </summary>
+    public sealed class UtilityStats
+    {
+        public string Name { get; init; }
+        public ulong Calls { get; init; }
+
+        /// <summary>
+        /// The calls that were timed (every few of each thread's calls are). The latencies are measured on these only.
+        /// </summary>
+        public ulong SampledCalls { get; init; }
+
+        /// <summary>
+        /// Estimated from the timed calls.
+        /// </summary>
+        public ulong TotalNs { get; init; }
+
+        /// <summary>
+        /// The upper bounds of the histogram buckets the percentiles fall into, so they may be up to twice the real ones.
+        /// </summary>
+        public ulong P50Ns { get; init; }
+        public ulong P90Ns { get; init; }
+        public ulong P99Ns { get; init; }
+
+        /// <summary>
+        /// The timed calls by their latency: each bucket counts the calls up to its upper bound (and above the previous one's).
+        /// </summary>
+        public (ulong UpperNs, ulong Calls)[] Histogram { get; init; }
+
+        public double MeanNs => Calls != 0 ? (double)TotalNs / Calls : 0;
+
+        public override string ToString() => $"{Name}: {Calls} calls, mean {MeanNs:F1} ns, p50 <= {P50Ns} ns, p90 <= {P90Ns} ns, p99 <= {P99Ns} ns";
+    }
+
+    /// <summary>
+    /// What the native side writes per utility (mirrors ManagedUtilityStats in host_utility_stats.cpp).
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    internal unsafe struct UtilityStatsEntry
+    {
+        public const int LatencyBuckets = 48;
+
+        public byte* Name;
+        public ulong Calls;
+        public ulong SampledCalls;
+        public ulong TotalNs;
+        public ulong P50Ns;
+        public ulong P90Ns;
+        public ulong P99Ns;
+        public fixed ulong Histogram[LatencyBuckets];
+    }
+}
@@ -14,9 +14,55 @@ if(NOT MSBUILD_OUTPUT)
     message(FATAL_ERROR "MSBUILD_OUTPUT is not set. Where to build the managed project?")
 endif()
 
-add_custom_target(BuildManagedProject
-    COMMAND ${CMAKE_COMMAND} -E echo "Building .NET project: ${CSPROJ_FILE}"
-    COMMAND dotnet build ${CSPROJ_FILE} -c ${CSPROJ_BUILD_CONFIGURATION} /p:OutDir=${MSBUILD_OUTPUT}
-    COMMENT "Building .NET managed project."
-    VERBATIM
-)
+# How the managed code is precompiled (so it isn't JIT-compiled on the first call after every start):
+# NONE - a plain `dotnet build`, everything is JIT-compiled.
+# R2R - `dotnet publish` with ReadyToRun code for every assembly of the project.
+# R2R_COMPOSITE - the same, but the project's assemblies are compiled into a single composite image, so cross-assembly
+#   calls are precompiled too. The framework isn't included: hostfxr doesn't initialize self-contained components, and
+#   the shared framework ships precompiled already.
+set(NETHOST_MANAGED_PRECOMPILE "NONE" CACHE STRING "Precompile the managed project: NONE, R2R or R2R_COMPOSITE")
+set_property(CACHE NETHOST_MANAGED_PRECOMPILE PROPERTY STRINGS NONE R2R R2R_COMPOSITE)
+
+if(NOT NETHOST_MANAGED_PRECOMPILE MATCHES "^(NONE|R2R|R2R_COMPOSITE)$")
+    message(FATAL_ERROR "NETHOST_MANAGED_PRECOMPILE must be NONE, R2R or R2R_COMPOSITE, but it's '${NETHOST_MANAGED_PRECOMPILE}'.")
+endif()
+message(STATUS "ManagedPrecompile = '${NETHOST_MANAGED_PRECOMPILE}'")
+
+# Build a .NET project into the output directory as a part of the specified (new) target.
+# Optionally `PRECOMPILE <mode>` (see NETHOST_MANAGED_PRECOMPILE) publishes it with precompiled code instead.
+function(add_managed_project TARGET_NAME PROJECT_FILE OUTPUT_DIR)
+    cmake_parse_arguments(PARSE_ARGV 3 MANAGED "" "PRECOMPILE" "")
+
+    if(NOT MANAGED_PRECOMPILE OR MANAGED_PRECOMPILE STREQUAL "NONE")
+        set(BUILD_COMMAND dotnet build ${PROJECT_FILE} -c ${CSPROJ_BUILD_CONFIGURATION} /p:OutDir=${OUTPUT_DIR})
+    else()
+        # ReadyToRun code is specific to the target platform, but still runs on the shared framework.
+        set(BUILD_COMMAND dotnet publish ${PROJECT_FILE} -c ${CSPROJ_BUILD_CONFIGURATION} -r ${TARGET_IDENTIFIER}
+            --self-contained false -o ${OUTPUT_DIR} /p:PublishReadyToRun=true)
+
+        if(MANAGED_PRECOMPILE STREQUAL "R2R_COMPOSITE")
+            list(APPEND BUILD_COMMAND /p:PublishReadyToRunComposite=true)
+        endif()
+    endif()
+
+    add_custom_target(${TARGET_NAME}
+        COMMAND ${CMAKE_COMMAND} -E echo "Building .NET project: ${PROJECT_FILE}"
+        COMMAND ${BUILD_COMMAND}
+        COMMENT "Building .NET managed project."
+        VERBATIM
+    )
+endfunction()
+
+# Publish a .NET project as a NativeAOT shared library (see NetHost::HostBackend::NativeAot) into the output directory,
+# as a part of the specified (new) target. The library has the runtime compiled in, so it's always self-contained.
+function(add_managed_aot_library TARGET_NAME PROJECT_FILE OUTPUT_DIR)
+    add_custom_target(${TARGET_NAME}
+        COMMAND ${CMAKE_COMMAND} -E echo "Publishing .NET project as a NativeAOT library: ${PROJECT_FILE}"
+        COMMAND dotnet publish ${PROJECT_FILE} -c ${CSPROJ_BUILD_CONFIGURATION} -r ${TARGET_IDENTIFIER} --self-contained true
+            -o ${OUTPUT_DIR} /p:PublishAot=true /p:NativeLib=Shared
+        COMMENT "Publishing .NET managed project with NativeAOT."
+        VERBATIM
+    )
+endfunction()
+
+add_managed_project(BuildManagedProject ${CSPROJ_FILE} ${MSBUILD_OUTPUT} PRECOMPILE ${NETHOST_MANAGED_PRECOMPILE})
@@ -0,0 +1,69 @@
+# Compare the startup of NativeNetHostApp builds, e.g. with and without precompiled managed code (NETHOST_MANAGED_PRECOMPILE).
+# Runs the app in every directory a few times with NETHOST_STARTUP_TRACE, and prints the time from the start of
+# NetHost::Init to the end of HostComm::Init and of the first Program.Main call. Requires CMake 3.19+ (string(JSON)).
+#
+# Usage: cmake -DAPP_DIRS="build-none;build-r2r" [-DRUNS=5] -P cmake/CompareStartup.cmake
+cmake_minimum_required(VERSION 3.19)
+
+if(NOT APP_DIRS)
+    message(FATAL_ERROR "APP_DIRS is not set. Which builds to compare?")
+endif()
+if(NOT RUNS)
+    set(RUNS 5)
+endif()
+
+set(PHASES "HostComm::Init" "ManagedApp.Program.Main")
+
+foreach(APP_DIR IN LISTS APP_DIRS)
+    get_filename_component(APP_DIR "${APP_DIR}" ABSOLUTE)
+    set(TRACE_FILE "${APP_DIR}/startup_trace.json")
+
+    foreach(PHASE IN LISTS PHASES)
+        set(TOTAL_${PHASE} 0)
+        set(MIN_${PHASE} "")
+    endforeach()
+
+    foreach(RUN RANGE 1 ${RUNS})
+        set(ENV{NETHOST_STARTUP_TRACE} "${TRACE_FILE}")
+        execute_process(COMMAND "${APP_DIR}/NativeNetHostApp${CMAKE_EXECUTABLE_SUFFIX}" WORKING_DIRECTORY "${APP_DIR}"
+            RESULT_VARIABLE RESULT OUTPUT_QUIET ERROR_QUIET)
+
+        if(NOT RESULT EQUAL 0)
+            message(FATAL_ERROR "NativeNetHostApp in '${APP_DIR}' has failed: ${RESULT}")
+        endif()
+
+        file(READ "${TRACE_FILE}" TRACE)
+        string(JSON EVENT_COUNT LENGTH "${TRACE}" traceEvents)
+        math(EXPR LAST_EVENT "${EVENT_COUNT} - 1")
+
+        foreach(PHASE IN LISTS PHASES)
+            # The end of the phase in microseconds, rounded down (math() only knows integers).
+            set(PHASE_END "")
+            foreach(INDEX RANGE 0 ${LAST_EVENT})
+                string(JSON NAME GET "${TRACE}" traceEvents ${INDEX} name)
+                if(NAME STREQUAL PHASE AND PHASE_END STREQUAL "")
+                    string(JSON TS GET "${TRACE}" traceEvents ${INDEX} ts)
+                    string(JSON DUR GET "${TRACE}" traceEvents ${INDEX} dur)
+                    string(REGEX REPLACE "\\..*" "" TS "${TS}")
+                    string(REGEX REPLACE "\\..*" "" DUR "${DUR}")
+                    math(EXPR PHASE_END "${TS} + ${DUR}")
+                endif()
+            endforeach()
+
+            if(PHASE_END STREQUAL "")
+                message(FATAL_ERROR "The startup trace of '${APP_DIR}' has no '${PHASE}' phase.")
+            endif()
+
+            math(EXPR TOTAL_${PHASE} "${TOTAL_${PHASE}} + ${PHASE_END}")
+            if(MIN_${PHASE} STREQUAL "" OR PHASE_END LESS MIN_${PHASE})
+                set(MIN_${PHASE} ${PHASE_END})
+            endif()
+        endforeach()
+    endforeach()
+
+    message("${APP_DIR}:")
+    foreach(PHASE IN LISTS PHASES)
+        math(EXPR AVERAGE "${TOTAL_${PHASE}} / ${RUNS}")
+        message("  until the end of ${PHASE}: ${AVERAGE} us on average, ${MIN_${PHASE}} us at best (${RUNS} runs)")
+    endforeach()
+endforeach()
@@ -0,0 +1,70 @@
+#include "arg_pack.h"
+
+#include <algorithm>
+
+namespace NetHost
+{
+	ArgArena& ArgArena::ForCurrentThread()
+	{
+		thread_local ArgArena arena;
+		return arena;
+	}
+
+	std::byte* ArgArena::Begin()
+	{
+		if (blocks.empty())
+			return nullptr;
+
+		offset = std::min((offset + 7) & ~size_t(7), blockSizes[block]);
+		return blocks[block].get() + offset;
+	}
+
+	std::byte* ArgArena::Extend(std::byte* start, size_t usedBytes, size_t extraBytes)
+	{
+		size_t neededBytes = usedBytes + extraBytes;
+
+		if (!blocks.empty())
+		{
+			size_t startOffset = (size_t)(start - blocks[block].get());
+			if (startOffset + neededBytes <= blockSizes[block])
+			{
+				offset = startOffset + neededBytes;
+				return start;
+			}
+		}
+
+		// Move the region to the next block, which is free, since every region after this one has been released.
+		size_t next = blocks.empty() ? 0 : block + 1;
+		if (next == blocks.size() || blockSizes[next] < neededBytes)
+		{
+			size_t blockSize = std::max({ MIN_BLOCK_SIZE, neededBytes, blocks.empty() ? 0 : blockSizes.back() * 2 });
+			if (next == blocks.size())
+			{
+				blocks.push_back(std::make_unique<std::byte[]>(blockSize));
+				blockSizes.push_back(blockSize);
+			}
+			else
+			{
+				blocks[next] = std::make_unique<std::byte[]>(blockSize);
+				blockSizes[next] = blockSize;
+			}
+		}
+
+		std::byte* moved = blocks[next].get();
+		if (usedBytes != 0)
+			memcpy(moved, start, usedBytes);
+
+		block = next;
+		offset = neededBytes;
+		return moved;
+	}
+
+	size_t ArgArena::GetCapacity() const
+	{
+		size_t capacity = 0;
+		for (size_t blockSize : blockSizes)
+			capacity += blockSize;
+
+		return capacity;
+	}
+}
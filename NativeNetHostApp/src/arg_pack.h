@@ -0,0 +1,131 @@
+#pragma once
+#include <span>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+#include "net_hosting.h"
+
+// Typed arguments for the default signature (DefaultDNetCallback: `int func(void* args, int sizeBytes)`), without laying
+// the buffer out by hand or allocating it per call. An ArgPack serializes the arguments into a thread-local bump arena,
+// and gives the space back when it's destroyed, so once the arena has grown to fit, packing never allocates. The managed
+// side reads the arguments in place with ManagedApp.ArgReader, in the same order they were added.
+//
+// The layout (mirrored by ArgReader.cs): every item starts at an 8-byte aligned offset. A value is stored as its bytes,
+// and a span as an int32 element count, padded to 8 bytes, followed by the elements.
+
+namespace NetHost
+{
+	// The per-thread memory packs are built in. Packs are released in the reverse order they're created in (it's a stack),
+	// so a pack built while another one is still in use (e.g. in a native utility called during a managed call) is fine.
+	class ArgArena
+	{
+	public:
+		// Where the arena was at some point, to go back to.
+		struct Mark
+		{
+			size_t block;
+			size_t offset;
+		};
+
+	private:
+		static constexpr size_t MIN_BLOCK_SIZE = 4096;
+
+		// A block is never moved or freed while any space of it is in use. The blocks after the current one are kept
+		// for later, so a thread ends up with the blocks it needs and stops allocating.
+		std::vector<std::unique_ptr<std::byte[]>> blocks;
+		std::vector<size_t> blockSizes;
+		size_t block = 0;
+		size_t offset = 0;
+
+	public:
+		static ArgArena& ForCurrentThread();
+
+		ArgArena(const ArgArena&) = delete;
+		ArgArena& operator=(const ArgArena&) = delete;
+
+		Mark GetMark() const { return { block, offset }; }
+		void Rewind(const Mark& mark) { block = mark.block; offset = mark.offset; }
+
+		// Make room for `extraBytes` more bytes of a region starting at `start`, which must be the last one taken. The
+		// region is moved to another block if it doesn't fit into the current one.
+		/// @return The (possibly new) start of the region.
+		std::byte* Extend(std::byte* start, size_t usedBytes, size_t extraBytes);
+
+		// Start a new region at the current position.
+		std::byte* Begin();
+
+		// The number of bytes the arena has allocated.
+		size_t GetCapacity() const;
+
+	private:
+		ArgArena() = default;
+	};
+
+	class ArgPack
+	{
+	private:
+		ArgArena& arena;
+		ArgArena::Mark mark;
+		std::byte* data;
+		size_t size = 0;
+
+	public:
+		ArgPack() : arena(ArgArena::ForCurrentThread()), mark(arena.GetMark()), data(arena.Begin()) {}
+		~ArgPack() { arena.Rewind(mark); }
+
+		ArgPack(const ArgPack&) = delete;
+		ArgPack& operator=(const ArgPack&) = delete;
+
+		template<typename T>
+		ArgPack& Add(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "Only blittable values can be packed (spans and strings have their own methods)");
+
+			memcpy(Allocate(sizeof(T)), &value, sizeof(T));
+			return *this;
+		}
+
+		// Like `pack.AddSpan(std::span{ vector })`.
+		template<typename T, size_t Extent>
+		ArgPack& AddSpan(std::span<T, Extent> values)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "Only spans of blittable values can be packed");
+
+			int32_t count = (int32_t)values.size();
+			memcpy(Allocate(8), &count, sizeof(count));
+
+			std::byte* elements = Allocate(values.size_bytes());
+			if (!values.empty())
+				memcpy(elements, values.data(), values.size_bytes());
+
+			return *this;
+		}
+
+		// Read with ArgReader.ReadUtf8() or ReadString() on the managed side.
+		ArgPack& AddString(std::string_view text)
+		{
+			return AddSpan(std::span<const char>{ text.data(), text.size() });
+		}
+
+		void* GetData() const { return data; }
+		int32_t GetSize() const { return (int32_t)size; }
+
+		// Call a managed method with the default signature with the packed arguments.
+		int Call(const ManagedFunction<int(void*, int)>& function) const { return function(data, (int)size); }
+		int Call(DefaultDNetCallback function) const { return function(data, (int)size); }
+
+	private:
+		std::byte* Allocate(size_t bytes)
+		{
+			size_t offset = (size + 7) & ~size_t(7);
+			data = arena.Extend(data, size, offset + bytes - size);
+			size = offset + bytes;
+			return data + offset;
+		}
+	};
+}
@@ -0,0 +1,69 @@
+#include "host_async.h"
+#include "host_comm.h"
+#include "host_worker_pool.h"
+
+#include <string>
+#include <cstring>
+#include <stdexcept>
+
+// (entrypointId, args, sizeBytes, token)
+static const HostComm::CachedHostMethod<void(int32_t, const std::byte*, int32_t, uint64_t)> g_start{ NH_STR("ManagedApp.HostAsync"), NH_STR("Start") };
+
+namespace HostComm
+{
+	AsyncExecutor ExecutorOf(WorkerPool& pool)
+	{
+		return [&pool](std::coroutine_handle<> handle)
+		{
+			pool.Post([handle]() { handle.resume(); });
+		};
+	}
+
+	int32_t RegisterAsyncEntrypoint(const char_t* typeName, const char_t* methodName)
+	{
+		return RegisterHostHandler(NH_STR("ManagedApp.HostAsync"), NH_STR("RegisterEntrypoint"), typeName, methodName, "static Task<byte[]> Method(byte[])");
+	}
+
+	bool ManagedCall::await_suspend(std::coroutine_handle<> handle)
+	{
+		awaiter = handle;
+
+		// The managed side may complete the call before Start returns, on this thread or on any other one.
+		g_start(entrypointId, args.data(), (int32_t)args.size(), (uint64_t)(uintptr_t)this);
+
+		return !isFinished.exchange(true, std::memory_order_acq_rel);
+	}
+
+	std::vector<std::byte> ManagedCall::await_resume()
+	{
+		if (status != AsyncStatus::Succeeded)
+		{
+			std::string message = status == AsyncStatus::Canceled ? "The managed task has been canceled" : std::string((const char*)result.data(), result.size());
+			throw ManagedTaskError{ status, message };
+		}
+
+		return std::move(result);
+	}
+
+	void DELEGATE_CALLTYPE Builtins::CompleteAsync(uint64_t token, int32_t status, const void* result, int32_t sizeBytes)
+	{
+		auto call = (ManagedCall*)(uintptr_t)token;
+		call->status = (AsyncStatus)status;
+		call->result.resize(sizeBytes);
+		if (sizeBytes != 0)
+			memcpy(call->result.data(), result, sizeBytes);
+
+		// The awaiting thread hasn't suspended yet, and goes on by itself.
+		if (!call->isFinished.exchange(true, std::memory_order_acq_rel))
+			return;
+
+		// The call (in the coroutine frame) may be gone as soon as the coroutine is resumed, even before the executor returns.
+		std::coroutine_handle<> awaiter = call->awaiter;
+		AsyncExecutor executor = std::move(call->executor);
+
+		if (executor)
+			executor(awaiter);
+		else
+			awaiter.resume();
+	}
+}
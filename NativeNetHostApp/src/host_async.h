@@ -0,0 +1,116 @@
+#pragma once
+#include <span>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <coroutine>
+#include <exception>
+#include <stdexcept>
+#include <functional>
+
+#include "net_hosting.h"
+
+// Awaiting managed async methods from C++20 coroutines. Calling a managed method through a pointer blocks the native
+// thread until it returns, so a method doing async work would park a thread per call. Instead, `co_await CallAsync(...)`
+// starts the managed Task (ManagedApp.HostAsync) and suspends the coroutine. When the Task completes, the managed side
+// calls back the `hostcomm_complete_async` native utility with the result, which resumes the coroutine on an executor.
+// So a few native threads can keep any number of managed operations in flight.
+//
+// Async methods have the signature `static Task<byte[]> Method(byte[] args)`: the arguments are copied into the array
+// before the method is called, and the returned bytes are what co_await evaluates to.
+
+namespace HostComm
+{
+	class WorkerPool;
+
+	// The result of a managed Task, passed to the `hostcomm_complete_async` utility (mirrored by HostAsync.cs).
+	enum class AsyncStatus : int32_t
+	{
+		Succeeded = 0,
+		Faulted = 1, // The result is the exception as UTF-8 text.
+		Canceled = 2,
+	};
+
+	// Thrown from co_await when the managed Task has faulted or has been canceled.
+	class ManagedTaskError : public std::runtime_error
+	{
+	private:
+		AsyncStatus status;
+
+	public:
+		ManagedTaskError(AsyncStatus status, const std::string& message) : std::runtime_error(message), status(status) {}
+
+		AsyncStatus GetStatus() const { return status; }
+	};
+
+	// Resumes a coroutine somewhere, like on a thread of a WorkerPool. Without an executor, a coroutine is resumed on the
+	// thread that completes its managed Task (usually a thread pool thread of the runtime).
+	typedef std::function<void(std::coroutine_handle<>)> AsyncExecutor;
+
+	// An executor posting the resumed coroutines to the pool. The pool must outlive the calls using it.
+	AsyncExecutor ExecutorOf(WorkerPool& pool);
+
+	// Register a managed method for async calls. Requires HostComm to be initialized.
+	/// @param typeName Assembly qualified type name, like "ManagedApp.Program, ManagedApp".
+	/// @return The ID of the entrypoint to call with CallAsync().
+	int32_t RegisterAsyncEntrypoint(const char_t* typeName, const char_t* methodName);
+
+	namespace Builtins
+	{
+		void DELEGATE_CALLTYPE CompleteAsync(uint64_t token, int32_t status, const void* result, int32_t sizeBytes);
+	}
+
+	// The awaitable of a single managed async call. It's its own in-flight state (the managed side holds its address), so
+	// it can't be copied or moved, and it's meant to be awaited right where CallAsync() returns it.
+	class ManagedCall
+	{
+	private:
+		int32_t entrypointId;
+		std::span<const std::byte> args;
+		AsyncExecutor executor;
+
+		std::coroutine_handle<> awaiter;
+		std::atomic<bool> isFinished{ false }; // Set by whoever comes second, the suspending coroutine or the completion.
+		AsyncStatus status = AsyncStatus::Succeeded;
+		std::vector<std::byte> result;
+
+		friend void DELEGATE_CALLTYPE Builtins::CompleteAsync(uint64_t token, int32_t status, const void* result, int32_t sizeBytes);
+
+	public:
+		ManagedCall(int32_t entrypointId, std::span<const std::byte> args, AsyncExecutor executor)
+			: entrypointId(entrypointId), args(args), executor(std::move(executor)) {}
+
+		ManagedCall(const ManagedCall&) = delete;
+		ManagedCall& operator=(const ManagedCall&) = delete;
+
+		bool await_ready() const noexcept { return false; }
+
+		// Starts the managed Task. Returns false (so the coroutine goes on right away) if it has completed already.
+		bool await_suspend(std::coroutine_handle<> handle);
+
+		// The bytes returned by the managed Task. Throws ManagedTaskError if it has faulted or has been canceled.
+		std::vector<std::byte> await_resume();
+	};
+
+	// Call a managed async method: `std::vector<std::byte> result = co_await CallAsync(id, &args, sizeof(args));`.
+	// The arguments must stay valid until the call is awaited, which is always the case when awaiting it right away.
+	inline ManagedCall CallAsync(int32_t entrypointId, const void* args, int32_t sizeBytes, AsyncExecutor executor = {})
+	{
+		return ManagedCall{ entrypointId, std::span<const std::byte>{ (const std::byte*)args, (size_t)sizeBytes }, std::move(executor) };
+	}
+
+	// The simplest coroutine type to await managed calls in: it starts running right away, and nothing waits for it, so
+	// signaling its completion is up to the coroutine itself (e.g. with a latch). An exception escaping it terminates.
+	struct DetachedTask
+	{
+		struct promise_type
+		{
+			DetachedTask get_return_object() noexcept { return {}; }
+			std::suspend_never initial_suspend() noexcept { return {}; }
+			std::suspend_never final_suspend() noexcept { return {}; }
+			void return_void() noexcept {}
+			void unhandled_exception() noexcept { std::terminate(); }
+		};
+	};
+}
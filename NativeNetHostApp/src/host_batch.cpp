@@ -0,0 +1,99 @@
+#include "host_batch.h"
+#include "host_comm.h"
+
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+// (records, count, args, results), where the records are CallBatch::Record (mirrored by HostBatch.cs).
+static const HostComm::CachedHostMethod<void(const void*, int32_t, const std::byte*, int32_t*)> g_dispatch{ NH_STR("ManagedApp.HostBatch"), NH_STR("Dispatch") };
+
+namespace HostComm
+{
+	int32_t RegisterBatchEntrypoint(const char_t* typeName, const char_t* methodName)
+	{
+		return RegisterHostHandler(NH_STR("ManagedApp.HostBatch"), NH_STR("RegisterEntrypoint"), typeName, methodName, "static int Method(IntPtr, int)");
+	}
+
+	CallBatch& CallBatch::ForCurrentThread()
+	{
+		thread_local CallBatch batch;
+		return batch;
+	}
+
+	size_t CallBatch::Append(int32_t entrypointId, const void* callArgs, int32_t sizeBytes)
+	{
+		if (entrypointId < 0 || sizeBytes < 0 || (callArgs == nullptr && sizeBytes != 0))
+			throw std::invalid_argument{ "The entrypoint ID and the size of the arguments can't be negative, nor the arguments null" };
+
+		// Keep every argument block 8-byte aligned, so the managed side can read it as structs.
+		size_t offset = (args.size() + 7) & ~size_t(7);
+		if (offset + sizeBytes > UINT32_MAX)
+			throw std::length_error{ "The arguments of a batch can't take more than UINT32_MAX bytes, flush it more often" };
+
+		if (records.empty() && policy.maxDelay.count() != 0)
+			firstAppendTime = std::chrono::steady_clock::now();
+
+		args.resize(offset + sizeBytes);
+		if (sizeBytes != 0)
+			memcpy(args.data() + offset, callArgs, sizeBytes);
+
+		records.push_back(Record{ entrypointId, sizeBytes, (uint32_t)offset, 0 });
+		size_t index = records.size() - 1;
+
+		bool isFull = (policy.maxCalls != 0 && records.size() >= policy.maxCalls) ||
+			(policy.maxBytes != 0 && args.size() >= policy.maxBytes);
+
+		if (isFull || IsDue())
+			Flush();
+
+		return index;
+	}
+
+	bool CallBatch::IsDue() const
+	{
+		if (records.empty() || policy.maxDelay.count() == 0)
+			return false;
+
+		return std::chrono::steady_clock::now() - firstAppendTime >= policy.maxDelay;
+	}
+
+	bool CallBatch::FlushIfDue()
+	{
+		if (!IsDue())
+			return false;
+
+		Flush();
+		return true;
+	}
+
+	std::span<const int32_t> CallBatch::Flush()
+	{
+		static_assert(sizeof(Record) == 16, "The record layout is shared with the managed side");
+
+		if (records.empty())
+			return {};
+
+		results.resize(records.size());
+
+		auto start = std::chrono::steady_clock::now();
+		g_dispatch(records.data(), (int32_t)records.size(), args.data(), results.data());
+		uint64_t elapsedNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+		stats.batches++;
+		stats.calls += records.size();
+		stats.totalFlushNs += elapsedNs;
+		stats.lastFlushNs = elapsedNs;
+		stats.maxFlushNs = std::max(stats.maxFlushNs, elapsedNs);
+
+		records.clear();
+		args.clear();
+
+		if (flushHandler)
+			flushHandler(results);
+
+		return results;
+	}
+}
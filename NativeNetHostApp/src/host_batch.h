@@ -0,0 +1,105 @@
+#pragma once
+#include <span>
+#include <chrono>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "net_hosting.h"
+
+// Batched calls into the managed side. Every call through a pointer to a managed method pays for the full transition
+// into the runtime, which dominates when the calls are tiny. Instead, the calls can be appended to a per-thread batch
+// and flushed at once: the managed dispatcher (ManagedApp.HostBatch) runs them in a loop after a single transition and
+// writes their results back.
+//
+// Batched methods use the default signature (see net_hosting.h): `static int Method(IntPtr args, int sizeBytes)`, and
+// their arguments are copied into the batch when appended, so the caller doesn't need to keep them alive.
+
+namespace HostComm
+{
+	// When a batch is flushed automatically (on appending a call). A batch can always be flushed manually too.
+	struct BatchFlushPolicy
+	{
+		size_t maxCalls = 256; // Flush once this many calls are appended (0 means no limit).
+		size_t maxBytes = 64 * 1024; // Flush once the arguments of the appended calls take this many bytes (0 means no limit).
+		std::chrono::microseconds maxDelay{ 0 }; // Flush once the first appended call has waited this long (0 means no limit).
+	};
+
+	struct BatchStats
+	{
+		uint64_t batches = 0;
+		uint64_t calls = 0;
+
+		// The time a flush takes (the transition plus all calls in the batch), in nanoseconds.
+		uint64_t totalFlushNs = 0;
+		uint64_t maxFlushNs = 0;
+		uint64_t lastFlushNs = 0;
+	};
+
+	// Register a managed method for batched calls. Requires HostComm to be initialized. The method is found by reflection,
+	// so it throws std::runtime_error on the NativeAot backend, which can't guarantee the method is still there.
+	/// @param typeName Assembly qualified type name, like "ManagedApp.Program, ManagedApp".
+	/// @return The ID of the entrypoint to append calls with.
+	int32_t RegisterBatchEntrypoint(const char_t* typeName, const char_t* methodName);
+
+	// The value written as a result of a batched call that has thrown an exception.
+	constexpr int32_t BATCH_CALL_FAILED = INT32_MIN;
+
+	class CallBatch
+	{
+	public:
+		// Called after every flush with the results of the flushed calls, in the same order they were appended.
+		typedef std::function<void(std::span<const int32_t> results)> FlushHandler;
+
+	private:
+		struct Record
+		{
+			int32_t entrypointId;
+			int32_t sizeBytes;
+			uint32_t argsOffset;
+			uint32_t reserved;
+		};
+
+		std::vector<Record> records;
+		std::vector<std::byte> args;
+		std::vector<int32_t> results;
+
+		BatchFlushPolicy policy;
+		FlushHandler flushHandler;
+		std::chrono::steady_clock::time_point firstAppendTime;
+
+		BatchStats stats;
+
+	public:
+		// Each thread has its own batch, so appending never locks.
+		static CallBatch& ForCurrentThread();
+
+		CallBatch(const CallBatch&) = delete;
+		CallBatch& operator=(const CallBatch&) = delete;
+
+		void SetFlushPolicy(const BatchFlushPolicy& newPolicy) { policy = newPolicy; }
+		void SetFlushHandler(FlushHandler handler) { flushHandler = std::move(handler); }
+
+		// Append a call to the batch, and flush it if the policy says so. Throws std::invalid_argument if the ID or the size
+		// is negative. An ID no entrypoint has gets BATCH_CALL_FAILED as its result.
+		/// @return The index of the call's result in the batch it ends up in.
+		size_t Append(int32_t entrypointId, const void* callArgs, int32_t sizeBytes);
+
+		// Flush the batch only if the time-based policy says so. Useful to call periodically when nothing is appended.
+		bool FlushIfDue();
+
+		// Run all appended calls with a single transition into the managed side.
+		/// @return The results of the calls, valid until the next call is appended.
+		std::span<const int32_t> Flush();
+
+		size_t GetPendingCalls() const { return records.size(); }
+		const BatchStats& GetStats() const { return stats; }
+		void ResetStats() { stats = {}; }
+
+	private:
+		CallBatch() = default;
+
+		bool IsDue() const;
+	};
+}
@@ -0,0 +1,271 @@
+#include "host_buffer_pool.h"
+#include "host_comm.h"
+
+#include <climits>
+#include <stdexcept>
+#include <algorithm>
+
+// (handlerId, poolId, bufferId, generation, length)
+static const HostComm::CachedHostMethod<int32_t(int32_t, int32_t, int32_t, uint32_t, int32_t)> g_deliver{ NH_STR("ManagedApp.HostBufferPool"), NH_STR("Deliver") };
+static std::atomic<uint64_t> g_leakedBuffers{ 0 };
+
+namespace HostComm
+{
+	BufferPool::BufferPool(std::vector<BufferSizeClass> sizeClasses)
+	{
+		std::sort(sizeClasses.begin(), sizeClasses.end(), [](const BufferSizeClass& a, const BufferSizeClass& b) { return a.bufferSize < b.bufferSize; });
+
+		uint64_t totalBuffers = 0;
+		for (const BufferSizeClass& sizeClass : sizeClasses)
+		{
+			if (sizeClass.bufferSize == 0 || sizeClass.bufferCount == 0)
+				throw std::invalid_argument{ "Every size class must have buffers of at least a byte" };
+
+			if (sizeClass.bufferSize > INT32_MAX)
+				throw std::invalid_argument{ "The buffers can't be larger than INT32_MAX bytes" };
+
+			totalBuffers += sizeClass.bufferCount;
+		}
+
+		if (sizeClasses.empty() || totalBuffers >= INT32_MAX)
+			throw std::invalid_argument{ "The pool must have at least one, and less than INT32_MAX buffers" };
+
+		classCount = sizeClasses.size();
+		classes = std::make_unique<SizeClass[]>(classCount);
+		bufferCount = (uint32_t)totalBuffers;
+		buffers = std::make_unique<Buffer[]>(bufferCount);
+
+		std::vector<int32_t> sizes;
+		std::vector<int32_t> counts;
+		uint32_t firstBuffer = 0;
+
+		for (size_t i = 0; i < classCount; i++)
+		{
+			classes[i].bufferSize = sizeClasses[i].bufferSize;
+			classes[i].firstBuffer = firstBuffer;
+			classes[i].bufferCount = sizeClasses[i].bufferCount;
+
+			for (uint32_t id = firstBuffer; id < firstBuffer + sizeClasses[i].bufferCount; id++)
+				buffers[id].sizeClass = (uint32_t)i;
+
+			firstBuffer += sizeClasses[i].bufferCount;
+			sizes.push_back((int32_t)sizeClasses[i].bufferSize);
+			counts.push_back((int32_t)sizeClasses[i].bufferCount);
+		}
+
+		// The managed side lends every buffer through Lend() before returning.
+		auto create = GetHostMethod<int32_t(void*, const int32_t*, const int32_t*, int32_t)>(NH_STR("ManagedApp.HostBufferPool"), NH_STR("Create"));
+		managedId = create(this, sizes.data(), counts.data(), (int32_t)classCount);
+		if (managedId < 0)
+			throw std::runtime_error{ "The managed side has failed to allocate the buffers of the pool" };
+
+		// Pushed in reverse, so the buffers are rented in the order they've been allocated in.
+		for (size_t i = 0; i < classCount; i++)
+		{
+			for (uint32_t id = classes[i].firstBuffer + classes[i].bufferCount; id-- > classes[i].firstBuffer;)
+				Push(classes[i], id);
+		}
+	}
+
+	BufferPool::~BufferPool()
+	{
+		uint32_t leaked = 0;
+		for (uint32_t id = 0; id < bufferCount; id++)
+		{
+			if ((buffers[id].state.load(std::memory_order_acquire) & STATE_MASK) != FREE)
+				leaked++;
+		}
+
+		g_leakedBuffers.fetch_add(leaked, std::memory_order_relaxed);
+
+		auto destroy = GetHostMethod<void(int32_t, int32_t)>(NH_STR("ManagedApp.HostBufferPool"), NH_STR("Destroy"));
+		destroy(managedId, leaked != 0 ? 1 : 0);
+	}
+
+	bool BufferPool::Pop(SizeClass& sizeClass, uint32_t& bufferId)
+	{
+		uint64_t head = sizeClass.freeHead.load(std::memory_order_acquire);
+		while (true)
+		{
+			uint32_t first = (uint32_t)head;
+			if (first == 0)
+				return false;
+
+			// The next buffer may be stale if another thread has popped this one meanwhile, but then the tag has changed too.
+			uint32_t next = buffers[first - 1].next.load(std::memory_order_relaxed);
+			uint64_t newHead = ((head >> 32) + 1) << 32 | next;
+
+			if (sizeClass.freeHead.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire))
+			{
+				bufferId = first - 1;
+				return true;
+			}
+		}
+	}
+
+	void BufferPool::Push(SizeClass& sizeClass, uint32_t bufferId)
+	{
+		uint64_t head = sizeClass.freeHead.load(std::memory_order_relaxed);
+		while (true)
+		{
+			buffers[bufferId].next.store((uint32_t)head, std::memory_order_relaxed);
+			uint64_t newHead = ((head >> 32) + 1) << 32 | (bufferId + 1);
+
+			if (sizeClass.freeHead.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed))
+				return;
+		}
+	}
+
+	uint32_t BufferPool::GetInUse(const SizeClass& sizeClass, uint64_t rents)
+	{
+		// Other threads may rent and return in between reading the two, so it's only exact once the pool is quiet.
+		uint64_t returns = sizeClass.returns.load(std::memory_order_relaxed);
+		return returns >= rents ? 0 : (uint32_t)std::min<uint64_t>(rents - returns, sizeClass.bufferCount);
+	}
+
+	PooledBuffer BufferPool::Rent(size_t minBytes)
+	{
+		size_t firstFit = 0;
+		while (firstFit < classCount && classes[firstFit].bufferSize < minBytes)
+			firstFit++;
+
+		if (firstFit == classCount)
+			throw std::length_error{ "No size class of the pool has buffers that large" };
+
+		for (size_t i = firstFit; i < classCount; i++)
+		{
+			uint32_t id;
+			if (!Pop(classes[i], id))
+				continue;
+
+			// Only the renter has the buffer now, so its state can't change in between.
+			SizeClass& sizeClass = classes[i];
+			uint32_t generation = ((buffers[id].state.load(std::memory_order_relaxed) >> STATE_BITS) + 1) & (UINT32_MAX >> STATE_BITS);
+			buffers[id].state.store(MakeState(generation, HELD_BY_NATIVE), std::memory_order_relaxed);
+			uint64_t rents = sizeClass.rents.fetch_add(1, std::memory_order_relaxed) + 1;
+
+			uint32_t inUse = GetInUse(sizeClass, rents);
+			uint32_t peak = sizeClass.peakInUse.load(std::memory_order_relaxed);
+			while (inUse > peak && !sizeClass.peakInUse.compare_exchange_weak(peak, inUse, std::memory_order_relaxed))
+			{
+			}
+
+			return { id, generation, { buffers[id].data, buffers[id].size } };
+		}
+
+		classes[firstFit].failedRents.fetch_add(1, std::memory_order_relaxed);
+		return {};
+	}
+
+	bool BufferPool::Release(uint32_t bufferId, uint32_t generation, BufferState heldBy)
+	{
+		if (bufferId >= bufferCount)
+			return false;
+
+		// Pushing a free buffer twice would corrupt the free list, so only the holder of this rent can free it, once.
+		uint32_t expected = MakeState(generation, heldBy);
+		if (!buffers[bufferId].state.compare_exchange_strong(expected, MakeState(generation, FREE), std::memory_order_acq_rel))
+			return false;
+
+		SizeClass& sizeClass = classes[buffers[bufferId].sizeClass];
+		if (heldBy == HELD_BY_MANAGED)
+			sizeClass.heldByManaged.fetch_sub(1, std::memory_order_relaxed);
+
+		sizeClass.returns.fetch_add(1, std::memory_order_relaxed);
+		Push(sizeClass, bufferId);
+		return true;
+	}
+
+	void BufferPool::Return(const PooledBuffer& buffer)
+	{
+		if (!Release(buffer.id, buffer.generation, HELD_BY_NATIVE))
+			invalidReturns.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void BufferPool::ReturnFromManaged(uint32_t bufferId, uint32_t generation)
+	{
+		if (!Release(bufferId, generation, HELD_BY_MANAGED))
+			invalidReturns.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void BufferPool::Deliver(int32_t handlerId, const PooledBuffer& buffer, size_t length)
+	{
+		if (!buffer.IsValid() || buffer.id >= bufferCount || length > buffers[buffer.id].size)
+			throw std::invalid_argument{ "The buffer isn't rented from this pool, or is shorter than the length" };
+
+		// The handler may return the buffer before the call returns, so it must be marked first.
+		SizeClass& sizeClass = classes[buffers[buffer.id].sizeClass];
+		sizeClass.heldByManaged.fetch_add(1, std::memory_order_relaxed);
+
+		uint32_t expected = MakeState(buffer.generation, HELD_BY_NATIVE);
+		if (!buffers[buffer.id].state.compare_exchange_strong(expected, MakeState(buffer.generation, HELD_BY_MANAGED), std::memory_order_acq_rel))
+		{
+			sizeClass.heldByManaged.fetch_sub(1, std::memory_order_relaxed);
+			throw std::invalid_argument{ "The buffer has been returned or delivered already" };
+		}
+
+		if (g_deliver(handlerId, managedId, (int32_t)buffer.id, buffer.generation, (int32_t)length) != 0)
+		{
+			// Unless the handler has returned it before throwing.
+			Release(buffer.id, buffer.generation, HELD_BY_MANAGED);
+			throw std::runtime_error{ "The managed buffer handler has thrown an exception" };
+		}
+	}
+
+	BufferPoolStats BufferPool::GetStats() const
+	{
+		BufferPoolStats stats;
+		stats.invalidReturns = invalidReturns.load(std::memory_order_relaxed);
+
+		for (size_t i = 0; i < classCount; i++)
+		{
+			const SizeClass& sizeClass = classes[i];
+
+			// The counters are read one by one while they change, so they're only consistent with each other once the
+			// pool is quiet.
+			BufferClassStats& classStats = stats.classes.emplace_back();
+			classStats.bufferSize = sizeClass.bufferSize;
+			classStats.buffers = sizeClass.bufferCount;
+			classStats.returns = sizeClass.returns.load(std::memory_order_relaxed);
+			classStats.rents = sizeClass.rents.load(std::memory_order_relaxed);
+			classStats.failedRents = sizeClass.failedRents.load(std::memory_order_relaxed);
+			classStats.peakInUse = sizeClass.peakInUse.load(std::memory_order_relaxed);
+
+			uint32_t inUse = GetInUse(sizeClass, classStats.rents);
+			classStats.heldByManaged = std::min(sizeClass.heldByManaged.load(std::memory_order_relaxed), inUse);
+			classStats.heldByNative = inUse - classStats.heldByManaged;
+			classStats.free = sizeClass.bufferCount - inUse;
+		}
+
+		return stats;
+	}
+
+	void BufferPool::Lend(uint32_t bufferId, std::byte* data, uint32_t size)
+	{
+		if (bufferId >= bufferCount)
+			return;
+
+		buffers[bufferId].data = data;
+		buffers[bufferId].size = size;
+	}
+
+	int32_t RegisterBufferHandler(const char_t* typeName, const char_t* methodName)
+	{
+		return RegisterHostHandler(NH_STR("ManagedApp.HostBufferPool"), NH_STR("RegisterHandler"), typeName, methodName, "static void Method(PooledBuffer buffer)");
+	}
+
+	uint64_t GetLeakedPoolBuffers()
+	{
+		return g_leakedBuffers.load(std::memory_order_relaxed);
+	}
+
+	void DELEGATE_CALLTYPE Builtins::LendBuffer(void* pool, int32_t bufferId, void* data, int32_t length)
+	{
+		((BufferPool*)pool)->Lend((uint32_t)bufferId, (std::byte*)data, (uint32_t)length);
+	}
+
+	void DELEGATE_CALLTYPE Builtins::ReturnBuffer(void* pool, int32_t bufferId, uint32_t generation)
+	{
+		((BufferPool*)pool)->ReturnFromManaged((uint32_t)bufferId, generation);
+	}
+}
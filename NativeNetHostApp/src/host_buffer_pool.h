@@ -0,0 +1,175 @@
+#pragma once
+#include <span>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "net_hosting.h"
+
+// Native producers writing straight into managed memory. A BufferPool is a set of managed byte arrays in size classes,
+// allocated pinned on the pinned object heap by the managed side (ManagedApp.HostBufferPool) and lent to the native side
+// through the `hostcomm_lend_buffer` native utility when the pool is created. Rent() takes the smallest free buffer that
+// fits from the lock-free free lists, and the producer writes into the managed array in place. Then it either returns the
+// buffer, or Deliver()s it to a managed handler, which reads it in place (as byte[], Span<byte> or Memory<byte>) and gives
+// it back with PooledBuffer.Return() (the `hostcomm_return_buffer` native utility) once it's done with it, possibly later
+// and on another thread. Nothing is allocated or copied per transfer, and since the arrays never move nor die while the
+// pool lives, the GC has nothing to do with them either.
+//
+// Handlers have the signature `static void Method(PooledBuffer buffer)`, and are registered with RegisterBufferHandler().
+
+namespace HostComm
+{
+	struct BufferSizeClass
+	{
+		size_t bufferSize;
+		uint32_t bufferCount;
+	};
+
+	// A rented buffer. It's a plain handle rather than an owner, since its ownership moves to the managed side on Deliver().
+	struct PooledBuffer
+	{
+		static constexpr uint32_t NO_BUFFER = UINT32_MAX;
+
+		uint32_t id = NO_BUFFER;
+		uint32_t generation = 0; // Of the rent, so a stale copy of the handle can't return the buffer once it's rented again.
+		std::span<std::byte> data; // The whole buffer, which may be larger than what has been asked for.
+
+		bool IsValid() const { return id != NO_BUFFER; }
+	};
+
+	struct BufferClassStats
+	{
+		size_t bufferSize = 0;
+		uint32_t buffers = 0;
+
+		// Where the buffers are right now.
+		uint32_t free = 0;
+		uint32_t heldByNative = 0;
+		uint32_t heldByManaged = 0;
+		uint32_t peakInUse = 0;
+
+		uint64_t rents = 0;
+		uint64_t returns = 0;
+		uint64_t failedRents = 0; // No buffer of the class (nor of a larger one) was free.
+	};
+
+	struct BufferPoolStats
+	{
+		std::vector<BufferClassStats> classes;
+		uint64_t invalidReturns = 0; // Buffers returned while free already or by a stale handle (of an earlier rent), or unknown IDs.
+	};
+
+	class BufferPool
+	{
+	private:
+		enum BufferState : uint32_t
+		{
+			FREE,
+			HELD_BY_NATIVE,
+			HELD_BY_MANAGED,
+		};
+
+		// The state of a buffer is in the low 2 bits of its state word, and the generation of its last rent above them, so
+		// a return only counts if both match.
+		static constexpr uint32_t STATE_BITS = 2;
+		static constexpr uint32_t STATE_MASK = (1 << STATE_BITS) - 1;
+
+		static uint32_t MakeState(uint32_t generation, BufferState state) { return generation << STATE_BITS | state; }
+
+		struct Buffer
+		{
+			std::byte* data = nullptr;
+			uint32_t size = 0;
+			uint32_t sizeClass = 0;
+			std::atomic<uint32_t> next{ 0 }; // The index + 1 of the next free buffer of the class, 0 for none.
+			std::atomic<uint32_t> state{ FREE };
+		};
+
+		// Every class has its own cache line, since the counters are written on every rent and return.
+		struct alignas(64) SizeClass
+		{
+			size_t bufferSize = 0;
+			uint32_t firstBuffer = 0;
+			uint32_t bufferCount = 0;
+
+			// The free list head: the index + 1 of the first free buffer in the low half, and a tag counting the changes in
+			// the high half, so a head that has been popped and pushed back in the meantime isn't mistaken for the same one.
+			std::atomic<uint64_t> freeHead{ 0 };
+
+			// The buffers in use are the rents minus the returns, so keeping a separate count (and paying for one more atomic
+			// operation on every rent and return) isn't needed.
+			std::atomic<uint64_t> rents{ 0 };
+			std::atomic<uint64_t> returns{ 0 };
+			std::atomic<uint64_t> failedRents{ 0 };
+			std::atomic<uint32_t> peakInUse{ 0 };
+			std::atomic<uint32_t> heldByManaged{ 0 };
+		};
+
+		int32_t managedId = -1;
+		std::unique_ptr<SizeClass[]> classes;
+		size_t classCount = 0;
+		std::unique_ptr<Buffer[]> buffers;
+		uint32_t bufferCount = 0;
+		std::atomic<uint64_t> invalidReturns{ 0 };
+
+	public:
+		// Allocate the buffers on the managed side. Requires HostComm to be initialized.
+		// Throws std::invalid_argument if a class is empty or too large (the managed arrays are at most INT32_MAX bytes),
+		// or std::runtime_error if the managed side has failed to allocate the buffers.
+		explicit BufferPool(std::vector<BufferSizeClass> sizeClasses);
+
+		// Give the buffers back to the managed side. Nothing may be renting or returning buffers anymore. The buffers that
+		// are still rented are leaked (see GetLeakedPoolBuffers()): their arrays stay allocated for good, so whoever still
+		// writes into them doesn't corrupt anything.
+		~BufferPool();
+
+		BufferPool(const BufferPool&) = delete;
+		BufferPool& operator=(const BufferPool&) = delete;
+
+		// Take a free buffer of at least `minBytes` bytes, from the smallest class that has one.
+		/// @return An invalid buffer if none is free. Throws std::length_error if no class is large enough.
+		PooledBuffer Rent(size_t minBytes);
+
+		// Give back a buffer the native side still holds. Returning it twice, or after delivering it, only counts as an
+		// invalid return.
+		void Return(const PooledBuffer& buffer);
+
+		// Hand the buffer over to a managed handler, with its first `length` bytes written. The handler owns it from then on,
+		// and returns it once done with it. Throws std::invalid_argument if the native side doesn't hold the buffer (under
+		// that rent), or std::runtime_error (having returned the buffer) if the handler has thrown.
+		void Deliver(int32_t handlerId, const PooledBuffer& buffer, size_t length);
+
+		BufferPoolStats GetStats() const;
+
+		// Only for the `hostcomm_lend_buffer` utility, while the pool is being created.
+		void Lend(uint32_t bufferId, std::byte* data, uint32_t size);
+
+		// Only for the `hostcomm_return_buffer` utility, giving back a buffer delivered under the generation.
+		void ReturnFromManaged(uint32_t bufferId, uint32_t generation);
+
+	private:
+		bool Pop(SizeClass& sizeClass, uint32_t& bufferId);
+		void Push(SizeClass& sizeClass, uint32_t bufferId);
+
+		// Free the buffer if it's held as `heldBy` under the generation.
+		/// @return False if it isn't (it has been returned already, or rented again since).
+		bool Release(uint32_t bufferId, uint32_t generation, BufferState heldBy);
+		static uint32_t GetInUse(const SizeClass& sizeClass, uint64_t rents);
+	};
+
+	// Register a managed `static void Method(PooledBuffer buffer)` method to deliver buffers to. Requires HostComm to be initialized.
+	/// @param typeName Assembly qualified type name, like "ManagedApp.Program, ManagedApp".
+	/// @return The ID of the handler to deliver buffers to.
+	int32_t RegisterBufferHandler(const char_t* typeName, const char_t* methodName);
+
+	// How many buffers were still rented when their pools were destroyed, in all pools so far.
+	uint64_t GetLeakedPoolBuffers();
+
+	namespace Builtins
+	{
+		void DELEGATE_CALLTYPE LendBuffer(void* pool, int32_t bufferId, void* data, int32_t length);
+		void DELEGATE_CALLTYPE ReturnBuffer(void* pool, int32_t bufferId, uint32_t generation);
+	}
+}
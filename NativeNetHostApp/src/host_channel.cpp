@@ -0,0 +1,242 @@
+#include "host_channel.h"
+
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include <string>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+#if _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h>
+#else
+	#include <poll.h>
+	#include <unistd.h>
+	#include <sys/eventfd.h>
+#endif
+
+namespace
+{
+	constexpr size_t CHANNEL_ALIGNMENT = 64;
+
+	struct ChannelMemoryDeleter
+	{
+		void operator()(HostComm::ChannelHeader* header) const
+		{
+			header->~ChannelHeader();
+			::operator delete((void*)header, std::align_val_t{ CHANNEL_ALIGNMENT });
+		}
+	};
+
+	struct OwnedChannel
+	{
+		std::unique_ptr<HostComm::ChannelHeader, ChannelMemoryDeleter> memory;
+		std::unique_ptr<HostComm::Channel> channel;
+	};
+}
+
+static std::mutex g_channelsMutex;
+static std::unordered_map<std::string, OwnedChannel> g_channels{};
+
+static int64_t CreateWakeHandle()
+{
+#if _WIN32
+	HANDLE event = CreateEvent(NULL, FALSE, FALSE, NULL);
+	return event != NULL ? (int64_t)event : -1;
+#else
+	return eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+}
+
+static void CloseWakeHandle(int64_t handle)
+{
+	if (handle == -1)
+		return;
+
+#if _WIN32
+	CloseHandle((HANDLE)handle);
+#else
+	close((int)handle);
+#endif
+}
+
+namespace HostComm
+{
+	Channel& Channel::Create(const char* name, size_t capacityBytes, bool enableWakeups)
+	{
+		if (name == nullptr || *name == '\0')
+			throw std::invalid_argument{ "The channel name is null or empty" };
+
+		size_t capacity = 64;
+		while (capacity < capacityBytes)
+			capacity *= 2;
+
+		std::lock_guard lock{ g_channelsMutex };
+		if (g_channels.contains(name))
+			throw std::invalid_argument{ "There's already a channel with the same name" };
+
+		// Zeroed memory means every record is free.
+		void* memory = ::operator new(sizeof(ChannelHeader) + capacity, std::align_val_t{ CHANNEL_ALIGNMENT });
+		memset(memory, 0, sizeof(ChannelHeader) + capacity);
+
+		OwnedChannel owned;
+		owned.memory.reset(new (memory) ChannelHeader{});
+		owned.memory->capacity = capacity;
+		owned.memory->wakeHandle = enableWakeups ? CreateWakeHandle() : -1;
+		owned.channel = std::make_unique<Channel>(owned.memory.get());
+
+		Channel& channel = *owned.channel;
+		g_channels.emplace(name, std::move(owned));
+		return channel;
+	}
+
+	Channel* Channel::Find(const char* name)
+	{
+		std::lock_guard lock{ g_channelsMutex };
+
+		auto it = g_channels.find(name);
+		return it != g_channels.end() ? it->second.channel.get() : nullptr;
+	}
+
+	void Channel::Destroy(const char* name)
+	{
+		std::lock_guard lock{ g_channelsMutex };
+
+		auto it = g_channels.find(name);
+		if (it == g_channels.end())
+			return;
+
+		CloseWakeHandle(it->second.memory->wakeHandle);
+		g_channels.erase(it);
+	}
+
+	Channel::Channel(ChannelHeader* header) : header(header), data((std::byte*)(header + 1))
+	{
+	}
+
+	bool Channel::TryWrite(std::span<const std::byte> record)
+	{
+		uint64_t capacity = header->capacity;
+		uint64_t recordSize = AlignRecord(sizeof(ChannelRecordHeader) + record.size());
+		if (recordSize > capacity)
+			return false;
+
+		uint64_t tail = header->tail.load(std::memory_order_relaxed);
+		uint64_t padding;
+
+		do
+		{
+			// A record that doesn't fit before the end of the ring is moved to its beginning.
+			uint64_t offset = tail & (capacity - 1);
+			padding = offset + recordSize > capacity ? capacity - offset : 0;
+
+			if (tail + padding + recordSize - header->head.load(std::memory_order_acquire) > capacity)
+				return false;
+		}
+		while (!header->tail.compare_exchange_weak(tail, tail + padding + recordSize, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+		if (padding != 0)
+		{
+			ChannelRecordHeader* paddingRecord = RecordAt(tail);
+			paddingRecord->size = (uint32_t)padding;
+			paddingRecord->state.store(RECORD_PADDING, std::memory_order_release);
+		}
+
+		ChannelRecordHeader* recordHeader = RecordAt(tail + padding);
+		recordHeader->size = (uint32_t)record.size();
+		memcpy(reinterpret_cast<std::byte*>(recordHeader + 1), record.data(), record.size());
+		recordHeader->state.store(RECORD_COMMITTED, std::memory_order_release);
+
+		if (header->wakeHandle != -1)
+		{
+			// Pairs with the fence in Wait(), so either the consumer sees the record or we see it waiting.
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (header->consumerWaiting.load(std::memory_order_relaxed) != 0)
+				Notify();
+		}
+
+		return true;
+	}
+
+	void Channel::Release(uint64_t from, uint64_t to)
+	{
+		// Producers rely on free space being zeroed (so a record header there reads as free), and a new record may
+		// start anywhere in the consumed range, not only where the old ones started.
+		uint64_t capacity = header->capacity;
+		while (from != to)
+		{
+			uint64_t offset = from & (capacity - 1);
+			uint64_t length = std::min(to - from, capacity - offset);
+
+			memset(data + offset, 0, (size_t)length);
+			from += length;
+		}
+
+		header->head.store(to, std::memory_order_release);
+	}
+
+	bool Channel::Wait(int timeoutMs)
+	{
+		if (header->wakeHandle == -1)
+			throw std::runtime_error{ "Wakeups are disabled for this channel" };
+
+		header->consumerWaiting.store(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		ChannelRecordHeader* next = RecordAt(header->head.load(std::memory_order_relaxed));
+		if (next->state.load(std::memory_order_acquire) == RECORD_FREE)
+		{
+#if _WIN32
+			WaitForSingleObject((HANDLE)header->wakeHandle, timeoutMs < 0 ? INFINITE : (DWORD)timeoutMs);
+#else
+			pollfd waitFor{ (int)header->wakeHandle, POLLIN, 0 };
+			if (poll(&waitFor, 1, timeoutMs) > 0)
+			{
+				uint64_t counter;
+				(void)read((int)header->wakeHandle, &counter, sizeof(counter));
+			}
+#endif
+		}
+
+		header->consumerWaiting.store(0, std::memory_order_relaxed);
+		return next->state.load(std::memory_order_acquire) != RECORD_FREE;
+	}
+
+	void Channel::Notify()
+	{
+		if (header->wakeHandle == -1)
+			return;
+
+#if _WIN32
+		SetEvent((HANDLE)header->wakeHandle);
+#else
+		uint64_t increment = 1;
+		(void)write((int)header->wakeHandle, &increment, sizeof(increment));
+#endif
+	}
+
+	void* DELEGATE_CALLTYPE Builtins::OpenChannel(const char* name)
+	{
+		if (name == nullptr)
+			return nullptr;
+
+		Channel* channel = Channel::Find(name);
+		return channel != nullptr ? channel->GetHeader() : nullptr;
+	}
+
+	int32_t DELEGATE_CALLTYPE Builtins::WaitChannel(void* channelHeader, int32_t timeoutMs)
+	{
+		// Exceptions can't go through the managed side, so no waiting without wakeups means there's nothing yet.
+		if (((ChannelHeader*)channelHeader)->wakeHandle == -1)
+			return 0;
+
+		return Channel{ (ChannelHeader*)channelHeader }.Wait(timeoutMs) ? 1 : 0;
+	}
+
+	void DELEGATE_CALLTYPE Builtins::NotifyChannel(void* channelHeader)
+	{
+		Channel{ (ChannelHeader*)channelHeader }.Notify();
+	}
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include <atomic>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "net_hosting.h"
+
+namespace HostComm
+{
+	// The memory layout of a channel shared by both sides (mirrored by HostChannel.cs). The data area, a ring of
+	// `capacity` bytes, follows the header right away. The indices are byte positions that only grow, and each one is on
+	// its own cache line so producers and the consumer don't fight over them.
+	struct ChannelHeader
+	{
+		uint64_t capacity; // Size of the data area in bytes, a power of two.
+		int64_t wakeHandle; // eventfd on Linux, an event HANDLE on Windows, or -1 if wakeups are disabled.
+
+		alignas(64) std::atomic<uint64_t> head; // Everything before it is consumed.
+		alignas(64) std::atomic<uint64_t> tail; // Everything before it is reserved by producers.
+		alignas(64) std::atomic<uint32_t> consumerWaiting; // Producers only wake the consumer up when it's set.
+	};
+
+	// Every record starts with this header, and the whole record is padded to 8 bytes. Records never wrap around the end
+	// of the ring: a padding record fills the rest of the ring instead.
+	struct ChannelRecordHeader
+	{
+		uint32_t size;
+		std::atomic<uint32_t> state;
+	};
+
+	static_assert(sizeof(ChannelHeader) == 256, "The layout is mirrored on the managed side");
+	static_assert(sizeof(ChannelRecordHeader) == 8, "The layout is mirrored on the managed side");
+
+	// A lock-free ring buffer of variable-sized records in native memory, that both sides read and write directly, without
+	// calling each other. Any number of producers (on either side) can write to it, but only one consumer should drain it.
+	// The managed side opens a channel by its name with `HostChannel.Open()`.
+	class Channel
+	{
+	public:
+		static constexpr uint32_t RECORD_FREE = 0;
+		static constexpr uint32_t RECORD_COMMITTED = 1;
+		static constexpr uint32_t RECORD_PADDING = 2;
+
+	private:
+		ChannelHeader* header;
+		std::byte* data;
+
+	public:
+		// Create a channel and make it available to the managed side by the name. The capacity is rounded up to a power of two.
+		// Throws if there's already a channel with the same name.
+		static Channel& Create(const char* name, size_t capacityBytes, bool enableWakeups = true);
+
+		// Find a channel created before, or return nullptr.
+		static Channel* Find(const char* name);
+
+		// Destroy the channel. Nothing on either side should use it anymore.
+		static void Destroy(const char* name);
+
+		explicit Channel(ChannelHeader* header);
+
+		Channel(const Channel&) = delete;
+		Channel& operator=(const Channel&) = delete;
+
+		// Copy the record into the channel. Returns false if there's not enough free space right now.
+		bool TryWrite(std::span<const std::byte> record);
+
+		// Pass the committed records to the handler (as `std::span<const std::byte>`) in order, and free them all at once
+		// afterwards. Returns how many records were handled. Only one thread at a time is allowed to drain a channel.
+		template<typename Handler>
+		size_t Drain(Handler&& handler, size_t maxRecords = std::numeric_limits<size_t>::max());
+
+		// Block until there's a record to drain, or the timeout (in milliseconds, -1 to wait forever) expires. Returns
+		// whether there's a record. Requires wakeups to be enabled.
+		bool Wait(int timeoutMs);
+
+		// Wake up the consumer if it's waiting.
+		void Notify();
+
+		ChannelHeader* GetHeader() const { return header; }
+		size_t GetCapacity() const { return (size_t)header->capacity; }
+
+	private:
+		ChannelRecordHeader* RecordAt(uint64_t position) const
+		{
+			return (ChannelRecordHeader*)(data + (position & (header->capacity - 1)));
+		}
+
+		static uint64_t AlignRecord(uint64_t size) { return (size + 7) & ~uint64_t(7); }
+
+		void Release(uint64_t from, uint64_t to);
+	};
+
+	template<typename Handler>
+	size_t Channel::Drain(Handler&& handler, size_t maxRecords)
+	{
+		uint64_t start = header->head.load(std::memory_order_relaxed);
+		uint64_t head = start;
+		size_t count = 0;
+
+		// The consumed records are freed only at the end, so a single drain must not go around the whole ring.
+		while (count < maxRecords && head - start < header->capacity)
+		{
+			ChannelRecordHeader* record = RecordAt(head);
+			uint32_t state = record->state.load(std::memory_order_acquire);
+
+			if (state == RECORD_FREE)
+				break;
+
+			if (state == RECORD_PADDING)
+			{
+				head += record->size;
+				continue;
+			}
+
+			handler(std::span<const std::byte>{ (const std::byte*)(record + 1), record->size });
+
+			head += AlignRecord(sizeof(ChannelRecordHeader) + record->size);
+			count++;
+		}
+
+		if (head != start)
+			Release(start, head);
+
+		return count;
+	}
+
+	// Native utilities the managed HostChannel is built on (registered by HostComm itself).
+	namespace Builtins
+	{
+		void* DELEGATE_CALLTYPE OpenChannel(const char* name);
+		int32_t DELEGATE_CALLTYPE WaitChannel(void* channelHeader, int32_t timeoutMs);
+		void DELEGATE_CALLTYPE NotifyChannel(void* channelHeader);
+	}
+}
@@ -0,0 +1,29 @@
+#include "host_columns.h"
+#include "host_comm.h"
+
+#include <atomic>
+#include <climits>
+#include <stdexcept>
+
+// (kernelId, columns, columnCount, count, result)
+static const HostComm::CachedHostMethod<int32_t(int32_t, const HostComm::Column*, int32_t, int32_t, int64_t*)> g_run{ NH_STR("ManagedApp.HostColumns"), NH_STR("Run") };
+
+namespace HostComm
+{
+	int32_t RegisterColumnKernel(const char_t* typeName, const char_t* methodName)
+	{
+		return RegisterHostHandler(NH_STR("ManagedApp.HostColumns"), NH_STR("RegisterKernel"), typeName, methodName, "static long Method(ColumnBatch batch)");
+	}
+
+	int64_t RunColumnKernel(int32_t kernelId, size_t count, std::span<const Column> columns)
+	{
+		if (count > INT32_MAX)
+			throw std::length_error{ "A batch can't have more than INT32_MAX records, split it up" };
+
+		int64_t result = 0;
+		if (g_run(kernelId, columns.data(), (int32_t)columns.size(), (int32_t)count, &result) != 0)
+			throw std::runtime_error{ "The managed column kernel has thrown an exception" };
+
+		return result;
+	}
+}
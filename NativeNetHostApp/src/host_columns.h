@@ -0,0 +1,78 @@
+#pragma once
+#include <span>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "net_hosting.h"
+
+// Processing records in batches, as a struct of arrays. Instead of calling a managed method once per record, the native
+// side passes columns (one array per field, like `float* xs, float* ys, int32_t* ids`) sharing a record count, and a
+// managed kernel (ManagedApp.ColumnBatch) gets every column as a Span<T> to process with Vector<T> kernels at once.
+// So the transition into the runtime is paid once per batch, and the columns are neither copied nor marshaled.
+//
+// Kernels have the signature `static long Method(ColumnBatch batch)`, and are registered with RegisterColumnKernel().
+// Columns passed as pointers to const are read-only on the managed side too. ManagedApp.ColumnKernels has an example.
+
+namespace HostComm
+{
+	// The element types of the columns (mirrored by ColumnType in HostColumns.cs).
+	enum class ColumnType : int32_t
+	{
+		INT8,
+		UINT8,
+		INT16,
+		UINT16,
+		INT32,
+		UINT32,
+		INT64,
+		UINT64,
+		FLOAT32,
+		FLOAT64,
+	};
+
+	template<typename T>
+	constexpr ColumnType ColumnTypeOf()
+	{
+		typedef std::remove_cv_t<T> Element;
+
+		if constexpr (std::is_same_v<Element, float>) return ColumnType::FLOAT32;
+		else if constexpr (std::is_same_v<Element, double>) return ColumnType::FLOAT64;
+		else if constexpr (std::is_integral_v<Element> && sizeof(Element) == 1) return std::is_signed_v<Element> ? ColumnType::INT8 : ColumnType::UINT8;
+		else if constexpr (std::is_integral_v<Element> && sizeof(Element) == 2) return std::is_signed_v<Element> ? ColumnType::INT16 : ColumnType::UINT16;
+		else if constexpr (std::is_integral_v<Element> && sizeof(Element) == 4) return std::is_signed_v<Element> ? ColumnType::INT32 : ColumnType::UINT32;
+		else if constexpr (std::is_integral_v<Element> && sizeof(Element) == 8) return std::is_signed_v<Element> ? ColumnType::INT64 : ColumnType::UINT64;
+		else static_assert(sizeof(T) == 0, "Columns can only be of integers, float or double");
+	}
+
+	// Mirrored by ColumnDescriptor in HostColumns.cs.
+	struct Column
+	{
+		const void* data;
+		ColumnType type;
+		int32_t isReadOnly;
+
+		template<typename T>
+		static Column Of(T* data) { return { data, ColumnTypeOf<T>(), std::is_const_v<T> ? 1 : 0 }; }
+	};
+
+	// Register a managed `static long Method(ColumnBatch batch)` method to run on batches. Requires HostComm to be initialized.
+	/// @param typeName Assembly qualified type name, like "ManagedApp.ColumnKernels, ManagedApp".
+	/// @return The ID of the kernel to run batches with.
+	int32_t RegisterColumnKernel(const char_t* typeName, const char_t* methodName);
+
+	// Run the managed kernel on `count` records of the columns, on this thread. Every column must have at least `count`
+	// elements. Throws std::length_error if `count` is above INT32_MAX (the length of a Span<T>), or std::runtime_error if
+	// the kernel has thrown (a column of a different type than the kernel expects included).
+	/// @return What the kernel has returned.
+	int64_t RunColumnKernel(int32_t kernelId, size_t count, std::span<const Column> columns);
+
+	// Like `RunColumnKernel(id, n, xs, ys, ids)`, with the columns in the order the kernel reads them in.
+	template<typename... T>
+	int64_t RunColumnKernel(int32_t kernelId, size_t count, T*... columns)
+	{
+		std::array<Column, sizeof...(T)> descriptors{ Column::Of(columns)... };
+		return RunColumnKernel(kernelId, count, std::span<const Column>{ descriptors });
+	}
+}
@@ -1,58 +1,614 @@
 #include "host_comm.h"
+#include "native_utility.h"
+#include "host_channel.h"
+#include "host_async.h"
+#include "host_mapped_file.h"
+#include "host_buffer_pool.h"
+#include "host_memory.h"
+#include "host_utility_stats.h"
+#include "host_trace.h"
+#include "startup_profile.h"
 
-#include <unordered_map>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
 #include <stdexcept>
+#include <algorithm>
+#include <unordered_set>
 
-typedef void (DELEGATE_CALLTYPE* HostCommInitCallback)(void* (*utilityLocator)(const char*));
+typedef void* (*UtilityLocator)(const char*);
 
-static bool g_isInitialized = false;
-static std::unordered_map<std::string, void*> g_nativeUtilities{};
+namespace
+{
+	struct UtilityEntry
+	{
+		std::string name;
+		void* callback;
+		uint32_t id;
+	};
+
+	// The layout the managed side reads the whole set of utilities in (see HostComm.cs).
+	struct UtilityTableEntry
+	{
+		const char* name;
+		void* callback;
+		uint32_t id;
+	};
+
+	// Copies up to `capacity` entries of the current table into `outTable`, and returns how many there are.
+	typedef int32_t (*UtilityTableProvider)(UtilityTableEntry* outTable, int32_t capacity, uint32_t* outGeneration);
+
+	// Passed to the managed HostComm.Init (see HostComm.cs).
+	struct InitParameters
+	{
+		UtilityLocator utilityLocator;
+		const UtilityTableEntry* utilityTable; // Null if the table isn't handed off, so the managed side uses the locator instead. Only valid during the call.
+		int32_t utilityCount;
+		uint32_t tableGeneration;
+		const std::atomic<uint32_t>* generation;
+		UtilityTableProvider tableProvider;
+	};
+
+	// An immutable set of native utilities. Every change to the registry builds a new snapshot and publishes it atomically,
+	// so readers never lock, allocate, or see a half-updated table. Lookups use open addressing on a power-of-two table.
+	struct UtilitySnapshot
+	{
+		std::vector<UtilityEntry> entries;
+		std::vector<uint32_t> slots; // Index into entries plus one, zero means an empty slot.
+		uint64_t seed = 0;
+		bool isPerfect = false; // Every entry sits in its home slot, so a lookup never probes further.
+
+		std::vector<UtilityTableEntry> table; // The same entries in a contiguous form to hand them off to the managed side.
+		uint32_t generation = 0;
+
+		void* Find(std::string_view name) const;
+	};
+}
+
+static uint64_t HashUtilityName(std::string_view name, uint64_t seed)
+{
+	// FNV-1a, with the seed mixed into the offset basis so the perfect hash search can try different functions.
+	uint64_t hash = 14695981039346656037ull ^ (seed * 0x9E3779B97F4A7C15ull);
+	for (char ch : name)
+	{
+		hash ^= (unsigned char)ch;
+		hash *= 1099511628211ull;
+	}
+
+	return hash ^ (hash >> 29);
+}
+
+void* UtilitySnapshot::Find(std::string_view name) const
+{
+	if (slots.empty())
+		return nullptr;
+
+	size_t mask = slots.size() - 1;
+	size_t index = HashUtilityName(name, seed) & mask;
+
+	while (uint32_t slot = slots[index])
+	{
+		const UtilityEntry& entry = entries[slot - 1];
+		if (entry.name == name)
+			return entry.callback;
+
+		if (isPerfect)
+			break;
+
+		index = (index + 1) & mask;
+	}
+
+	return nullptr;
+}
+
+// Place all entries of the snapshot into its table with the current seed. Returns false if perfect placement was
+// requested but some entry didn't get into its home slot.
+static bool FillSnapshotSlots(UtilitySnapshot& snapshot, size_t tableSize, bool requirePerfect)
+{
+	snapshot.slots.assign(tableSize, 0);
+	size_t mask = tableSize - 1;
+
+	for (size_t i = 0; i < snapshot.entries.size(); i++)
+	{
+		size_t index = HashUtilityName(snapshot.entries[i].name, snapshot.seed) & mask;
+		while (snapshot.slots[index] != 0)
+		{
+			if (requirePerfect)
+				return false;
+
+			index = (index + 1) & mask;
+		}
+
+		snapshot.slots[index] = (uint32_t)(i + 1);
+	}
+
+	return true;
+}
+
+static size_t GetTableSizeFor(size_t entryCount)
+{
+	// Keep the load factor at 50% or below, so probe sequences stay short.
+	size_t size = 8;
+	while (size < entryCount * 2)
+		size *= 2;
+
+	return size;
+}
+
+// The names handed off to the managed side, which reads them after the snapshot they came from may have been freed.
+// Never freed, but there's only one per distinct name ever registered. Only used with the registry lock held.
+static std::unordered_set<std::string> g_handedOffNames{};
+
+static void FillSnapshotTable(UtilitySnapshot& snapshot)
+{
+	snapshot.table.reserve(snapshot.entries.size());
+	for (const UtilityEntry& entry : snapshot.entries)
+	{
+		const std::string& name = *g_handedOffNames.insert(entry.name).first;
+		snapshot.table.push_back({ name.c_str(), entry.callback, entry.id });
+	}
+}
+
+static std::unique_ptr<UtilitySnapshot> BuildSnapshot(std::vector<UtilityEntry> entries)
+{
+	auto snapshot = std::make_unique<UtilitySnapshot>();
+	snapshot->entries = std::move(entries);
+
+	FillSnapshotSlots(*snapshot, GetTableSizeFor(snapshot->entries.size()), false);
+	FillSnapshotTable(*snapshot);
+	return snapshot;
+}
+
+static std::unique_ptr<UtilitySnapshot> BuildPerfectSnapshot(std::vector<UtilityEntry> entries)
+{
+	constexpr uint64_t SEEDS_PER_SIZE = 256;
+
+	auto snapshot = std::make_unique<UtilitySnapshot>();
+	snapshot->entries = std::move(entries);
+
+	// Search for a seed that gives every name its own slot, growing the table if none fits.
+	for (size_t tableSize = GetTableSizeFor(snapshot->entries.size()); ; tableSize *= 2)
+	{
+		for (uint64_t seed = 0; seed < SEEDS_PER_SIZE; seed++)
+		{
+			snapshot->seed = seed;
+			if (FillSnapshotSlots(*snapshot, tableSize, true))
+			{
+				FillSnapshotTable(*snapshot);
+				snapshot->isPerfect = true;
+				return snapshot;
+			}
+		}
+	}
+}
+
+// Init() is serialized by the mutex, and the state below is only written before the flag is set, so any thread that
+// sees the flag set can read it without locking.
+static std::mutex g_initMutex;
+static std::atomic<bool> g_isInitialized{ false };
+
+// Where the managed HostComm lives, to resolve its other host methods later.
+static NetHost::rd_LoadAssemblyAndGetFuncPointer g_loadAndGetFuncPointer{};
+static std::basic_string<char_t> g_hostAssemblyPath{};
+static std::basic_string<char_t> g_hostAssemblyName{};
+static bool g_isUtilityTableHandedOff = false;
+
+// Writers (register/unregister/freeze) are serialized with the mutex, readers only load the current snapshot.
+// A replaced snapshot is retired rather than freed, since a reader on another thread may still be looking into it, and
+// freed by a later change once no reader has it announced in its slot (like hazard pointers).
+static std::mutex g_registryMutex;
+static std::unique_ptr<UtilitySnapshot> g_ownedSnapshot{};
+static std::vector<std::unique_ptr<UtilitySnapshot>> g_retiredSnapshots{};
+static std::atomic<const UtilitySnapshot*> g_currentSnapshot{ nullptr };
+static bool g_isRegistryFrozen = false;
+
+// Bumped on every change to the registry. The managed side watches it to know when its copy of the table is stale.
+static std::atomic<uint32_t> g_registryGeneration{ 0 };
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "The managed side reads the generation as a plain integer");
+
+namespace
+{
+	// Where a thread announces the snapshot it's looking into. Slots are never freed, but a thread that exits leaves
+	// its slot to the next thread that looks a utility up, so there are only as many as threads have been alive at once.
+	struct alignas(64) ReaderSlot
+	{
+		std::atomic<const UtilitySnapshot*> snapshot{ nullptr };
+		std::atomic<bool> isTaken{ true };
+		ReaderSlot* next = nullptr;
+	};
+
+	std::atomic<ReaderSlot*> g_readerSlots{ nullptr };
+
+	struct ThreadReaderSlot
+	{
+		ReaderSlot* slot;
+
+		ThreadReaderSlot()
+		{
+			for (slot = g_readerSlots.load(std::memory_order_acquire); slot != nullptr; slot = slot->next)
+			{
+				bool isTaken = false;
+				if (slot->isTaken.compare_exchange_strong(isTaken, true, std::memory_order_acquire))
+					return;
+			}
+
+			slot = new ReaderSlot{};
+			slot->next = g_readerSlots.load(std::memory_order_relaxed);
+			while (!g_readerSlots.compare_exchange_weak(slot->next, slot, std::memory_order_release, std::memory_order_relaxed))
+			{
+			}
+		}
+
+		~ThreadReaderSlot()
+		{
+			slot->snapshot.store(nullptr, std::memory_order_relaxed);
+			slot->isTaken.store(false, std::memory_order_release);
+		}
+	};
+
+	// Announces the current snapshot for as long as it lives, so it's not freed meanwhile.
+	class SnapshotReadGuard
+	{
+	private:
+		ReaderSlot* slot;
+		const UtilitySnapshot* snapshot;
+
+	public:
+		SnapshotReadGuard()
+		{
+			thread_local ThreadReaderSlot threadSlot;
+			slot = threadSlot.slot;
+
+			// The announcement must be visible before the snapshot is loaded again, or a writer could miss it and free the
+			// snapshot that has just been loaded (both sequentially consistent, see ReclaimRetiredSnapshots()).
+			snapshot = g_currentSnapshot.load(std::memory_order_acquire);
+			while (true)
+			{
+				slot->snapshot.store(snapshot);
+
+				const UtilitySnapshot* current = g_currentSnapshot.load();
+				if (current == snapshot)
+					break;
+
+				snapshot = current;
+			}
+		}
+
+		~SnapshotReadGuard()
+		{
+			slot->snapshot.store(nullptr, std::memory_order_release);
+		}
+
+		SnapshotReadGuard(const SnapshotReadGuard&) = delete;
+		SnapshotReadGuard& operator=(const SnapshotReadGuard&) = delete;
+
+		const UtilitySnapshot* Get() const { return snapshot; }
+	};
+}
+
+// Free the retired snapshots no reader has announced. Called with the registry lock held, after the current snapshot has
+// been replaced, so a reader that announces a retired snapshot later sees it's not current anymore and moves on.
+static void ReclaimRetiredSnapshots()
+{
+	std::vector<const UtilitySnapshot*> announced;
+	for (ReaderSlot* slot = g_readerSlots.load(std::memory_order_acquire); slot != nullptr; slot = slot->next)
+	{
+		if (const UtilitySnapshot* snapshot = slot->snapshot.load())
+			announced.push_back(snapshot);
+	}
+
+	std::erase_if(g_retiredSnapshots, [&announced](const std::unique_ptr<UtilitySnapshot>& snapshot)
+	{
+		return std::find(announced.begin(), announced.end(), snapshot.get()) == announced.end();
+	});
+}
+
+static void PublishSnapshot(std::unique_ptr<UtilitySnapshot> snapshot)
+{
+	snapshot->generation = g_registryGeneration.load(std::memory_order_relaxed) + 1;
+
+	g_currentSnapshot.store(snapshot.get()); // Sequentially consistent, see SnapshotReadGuard.
+	g_registryGeneration.store(snapshot->generation); // Sequentially consistent, see DeliverRegistryChange().
 
-static std::string g_tempCheckingString{};
+	if (g_ownedSnapshot != nullptr)
+		g_retiredSnapshots.push_back(std::move(g_ownedSnapshot));
+
+	g_ownedSnapshot = std::move(snapshot);
+	ReclaimRetiredSnapshots();
+}
+
+// The trace utilities aren't counted, since a counted call would be traced around the span it begins or ends.
+template<HostComm::UtilityName Name, typename Signature, bool IsCounted = true>
+static UtilityEntry MakeBuiltinEntry(typename HostComm::NativeUtilitySignature<Signature>::Pointer callback)
+{
+	void* registered = IsCounted && HostComm::IsUtilityStatsEnabled() ? HostComm::UtilityCounting::Wrap<Name, Signature>(callback) : (void*)callback;
+	return { Name.value, registered, HostComm::UtilityId<Name> };
+}
+
+// Native utilities HostComm provides itself (the `hostcomm_` ones in native_utility_list.h). They're in the registry
+// from the very beginning.
+static std::vector<UtilityEntry> GetBuiltinEntries()
+{
+	return {
+		MakeBuiltinEntry<"hostcomm_open_channel", void*(const char*)>(&HostComm::Builtins::OpenChannel),
+		MakeBuiltinEntry<"hostcomm_wait_channel", int32_t(void*, int32_t)>(&HostComm::Builtins::WaitChannel),
+		MakeBuiltinEntry<"hostcomm_notify_channel", void(void*)>(&HostComm::Builtins::NotifyChannel),
+		MakeBuiltinEntry<"hostcomm_complete_async", void(uint64_t, int32_t, const void*, int32_t)>(&HostComm::Builtins::CompleteAsync),
+		MakeBuiltinEntry<"hostcomm_map_window", const void*(void*, int64_t)>(&HostComm::Builtins::MapWindow),
+		MakeBuiltinEntry<"hostcomm_release_window", void(void*, int64_t)>(&HostComm::Builtins::ReleaseWindow),
+		MakeBuiltinEntry<"hostcomm_lend_buffer", void(void*, int32_t, void*, int32_t)>(&HostComm::Builtins::LendBuffer),
+		MakeBuiltinEntry<"hostcomm_return_buffer", void(void*, int32_t, uint32_t)>(&HostComm::Builtins::ReturnBuffer),
+		MakeBuiltinEntry<"hostcomm_memory_stats_published", void()>(&HostComm::Builtins::MemoryStatsPublished),
+		MakeBuiltinEntry<"hostcomm_get_utility_stats", int32_t(void*, int32_t, uint64_t*)>(&HostComm::Builtins::GetUtilityStats),
+		MakeBuiltinEntry<"hostcomm_trace_name", uint32_t(const char*), false>(&HostComm::Builtins::TraceName),
+		MakeBuiltinEntry<"hostcomm_trace_begin", void(uint32_t), false>(&HostComm::Builtins::TraceBegin),
+		MakeBuiltinEntry<"hostcomm_trace_end", void(uint32_t), false>(&HostComm::Builtins::TraceEnd),
+	};
+}
+
+static std::vector<UtilityEntry> CopyCurrentEntries()
+{
+	const UtilitySnapshot* current = g_currentSnapshot.load(std::memory_order_relaxed);
+	if (current == nullptr)
+		return GetBuiltinEntries();
+
+	return current->entries;
+}
+
+// Make sure there's a snapshot to read from, even if nothing has been registered yet.
+static void EnsureSnapshot()
+{
+	std::lock_guard lock{ g_registryMutex };
+
+	if (g_currentSnapshot.load(std::memory_order_relaxed) == nullptr)
+		PublishSnapshot(BuildSnapshot(GetBuiltinEntries()));
+}
+
+static void ThrowIfRegistryFrozen()
+{
+	if (g_isRegistryFrozen)
+		throw std::runtime_error{ "The native utilities are frozen and can't be changed" };
+}
 
 // Utility locator adapter (will be called from .NET).
 static void* GetNativeUtility_Raw(const char* utilityName)
 {
+	if (utilityName == nullptr)
+		return nullptr;
+
 	return HostComm::GetNativeUtility(utilityName);
 }
 
-void HostComm::Init(const NetHost::HostContext& hostContext, const char_t* assemblyPath, const char_t* assemblyName)
+// Utility table provider (will be called from .NET when its copy of the table becomes stale). The entries are copied out,
+// since the snapshot may be freed as soon as the registry changes again.
+static int32_t GetNativeUtilityTable_Raw(UtilityTableEntry* outTable, int32_t capacity, uint32_t* outGeneration)
+{
+	SnapshotReadGuard guard;
+	const UtilitySnapshot* snapshot = guard.Get();
+	if (snapshot == nullptr)
+	{
+		*outGeneration = 0;
+		return 0;
+	}
+
+	int32_t count = (int32_t)snapshot->table.size();
+	if (count <= capacity)
+		std::copy(snapshot->table.begin(), snapshot->table.end(), outTable);
+
+	*outGeneration = snapshot->generation;
+	return count;
+}
+
+// Make the managed side pick the changed registry up (and rebind its typed utilities) now, rather than on its next lookup.
+// Called without the registry lock, since the managed side may take the new table from here. A change racing with Init()
+// is delivered by either one of them: the generation and the initialized flag are both stored and loaded sequentially
+// consistent, so at least one of them sees the other's store.
+static void DeliverRegistryChange()
+{
+	if (!g_isInitialized.load())
+		return;
+
+	auto refresh = HostComm::GetHostMethod<void()>(NH_STR("ManagedApp.HostComm"), NH_STR("RefreshUtilities"));
+	refresh();
+}
+
+/// @param table Holds the handed off table, so it must outlive the call the parameters are passed to.
+static InitParameters MakeInitParameters(bool handOffUtilityTable, std::vector<UtilityTableEntry>& table)
 {
-	if (g_isInitialized)
+	InitParameters parameters{};
+	parameters.utilityLocator = &GetNativeUtility_Raw;
+	parameters.generation = &g_registryGeneration;
+	parameters.tableProvider = &GetNativeUtilityTable_Raw;
+
+	if (handOffUtilityTable)
+	{
+		SnapshotReadGuard guard;
+		if (const UtilitySnapshot* snapshot = guard.Get())
+		{
+			table = snapshot->table;
+			parameters.utilityTable = table.data();
+			parameters.utilityCount = (int32_t)table.size();
+			parameters.tableGeneration = snapshot->generation;
+		}
+	}
+
+	return parameters;
+}
+
+void HostComm::Init(const NetHost::HostContext& hostContext, const char_t* assemblyPath, const char_t* assemblyName, bool handOffUtilityTable)
+{
+	std::lock_guard lock{ g_initMutex };
+	if (g_isInitialized.load(std::memory_order_relaxed))
 		throw std::runtime_error{ "Already initialized" };
 
+	NetHost::StartupSpan span{ NetHost::StartupPhases::HOSTCOMM_INIT };
+
 	std::basic_string<char_t> fullTypeName{ NH_STR("ManagedApp.HostComm, ") };
 	fullTypeName += assemblyName;
 
+	EnsureSnapshot();
+
 	auto loadAndGetFuncPointer = hostContext.GetLoadAssemblyAndGetFuncPointer();
-	void* callback = loadAndGetFuncPointer(assemblyPath, fullTypeName.c_str(), NH_STR("Init"), NetHost::UNMANAGED_CALLERS_ONLY);
+	auto initCallback = loadAndGetFuncPointer.GetFunction<void(const InitParameters*)>(assemblyPath, fullTypeName.c_str(), NH_STR("Init"), NetHost::UNMANAGED_CALLERS_ONLY);
 
-	((HostCommInitCallback)callback)(&GetNativeUtility_Raw);
-	g_isInitialized = true;
+	uint32_t initGeneration = g_registryGeneration.load();
+	std::vector<UtilityTableEntry> table;
+	InitParameters parameters = MakeInitParameters(handOffUtilityTable, table);
+	initCallback(&parameters);
+
+	g_loadAndGetFuncPointer = loadAndGetFuncPointer;
+	g_hostAssemblyPath = assemblyPath;
+	g_hostAssemblyName = assemblyName;
+	g_isUtilityTableHandedOff = handOffUtilityTable;
+	g_isInitialized.store(true);
+
+	// Registered on another thread while the managed side was initializing.
+	if (g_registryGeneration.load() != initGeneration)
+		DeliverRegistryChange();
 }
 
-void HostComm::RegisterNativeUtility(const char* utilityName, void* callback)
+std::future<NetHost::HostContext> HostComm::InitAsync(std::future<NetHost::HostContext> hostContext, std::basic_string<char_t> assemblyPath,
+	std::basic_string<char_t> assemblyName, bool handOffUtilityTable)
+{
+	return std::async(std::launch::async, [hostContext = std::move(hostContext), assemblyPath = std::move(assemblyPath), assemblyName = std::move(assemblyName), handOffUtilityTable]() mutable
+	{
+		NetHost::HostContext context = hostContext.get();
+		Init(context, assemblyPath.c_str(), assemblyName.c_str(), handOffUtilityTable);
+		return context;
+	});
+}
+
+std::basic_string<char_t> HostComm::GetHostAssemblyName()
+{
+	if (!g_isInitialized.load(std::memory_order_acquire))
+		throw std::runtime_error{ "HostComm isn't initialized" };
+
+	return g_hostAssemblyName;
+}
+
+void HostComm::InitCopy(void* initMethod)
+{
+	if (!g_isInitialized.load(std::memory_order_acquire))
+		throw std::runtime_error{ "HostComm isn't initialized" };
+
+	std::vector<UtilityTableEntry> table;
+	InitParameters parameters = MakeInitParameters(g_isUtilityTableHandedOff, table);
+	NetHost::ManagedFunction<void(const InitParameters*)>{ initMethod }(&parameters);
+}
+
+bool HostComm::IsInitialized()
+{
+	return g_isInitialized.load(std::memory_order_acquire);
+}
+
+void HostComm::AttachCurrentThread()
+{
+	static const CachedHostMethod<void()> s_attachThread{ NH_STR("ManagedApp.HostComm"), NH_STR("AttachThread") };
+
+	thread_local bool isAttached = false;
+	if (isAttached)
+		return;
+
+	s_attachThread();
+	isAttached = true;
+}
+
+void* HostComm::GetHostMethod(const char_t* typeName, const char_t* methodName)
+{
+	if (!g_isInitialized.load(std::memory_order_acquire))
+		throw std::runtime_error{ "HostComm isn't initialized" };
+
+	std::basic_string<char_t> fullTypeName{ typeName };
+	fullTypeName += NH_STR(", ");
+	fullTypeName += g_hostAssemblyName;
+
+	return g_loadAndGetFuncPointer(g_hostAssemblyPath.c_str(), fullTypeName.c_str(), methodName, NetHost::UNMANAGED_CALLERS_ONLY);
+}
+
+int32_t HostComm::RegisterHostHandler(const char_t* registryTypeName, const char_t* registerMethodName, const char_t* typeName,
+	const char_t* methodName, const char* signature)
+{
+	auto registerHandler = GetHostMethod<int32_t(const char_t*, const char_t*)>(registryTypeName, registerMethodName);
+
+	int32_t id = registerHandler(typeName, methodName);
+	if (id == -2)
+		throw std::runtime_error{ "Managed methods are looked up by name, which isn't supported in a NativeAOT build" };
+	if (id < 0)
+		throw std::invalid_argument{ std::string{ "The managed method is not found, or doesn't have the `" } + signature + "` signature" };
+
+	return id;
+}
+
+bool HostComm::RegisterNativeUtility(const char* utilityName, void* callback)
 {
 	if (utilityName == nullptr || *utilityName == '\0')
 		throw std::invalid_argument{ "The utility name is null or empty" };
 	if (callback == nullptr)
 		throw std::invalid_argument{ "The callback is null pointer (not allowed)" };
 
-	g_nativeUtilities.try_emplace(std::move(utilityName), callback);
+	{
+		std::lock_guard lock{ g_registryMutex };
+		ThrowIfRegistryFrozen();
+
+		uint32_t id = HostComm::GetUtilityId(utilityName);
+
+		// Typed utilities are bound by their IDs on the managed side, so two names must never share one.
+		auto entries = CopyCurrentEntries();
+		for (const UtilityEntry& entry : entries)
+		{
+			if (entry.name == utilityName || entry.id == id)
+				return false;
+		}
+
+		entries.push_back({ utilityName, callback, id });
+		PublishSnapshot(BuildSnapshot(std::move(entries)));
+	}
+
+	DeliverRegistryChange();
+	return true;
 }
 
 void HostComm::UnregisterNativeUtility(const char* utilityName)
 {
-	g_nativeUtilities.erase(utilityName);
+	if (utilityName == nullptr)
+		return;
+
+	{
+		std::lock_guard lock{ g_registryMutex };
+		ThrowIfRegistryFrozen();
+
+		// Nothing to publish (nor to deliver) if it's not registered.
+		auto entries = CopyCurrentEntries();
+		if (std::erase_if(entries, [utilityName](const UtilityEntry& entry) { return entry.name == utilityName; }) == 0)
+			return;
+
+		PublishSnapshot(BuildSnapshot(std::move(entries)));
+	}
+
+	DeliverRegistryChange();
 }
 
-void* HostComm::GetNativeUtility(const char* utilityName)
+void HostComm::FreezeNativeUtilities()
 {
-	g_tempCheckingString = utilityName;
-	if (!g_nativeUtilities.contains(g_tempCheckingString))
 	{
-		return nullptr;
+		std::lock_guard lock{ g_registryMutex };
+		if (g_isRegistryFrozen)
+			return;
+
+		PublishSnapshot(BuildPerfectSnapshot(CopyCurrentEntries()));
+		g_isRegistryFrozen = true;
 	}
 
-	return g_nativeUtilities.at(g_tempCheckingString);
+	DeliverRegistryChange();
+}
+
+void* HostComm::GetNativeUtility(std::string_view utilityName)
+{
+	if (g_currentSnapshot.load(std::memory_order_acquire) == nullptr)
+		EnsureSnapshot();
+
+	SnapshotReadGuard guard;
+	return guard.Get()->Find(utilityName);
 }
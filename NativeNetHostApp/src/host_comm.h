@@ -1,5 +1,8 @@
 #pragma once
+#include <atomic>
 #include <string>
+#include <future>
+#include <cstdint>
 #include <string_view>
 
 #include "net_hosting.h"
@@ -10,10 +13,105 @@ namespace HostComm
 	/// can now be able to communicate back to here (the native side).
 	/// @param assemblyPath The path for the main assembly to load.
 	/// @param assemblyName The assembly where HostComm managed class resides.
-	void Init(const NetHost::HostContext& hostContext, const char_t* assemblyPath, const char_t* assemblyName);
+	/// @param handOffUtilityTable Pass all registered native utilities to the managed side at once, so it resolves them without
+	/// calling back here. Later changes to the registry are noticed by the managed side via a generation counter.
+	void Init(const NetHost::HostContext& hostContext, const char_t* assemblyPath, const char_t* assemblyName, bool handOffUtilityTable = false);
 
-	void RegisterNativeUtility(const char* utilityName, void* callback);
+	/// Init() on a background thread once the context is created (see NetHost::NewContextForRuntimeConfigAsync()), so the
+	/// native side can initialize its own subsystems while the runtime starts and the assembly loads. Native utilities
+	/// registered meanwhile are delivered to the managed side too, whether they make it into Init() or come after it.
+	/// @return The context, once HostComm is initialized in it. Rethrows what creating the context or Init() has thrown.
+	std::future<NetHost::HostContext> InitAsync(std::future<NetHost::HostContext> hostContext, std::basic_string<char_t> assemblyPath,
+		std::basic_string<char_t> assemblyName, bool handOffUtilityTable = false);
+
+	/// Whether Init() has completed. Everything in HostComm can be used from any number of threads at once afterwards.
+	bool IsInitialized();
+
+	/// The name of the assembly the managed HostComm was initialized from. Requires HostComm to be initialized.
+	std::basic_string<char_t> GetHostAssemblyName();
+
+	/// Initialize another copy of the managed HostComm (like one in a reloadable assembly, see host_reload.h) to reach the
+	/// same native utilities as the main one. Requires HostComm to be initialized.
+	/// @param initMethod The HostComm.Init method of the copy.
+	void InitCopy(void* initMethod);
+
+	/// Set the calling thread up in the runtime ahead of time, by calling into the managed side once. The first call from a
+	/// native thread otherwise pays for it (creating the managed thread object, its allocation context and so on).
+	/// Does nothing on a thread that is set up already. Requires HostComm to be initialized.
+	void AttachCurrentThread();
+
+	/// Get a pointer to an [UnmanagedCallersOnly] static method of a type in the HostComm assembly, loaded into the same
+	/// context as the managed HostComm. It's how the other HostComm modules reach their managed counterparts.
+	/// @param typeName The full type name without the assembly, like "ManagedApp.HostBatch".
+	void* GetHostMethod(const char_t* typeName, const char_t* methodName);
+
+	template<typename Signature>
+	NetHost::ManagedFunction<Signature> GetHostMethod(const char_t* typeName, const char_t* methodName)
+	{
+		return NetHost::ManagedFunction<Signature>{ GetHostMethod(typeName, methodName) };
+	}
+
+	/// A host method (see GetHostMethod()) resolved on its first call and cached, for the hot paths. Meant to be a static,
+	/// since the pointer stays valid for as long as the runtime. Threads racing on the first call resolve the same pointer.
+	template<typename Signature>
+	class CachedHostMethod;
+
+	template<typename R, typename... Args>
+	class CachedHostMethod<R(Args...)>
+	{
+	public:
+		typedef R (DELEGATE_CALLTYPE *Pointer)(Args...);
+
+	private:
+		const char_t* typeName;
+		const char_t* methodName;
+		mutable std::atomic<Pointer> pointer{ nullptr };
+
+	public:
+		constexpr CachedHostMethod(const char_t* typeName, const char_t* methodName) : typeName(typeName), methodName(methodName) {}
+
+		CachedHostMethod(const CachedHostMethod&) = delete;
+		CachedHostMethod& operator=(const CachedHostMethod&) = delete;
+
+		R operator()(Args... args) const { return Get()(args...); }
+
+		Pointer Get() const
+		{
+			Pointer resolved = pointer.load(std::memory_order_acquire);
+			if (resolved == nullptr)
+			{
+				resolved = GetHostMethod<R(Args...)>(typeName, methodName).Get();
+				pointer.store(resolved, std::memory_order_release);
+			}
+
+			return resolved;
+		}
+	};
+
+	/// Register a managed method with one of the managed registries (batch and async entrypoints, file and buffer handlers,
+	/// column kernels), through its `int Register(IntPtr typeName, IntPtr methodName)` host method.
+	/// Throws std::invalid_argument if the method is not found or doesn't have the signature, and std::runtime_error in a
+	/// NativeAOT build, where methods can't be looked up by name.
+	/// @param signature The signature the registry takes, for the error message.
+	/// @return The ID the registry has given the method.
+	int32_t RegisterHostHandler(const char_t* registryTypeName, const char_t* registerMethodName, const char_t* typeName,
+		const char_t* methodName, const char* signature);
+
+	/// Native utilities can be registered and unregistered from any thread, at any time. Changes made after Init() are pushed
+	/// to the managed side right away, so its typed bindings never miss a utility.
+	/// @return False, with nothing registered, if the name is registered already, or its ID (see GetUtilityId()) is the same
+	/// as the ID of another registered name (the typed bindings are bound by the IDs, so they must be unique).
+	bool RegisterNativeUtility(const char* utilityName, void* callback);
 	void UnregisterNativeUtility(const char* utilityName);
 
-	void* GetNativeUtility(const char* utilityName);
+	/// Compile the current set of native utilities into a perfect-hash table, so every lookup touches a single slot.
+	/// Registering or unregistering utilities isn't allowed afterwards.
+	void FreezeNativeUtilities();
+
+	/// Find a native utility by its name, or return nullptr if there's none. Safe to call concurrently from any number of
+	/// threads, and never locks. A thread's first lookup takes a reader slot, allocating one unless an exited thread has
+	/// left one behind. Every lookup announces the table it reads in that slot with a sequentially consistent store (so a
+	/// replaced table isn't freed under it), and announces again if the utilities have changed meanwhile, on top of the
+	/// hash and a string compare.
+	void* GetNativeUtility(std::string_view utilityName);
 }
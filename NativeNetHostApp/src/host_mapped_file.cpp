@@ -0,0 +1,232 @@
+#include "host_mapped_file.h"
+#include "host_comm.h"
+
+#include <string>
+#include <climits>
+#include <stdexcept>
+#include <algorithm>
+
+#if _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+static size_t GetMappingGranularity()
+{
+#if _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwAllocationGranularity;
+#else
+	return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+namespace HostComm
+{
+	MappedFile::MappedFile(const std::filesystem::path& filePath, const MappedFileOptions& options) : options(options)
+	{
+		if (this->options.maxMappedWindows == 0)
+			throw std::invalid_argument{ "At least one window must be allowed to be mapped" };
+
+		// The managed side measures a window with an int, like any span.
+		size_t granularity = GetMappingGranularity();
+		if (options.windowSize > INT32_MAX)
+			throw std::invalid_argument{ "The windows can't be larger than INT32_MAX bytes" };
+
+		this->options.windowSize = std::max<size_t>((options.windowSize + granularity - 1) / granularity * granularity, granularity);
+		if (this->options.windowSize > INT32_MAX)
+			this->options.windowSize -= granularity;
+
+#if _WIN32
+		file = CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+			options.isSequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			throw std::runtime_error{ "Failed to open the file: " + filePath.string() };
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize))
+		{
+			CloseHandle(file);
+			throw std::runtime_error{ "Failed to get the size of the file: " + filePath.string() };
+		}
+
+		size = (uint64_t)fileSize.QuadPart;
+
+		// A mapping of an empty file can't be created, but there's nothing to map anyway.
+		if (size != 0)
+		{
+			mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (mapping == NULL)
+			{
+				CloseHandle(file);
+				throw std::runtime_error{ "Failed to map the file: " + filePath.string() };
+			}
+		}
+#else
+		file = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+		if (file == -1)
+			throw std::runtime_error{ "Failed to open the file: " + filePath.string() };
+
+		struct stat info;
+		if (fstat(file, &info) != 0)
+		{
+			close(file);
+			throw std::runtime_error{ "Failed to get the size of the file: " + filePath.string() };
+		}
+
+		size = (uint64_t)info.st_size;
+
+		if (options.isSequential)
+			posix_fadvise(file, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+		windows.resize((size + this->options.windowSize - 1) / this->options.windowSize);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		for (uint64_t i = 0; i < windows.size(); i++)
+		{
+			if (windows[i].view != nullptr)
+				Unmap(windows[i], i);
+		}
+
+#if _WIN32
+		if (mapping != nullptr)
+			CloseHandle(mapping);
+
+		CloseHandle(file);
+#else
+		close(file);
+#endif
+	}
+
+	size_t MappedFile::GetMappedWindows() const
+	{
+		std::lock_guard lock{ mutex };
+		return mappedWindows;
+	}
+
+	size_t MappedFile::GetWindowBytes(uint64_t index) const
+	{
+		uint64_t offset = index * options.windowSize;
+		return (size_t)std::min<uint64_t>(options.windowSize, size - offset);
+	}
+
+	std::span<const std::byte> MappedFile::MapWindow(uint64_t index)
+	{
+		if (index >= windows.size())
+			throw std::out_of_range{ "The window is past the end of the file" };
+
+		std::lock_guard lock{ mutex };
+
+		Window& window = windows[index];
+		size_t bytes = GetWindowBytes(index);
+
+		if (window.view != nullptr)
+		{
+			window.references++;
+			return { (const std::byte*)window.view, bytes };
+		}
+
+		if (mappedWindows >= options.maxMappedWindows)
+			throw std::runtime_error{ "Too many windows are mapped, release some first" };
+
+		uint64_t offset = index * options.windowSize;
+
+#if _WIN32
+		window.view = MapViewOfFile(mapping, FILE_MAP_READ, (DWORD)(offset >> 32), (DWORD)offset, bytes);
+		if (window.view == nullptr)
+			throw std::runtime_error{ "Failed to map a window of the file" };
+#else
+		void* view = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, file, (off_t)offset);
+		if (view == MAP_FAILED)
+			throw std::runtime_error{ "Failed to map a window of the file" };
+
+		window.view = view;
+
+		if (options.isSequential)
+		{
+			madvise(view, bytes, MADV_SEQUENTIAL);
+			madvise(view, bytes, MADV_WILLNEED);
+
+			// Start reading the next window in, so it's (partly) in the page cache by the time it's mapped.
+			if (index + 1 < windows.size())
+				posix_fadvise(file, (off_t)(offset + bytes), (off_t)GetWindowBytes(index + 1), POSIX_FADV_WILLNEED);
+		}
+#endif
+
+		window.references = 1;
+		mappedWindows++;
+
+		return { (const std::byte*)window.view, bytes };
+	}
+
+	void MappedFile::ReleaseWindow(uint64_t index)
+	{
+		if (index >= windows.size())
+			return;
+
+		std::lock_guard lock{ mutex };
+
+		Window& window = windows[index];
+		if (window.view == nullptr || --window.references != 0)
+			return;
+
+		Unmap(window, index);
+	}
+
+	void MappedFile::Unmap(Window& window, uint64_t index)
+	{
+#if _WIN32
+		UnmapViewOfFile(window.view);
+#else
+		munmap(window.view, GetWindowBytes(index));
+#endif
+
+		window = {};
+		mappedWindows--;
+	}
+
+	int32_t RegisterFileHandler(const char_t* typeName, const char_t* methodName)
+	{
+		return RegisterHostHandler(NH_STR("ManagedApp.HostMappedFile"), NH_STR("RegisterHandler"), typeName, methodName, "static long Method(MappedFileReader file)");
+	}
+
+	int64_t StreamFile(int32_t handlerId, const std::filesystem::path& filePath, const MappedFileOptions& options)
+	{
+		auto run = GetHostMethod<int32_t(int32_t, void*, int64_t, int64_t, int32_t, int64_t*)>(NH_STR("ManagedApp.HostMappedFile"), NH_STR("Run"));
+
+		MappedFile file{ filePath, options };
+
+		int64_t result = 0;
+		if (run(handlerId, &file, (int64_t)file.GetSize(), (int64_t)file.GetWindowSize(), (int32_t)file.GetMaxMappedWindows(), &result) != 0)
+			throw std::runtime_error{ "The managed file handler has thrown an exception" };
+
+		return result;
+	}
+
+	// Exceptions can't go through the managed side, so a failure to map is reported as nullptr (and thrown there).
+	const void* DELEGATE_CALLTYPE Builtins::MapWindow(void* file, int64_t index)
+	{
+		try
+		{
+			return ((MappedFile*)file)->MapWindow((uint64_t)index).data();
+		}
+		catch (const std::exception&)
+		{
+			return nullptr;
+		}
+	}
+
+	void DELEGATE_CALLTYPE Builtins::ReleaseWindow(void* file, int64_t index)
+	{
+		((MappedFile*)file)->ReleaseWindow((uint64_t)index);
+	}
+}
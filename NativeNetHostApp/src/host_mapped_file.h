@@ -0,0 +1,94 @@
+#pragma once
+#include <span>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+#include "net_hosting.h"
+
+// Streaming files into the managed side without copying them. A MappedFile maps a file window by window (read-only),
+// and a managed handler (ManagedApp.MappedFileReader) reads the windows in place as ReadOnlySpan<byte> or, for data
+// crossing the window boundaries, ReadOnlySequence<byte>. The handler maps and releases the windows through the
+// `hostcomm_map_window` and `hostcomm_release_window` native utilities, and at most `maxMappedWindows` of them are mapped
+// at once, so the resident memory stays bounded however large the file is.
+//
+// Handlers have the signature `static long Method(MappedFileReader file)`, and are run by StreamFile().
+
+namespace HostComm
+{
+	struct MappedFileOptions
+	{
+		size_t windowSize = 64 * 1024 * 1024; // Rounded up to the page size (the allocation granularity on Windows), at most INT32_MAX.
+		size_t maxMappedWindows = 4;
+		bool isSequential = true; // Hint the OS the windows are read sequentially, and read the next window ahead (POSIX only).
+	};
+
+	class MappedFile
+	{
+	private:
+		struct Window
+		{
+			void* view = nullptr; // Null while the window isn't mapped.
+			uint32_t references = 0;
+		};
+
+	#if _WIN32
+		void* file = nullptr;
+		void* mapping = nullptr;
+	#else
+		int file = -1;
+	#endif
+
+		uint64_t size = 0;
+		MappedFileOptions options;
+
+		mutable std::mutex mutex;
+		std::vector<Window> windows;
+		size_t mappedWindows = 0;
+
+	public:
+		// Open the file for reading, without mapping anything yet. Throws std::runtime_error if it can't be opened, or
+		// std::invalid_argument if the windows are larger than INT32_MAX bytes (the managed side reads them as spans).
+		MappedFile(const std::filesystem::path& filePath, const MappedFileOptions& options = {});
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		uint64_t GetSize() const { return size; }
+		size_t GetWindowSize() const { return options.windowSize; }
+		uint64_t GetWindowCount() const { return windows.size(); }
+		size_t GetMaxMappedWindows() const { return options.maxMappedWindows; }
+		size_t GetMappedWindows() const;
+
+		// Map a window, or take another reference to it if it's mapped already. Every window is GetWindowSize() bytes,
+		// except the last one. Throws std::runtime_error if too many windows are mapped, or the mapping has failed.
+		std::span<const std::byte> MapWindow(uint64_t index);
+
+		// Give back a reference taken by MapWindow(), and unmap the window once nothing references it.
+		void ReleaseWindow(uint64_t index);
+
+	private:
+		size_t GetWindowBytes(uint64_t index) const;
+		void Unmap(Window& window, uint64_t index);
+	};
+
+	// Register a managed `static long Method(MappedFileReader file)` method to stream files into. Requires HostComm to be initialized.
+	/// @param typeName Assembly qualified type name, like "ManagedApp.Program, ManagedApp".
+	/// @return The ID of the handler to stream files with.
+	int32_t RegisterFileHandler(const char_t* typeName, const char_t* methodName);
+
+	// Open the file, and run the managed handler on it on this thread. The windows the handler leaves mapped are
+	// released when it returns. Throws std::runtime_error if the file can't be opened, or the handler has thrown.
+	/// @return What the handler has returned.
+	int64_t StreamFile(int32_t handlerId, const std::filesystem::path& filePath, const MappedFileOptions& options = {});
+
+	namespace Builtins
+	{
+		const void* DELEGATE_CALLTYPE MapWindow(void* file, int64_t index);
+		void DELEGATE_CALLTYPE ReleaseWindow(void* file, int64_t index);
+	}
+}
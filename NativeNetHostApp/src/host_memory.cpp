@@ -0,0 +1,171 @@
+#include "host_memory.h"
+#include "host_comm.h"
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <iostream>
+#include <exception>
+#include <algorithm>
+
+namespace
+{
+	// Written by the managed side only. The sequence is odd while a snapshot is being written.
+	struct alignas(64) MemoryStatsBlock
+	{
+		std::atomic<uint64_t> sequence{ 0 };
+		HostComm::ManagedMemoryStats stats;
+	};
+
+	struct Threshold
+	{
+		int32_t id;
+		HostComm::MemoryMetric metric;
+		uint64_t bytes;
+		HostComm::MemoryThresholdHandler handler;
+		bool isCrossed = false;
+	};
+
+	MemoryStatsBlock g_block;
+	std::once_flag g_attached;
+
+	std::mutex g_thresholdsMutex;
+	std::vector<Threshold> g_thresholds;
+	int32_t g_nextThresholdId = 0;
+}
+
+static void Attach()
+{
+	std::call_once(g_attached, []()
+	{
+		auto attach = HostComm::GetHostMethod<void(std::atomic<uint64_t>*, HostComm::ManagedMemoryStats*)>(NH_STR("ManagedApp.HostMemory"), NH_STR("Attach"));
+		attach(&g_block.sequence, &g_block.stats);
+	});
+}
+
+namespace HostComm
+{
+	uint64_t GetMemoryMetric(const ManagedMemoryStats& stats, MemoryMetric metric)
+	{
+		switch (metric)
+		{
+		case MemoryMetric::HEAP_SIZE: return stats.heapSizeBytes;
+		case MemoryMetric::FRAGMENTED: return stats.fragmentedBytes;
+		case MemoryMetric::COMMITTED: return stats.committedBytes;
+		case MemoryMetric::CURRENT_HEAP: return stats.currentHeapBytes;
+		case MemoryMetric::PINNED_OBJECT_HEAP: return stats.GetPinnedObjectHeapBytes();
+		case MemoryMetric::MEMORY_LOAD: return stats.memoryLoadBytes;
+		case MemoryMetric::WORKING_SET: return stats.workingSetBytes;
+		}
+
+		return 0;
+	}
+
+	void StartMemoryTelemetry(std::chrono::milliseconds interval)
+	{
+		Attach();
+
+		auto start = GetHostMethod<void(int32_t)>(NH_STR("ManagedApp.HostMemory"), NH_STR("Start"));
+		start((int32_t)std::max<int64_t>(interval.count(), 1));
+	}
+
+	void StopMemoryTelemetry()
+	{
+		auto stop = GetHostMethod<void()>(NH_STR("ManagedApp.HostMemory"), NH_STR("Stop"));
+		stop();
+	}
+
+	ManagedMemoryStats GetManagedMemoryStats()
+	{
+		while (true)
+		{
+			uint64_t sequence = g_block.sequence.load(std::memory_order_acquire);
+			if ((sequence & 1) != 0)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			ManagedMemoryStats stats;
+			memcpy(&stats, &g_block.stats, sizeof(stats));
+
+			// Written over while being copied if the sequence has changed, so copied again then.
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (g_block.sequence.load(std::memory_order_relaxed) == sequence)
+				return stats;
+		}
+	}
+
+	ManagedMemoryStats UpdateManagedMemoryStats()
+	{
+		Attach();
+
+		auto publish = GetHostMethod<void()>(NH_STR("ManagedApp.HostMemory"), NH_STR("Publish"));
+		publish();
+
+		return GetManagedMemoryStats();
+	}
+
+	int32_t AddMemoryThreshold(MemoryMetric metric, uint64_t thresholdBytes, MemoryThresholdHandler handler)
+	{
+		std::lock_guard lock{ g_thresholdsMutex };
+
+		int32_t id = g_nextThresholdId++;
+		g_thresholds.push_back({ id, metric, thresholdBytes, std::move(handler) });
+		return id;
+	}
+
+	void RemoveMemoryThreshold(int32_t id)
+	{
+		std::lock_guard lock{ g_thresholdsMutex };
+		std::erase_if(g_thresholds, [id](const Threshold& threshold) { return threshold.id == id; });
+	}
+
+	void CollectManagedMemory(bool isCompacting)
+	{
+		Attach();
+
+		auto collect = GetHostMethod<void(int32_t)>(NH_STR("ManagedApp.HostMemory"), NH_STR("Collect"));
+		collect(isCompacting ? 1 : 0);
+	}
+
+	void DELEGATE_CALLTYPE Builtins::MemoryStatsPublished()
+	{
+		ManagedMemoryStats stats = GetManagedMemoryStats();
+
+		// The handlers are called without the lock, so they can add and remove thresholds, or collect (which publishes again).
+		std::vector<Threshold> crossed;
+		{
+			std::lock_guard lock{ g_thresholdsMutex };
+
+			for (Threshold& threshold : g_thresholds)
+			{
+				bool isAbove = GetMemoryMetric(stats, threshold.metric) >= threshold.bytes;
+				if (isAbove && !threshold.isCrossed)
+					crossed.push_back(threshold);
+
+				threshold.isCrossed = isAbove;
+			}
+		}
+
+		// Called from the managed timer's thread, which an exception can't go through, and one handler failing shouldn't keep
+		// the others from being called.
+		for (const Threshold& threshold : crossed)
+		{
+			try
+			{
+				threshold.handler(stats, threshold.metric, threshold.bytes);
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << "The memory threshold handler " << threshold.id << " has thrown an exception: " << e.what() << "\n";
+			}
+			catch (...)
+			{
+				std::cerr << "The memory threshold handler " << threshold.id << " has thrown an exception\n";
+			}
+		}
+	}
+}
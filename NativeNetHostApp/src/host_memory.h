@@ -0,0 +1,95 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+#include "net_hosting.h"
+
+// Watching the memory of the hosted runtime from the native side. Once StartMemoryTelemetry() is called, the managed side
+// (ManagedApp.HostMemory) publishes the GC heap statistics into a block of native memory on a timer, under a sequence
+// lock, so GetManagedMemoryStats() only copies the last published snapshot and never calls into the runtime.
+// After every publication, the thresholds registered with AddMemoryThreshold() are checked, and the callbacks of the
+// ones that have just been crossed are called, e.g. to shed load or to CollectManagedMemory() before the container's
+// memory limit is hit.
+//
+// Most of the GC's numbers are as of the end of the last GC (GCMemoryInfo), except currentHeapBytes, workingSetBytes and
+// totalAllocatedBytes, which are as of the publication.
+
+namespace HostComm
+{
+	// Mirrored by MemoryStats in HostMemory.cs.
+	struct ManagedMemoryStats
+	{
+		uint64_t publications = 0; // How many snapshots have been published, 0 while there's none yet.
+		uint64_t gcIndex = 0; // Of the last GC the GC's numbers are from.
+
+		uint64_t heapSizeBytes = 0;
+		uint64_t fragmentedBytes = 0;
+		uint64_t committedBytes = 0;
+		uint64_t currentHeapBytes = 0; // The bytes thought to be allocated on the heap right now (GC.GetTotalMemory()).
+
+		// Sizes of generations 0, 1 and 2, of the large object heap and of the pinned object heap.
+		uint64_t generationBytes[5]{};
+		uint64_t pinnedObjects = 0; // Pinned by handles or `fixed` during the last GC (the pinned object heap not included).
+
+		uint64_t memoryLoadBytes = 0; // The memory in use on the machine, or in the container.
+		uint64_t totalAvailableMemoryBytes = 0; // The limit the GC works with (the container's, if there's one).
+		uint64_t highMemoryLoadThresholdBytes = 0; // Where the GC starts collecting more aggressively.
+		uint64_t workingSetBytes = 0; // Of the whole process, native memory included.
+
+		uint64_t totalAllocatedBytes = 0;
+		uint64_t collections[3]{}; // Of generations 0, 1 and 2.
+		double pauseTimePercentage = 0;
+
+		uint64_t GetPinnedObjectHeapBytes() const { return generationBytes[4]; }
+	};
+
+	enum class MemoryMetric
+	{
+		HEAP_SIZE,
+		FRAGMENTED,
+		COMMITTED,
+		CURRENT_HEAP,
+		PINNED_OBJECT_HEAP,
+		MEMORY_LOAD,
+		WORKING_SET,
+	};
+
+	uint64_t GetMemoryMetric(const ManagedMemoryStats& stats, MemoryMetric metric);
+
+	// Called on the managed side's timer thread, so it should be quick (handing the work off if it isn't). An exception
+	// thrown by it is logged and dropped.
+	typedef std::function<void(const ManagedMemoryStats& stats, MemoryMetric metric, uint64_t thresholdBytes)> MemoryThresholdHandler;
+
+	// Start publishing the statistics every `interval` (and once right away). Requires HostComm to be initialized.
+	// Calling it again changes the interval.
+	void StartMemoryTelemetry(std::chrono::milliseconds interval = std::chrono::seconds(1));
+
+	// Stop the timer, and wait for a publication it has started to finish (with its threshold handlers), unless it's
+	// called from one of those handlers.
+	void StopMemoryTelemetry();
+
+	// Copy the last published snapshot. Never calls into the runtime, so it costs about as much as copying the struct.
+	ManagedMemoryStats GetManagedMemoryStats();
+
+	// Have the managed side publish a new snapshot right now (checking the thresholds too), and get it.
+	ManagedMemoryStats UpdateManagedMemoryStats();
+
+	// Call the handler once a published snapshot has the metric at or above `thresholdBytes`. It's called again only after
+	// the metric has dropped below the threshold in a later snapshot, so it's called once per crossing, not per snapshot.
+	// HEAP_SIZE, FRAGMENTED, COMMITTED, PINNED_OBJECT_HEAP and MEMORY_LOAD only change after a GC (and are 0 until the first
+	// one), so a threshold on them can't fire before the GC runs. CURRENT_HEAP and WORKING_SET are measured at every
+	// publication.
+	/// @return The ID to remove the threshold with.
+	int32_t AddMemoryThreshold(MemoryMetric metric, uint64_t thresholdBytes, MemoryThresholdHandler handler);
+	void RemoveMemoryThreshold(int32_t id);
+
+	// Run a blocking full GC on the managed side, compacting the large object heap too if `isCompacting`, and publish the
+	// statistics after it.
+	void CollectManagedMemory(bool isCompacting = true);
+
+	namespace Builtins
+	{
+		void DELEGATE_CALLTYPE MemoryStatsPublished();
+	}
+}
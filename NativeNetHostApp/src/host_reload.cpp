@@ -0,0 +1,268 @@
+#include "host_reload.h"
+#include "host_comm.h"
+
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+
+static NetHost::ManagedFunction<int32_t(const char_t*)> GetLoader()
+{
+	return HostComm::GetHostMethod<int32_t(const char_t*)>(NH_STR("ManagedApp.HostReload"), NH_STR("Load"));
+}
+
+// Rebinds the registries' methods of the old version to the new one.
+static bool SwapRegistrations(int32_t oldId, int32_t newId)
+{
+	auto swap = HostComm::GetHostMethod<int32_t(int32_t, int32_t)>(NH_STR("ManagedApp.HostReload"), NH_STR("Swap"));
+	return swap(oldId, newId) != 0;
+}
+
+static void* GetVersionMethod(int32_t id, const char_t* typeName, const char_t* methodName)
+{
+	auto getFunction = HostComm::GetHostMethod<void*(int32_t, const char_t*, const char_t*)>(NH_STR("ManagedApp.HostReload"), NH_STR("GetFunction"));
+	return getFunction(id, typeName, methodName);
+}
+
+static uint64_t GetElapsedNs(std::chrono::steady_clock::time_point start)
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+namespace HostComm
+{
+	thread_local const ReloadableAssembly::CallScope* ReloadableAssembly::CallScope::innermost = nullptr;
+
+	ReloadableAssembly::CallScope::CallScope(ReloadableAssembly& assembly) : outer(innermost)
+	{
+		// The reload swaps the version first and then waits for its calls, so a call that sees the same version after
+		// registering itself is sure to be waited for.
+		while (true)
+		{
+			version = assembly.current.load();
+			version->activeCalls.fetch_add(1);
+
+			if (assembly.current.load() == version)
+			{
+				innermost = this;
+				return;
+			}
+
+			version->activeCalls.fetch_sub(1, std::memory_order_release);
+		}
+	}
+
+	ReloadableAssembly::CallScope::~CallScope()
+	{
+		innermost = outer;
+		version->activeCalls.fetch_sub(1, std::memory_order_release);
+	}
+
+	int32_t ReloadableAssembly::CallScope::CountOnThisThread(const Version* version)
+	{
+		int32_t count = 0;
+		for (const CallScope* scope = innermost; scope != nullptr; scope = scope->outer)
+		{
+			if (scope->version == version)
+				count++;
+		}
+
+		return count;
+	}
+
+	ReloadableAssembly::ReloadableAssembly(const std::filesystem::path& assemblyPath) : assemblyPath(assemblyPath)
+	{
+		std::unique_ptr<Version> version = LoadVersion(assemblyPath, 0);
+		if (version == nullptr)
+			throw std::runtime_error{ "Failed to load the reloadable assembly: " + assemblyPath.string() };
+
+		current.store(version.get());
+		versions.push_back(std::move(version));
+	}
+
+	ReloadableAssembly::~ReloadableAssembly()
+	{
+		for (Version* version : deferredUnloads)
+			UnloadVersion(*version);
+
+		UnloadVersion(*current.load());
+	}
+
+	std::unique_ptr<ReloadableAssembly::Version> ReloadableAssembly::LoadVersion(const std::filesystem::path& path, uint32_t number)
+	{
+		auto version = std::make_unique<Version>();
+		version->number = number;
+		version->id = GetLoader()(path.c_str());
+		if (version->id < 0)
+			return nullptr;
+
+		for (size_t slot = 0; slot < functionNames.size(); slot++)
+		{
+			void* function = GetVersionMethod(version->id, functionNames[slot].typeName.c_str(), functionNames[slot].methodName.c_str());
+			if (function == nullptr)
+			{
+				UnloadVersion(*version);
+				return nullptr;
+			}
+
+			version->functions[slot].store(function, std::memory_order_relaxed);
+		}
+
+		// The version's own copy of HostComm (if it has one) starts uninitialized.
+		std::basic_string<char_t> hostCommType{ NH_STR("ManagedApp.HostComm, ") };
+		hostCommType += GetHostAssemblyName();
+
+		if (void* initHostComm = GetVersionMethod(version->id, hostCommType.c_str(), NH_STR("Init")))
+		{
+			try
+			{
+				InitCopy(initHostComm);
+			}
+			catch (...)
+			{
+				UnloadVersion(*version);
+				throw;
+			}
+		}
+
+		return version;
+	}
+
+	bool ReloadableAssembly::UnloadVersion(Version& version)
+	{
+		auto unload = GetHostMethod<int32_t(int32_t)>(NH_STR("ManagedApp.HostReload"), NH_STR("Unload"));
+		return unload(version.id) != 0;
+	}
+
+	void ReloadableAssembly::UnloadDeferred()
+	{
+		std::erase_if(deferredUnloads, [this](Version* version)
+		{
+			if (version->activeCalls.load() != 0)
+				return false;
+
+			UnloadVersion(*version);
+			return true;
+		});
+
+		stats.deferredUnloads = (uint32_t)deferredUnloads.size();
+	}
+
+	size_t ReloadableAssembly::ResolveFunction(const char_t* typeName, const char_t* methodName)
+	{
+		std::lock_guard lock{ mutex };
+
+		for (size_t slot = 0; slot < functionNames.size(); slot++)
+		{
+			if (functionNames[slot].typeName == typeName && functionNames[slot].methodName == methodName)
+				return slot;
+		}
+
+		if (functionNames.size() == MAX_FUNCTIONS)
+			throw std::length_error{ "Too many functions are resolved in the reloadable assembly" };
+
+		Version* version = current.load();
+		void* function = GetVersionMethod(version->id, typeName, methodName);
+		if (function == nullptr)
+			throw std::invalid_argument{ "The managed method is not found, or isn't [UnmanagedCallersOnly]" };
+
+		size_t slot = functionNames.size();
+		version->functions[slot].store(function, std::memory_order_release);
+		functionNames.push_back({ typeName, methodName });
+		return slot;
+	}
+
+	void ReloadableAssembly::AddReloadHandler(ReloadHandler handler)
+	{
+		std::lock_guard lock{ mutex };
+		reloadHandlers.push_back(std::move(handler));
+	}
+
+	bool ReloadableAssembly::Reload(const std::optional<std::filesystem::path>& newAssemblyPath)
+	{
+		// The mutex is held while the handlers run, so locking it again would deadlock.
+		if (reloadingThread.load() == std::this_thread::get_id())
+			throw std::logic_error{ "The reloadable assembly can't be reloaded from a reload handler" };
+
+		std::lock_guard lock{ mutex };
+		UnloadDeferred();
+
+		Version* oldVersion = current.load();
+		if (newAssemblyPath.has_value())
+			assemblyPath = *newAssemblyPath;
+
+		auto start = std::chrono::steady_clock::now();
+		std::unique_ptr<Version> newVersion = LoadVersion(assemblyPath, oldVersion->number + 1);
+		if (newVersion == nullptr)
+			return false;
+
+		Version* version = newVersion.get();
+		versions.push_back(std::move(newVersion));
+
+		reloadingThread.store(std::this_thread::get_id());
+		try
+		{
+			for (const ReloadHandler& handler : reloadHandlers)
+				handler(*this, version->number);
+		}
+		catch (...)
+		{
+			reloadingThread.store({});
+			UnloadVersion(*version);
+			throw;
+		}
+
+		reloadingThread.store({});
+
+		// The registries are rebound last, since that can't be undone.
+		if (!SwapRegistrations(oldVersion->id, version->id))
+		{
+			UnloadVersion(*version);
+			return false;
+		}
+
+		stats.lastLoadNs = GetElapsedNs(start);
+
+		current.store(version);
+		stats.version = version->number;
+
+		// Waiting for the calls this thread is nested in would never end, so the old version is left to a later reload.
+		if (CallScope::CountOnThisThread(oldVersion) != 0)
+		{
+			deferredUnloads.push_back(oldVersion);
+			stats.deferredUnloads = (uint32_t)deferredUnloads.size();
+			stats.lastDrainNs = 0;
+			stats.lastUnloadNs = 0;
+			stats.isLastUnloadCollected = false;
+			return true;
+		}
+
+		start = std::chrono::steady_clock::now();
+		while (oldVersion->activeCalls.load() != 0)
+			std::this_thread::yield();
+
+		stats.lastDrainNs = GetElapsedNs(start);
+
+		start = std::chrono::steady_clock::now();
+		stats.isLastUnloadCollected = UnloadVersion(*oldVersion);
+		stats.lastUnloadNs = GetElapsedNs(start);
+
+		return true;
+	}
+
+	ReloadStats ReloadableAssembly::GetStats()
+	{
+		std::lock_guard lock{ mutex };
+		return stats;
+	}
+
+	void* ReloadableAssembly::GetVersionFunction(uint32_t version, const char_t* typeName, const char_t* methodName)
+	{
+		for (const std::unique_ptr<Version>& loaded : versions)
+		{
+			if (loaded->number == version)
+				return GetVersionMethod(loaded->id, typeName, methodName);
+		}
+
+		return nullptr;
+	}
+}
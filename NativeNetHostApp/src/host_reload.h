@@ -0,0 +1,185 @@
+#pragma once
+#include <mutex>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <functional>
+#include <thread>
+#include <filesystem>
+
+#include "net_hosting.h"
+
+// Reloading a managed assembly without restarting the host. Every version of the assembly is loaded into its own
+// collectible load context (ManagedApp.HostReload), and Reload() swaps a new version in atomically: the calls that have
+// started keep running in the old version, the new ones go to the new version, and the old version is unloaded once
+// its last call returns. The calls never wait for a reload, so a reload interrupts nothing. A reload from inside a call
+// into the assembly (on the same thread) doesn't wait for that call either: the old version is left loaded then, and
+// unloaded by a later reload once its calls have returned.
+//
+// The functions are resolved through ReloadableFunction handles, which follow the swaps. When the assembly (or one of
+// its dependencies next to it) contains a copy of the managed HostComm, each version's copy is initialized with the same
+// native utilities as the main one.
+//
+// Reloadable functions must be [UnmanagedCallersOnly] static methods. The other registries (batch and async entrypoints,
+// file and buffer handlers, column kernels) look the types of the assembly (assembly qualified with its name) up in the
+// current version, and their methods are rebound to the new version right before it's swapped in. Their calls aren't
+// waited for, but keep the old version from being collected until they return.
+
+namespace HostComm
+{
+	class ReloadableAssembly;
+
+	template<typename Signature>
+	class ReloadableFunction;
+
+	// Calls whatever version of the method is current, resolving it only once per version.
+	template<typename R, typename... Args>
+	class ReloadableFunction<R(Args...)>
+	{
+	public:
+		typedef R (DELEGATE_CALLTYPE *Pointer)(Args...);
+
+	private:
+		ReloadableAssembly* assembly = nullptr;
+		size_t slot = 0;
+
+	public:
+		ReloadableFunction() = default;
+		ReloadableFunction(ReloadableAssembly* assembly, size_t slot) : assembly(assembly), slot(slot) {}
+
+		R operator()(Args... args) const;
+
+		bool HasValue() const { return assembly != nullptr; }
+	};
+
+	struct ReloadStats
+	{
+		uint32_t version = 0; // How many times the assembly has been reloaded.
+		uint64_t lastLoadNs = 0; // Loading the new version, resolving every function in it, and rebinding the registries.
+		uint64_t lastDrainNs = 0; // Waiting for the calls still running in the old version to return.
+		uint64_t lastUnloadNs = 0; // Unloading the old version, and collecting it.
+		bool isLastUnloadCollected = true; // False if something still referenced the old version when the reload returned.
+		uint32_t deferredUnloads = 0; // Old versions left loaded by reloads from inside calls into them, not unloaded yet.
+	};
+
+	class ReloadableAssembly
+	{
+	public:
+		// The most functions an assembly can have resolved, so the resolved pointers of a version never move.
+		static constexpr size_t MAX_FUNCTIONS = 256;
+
+		// Called when a new version has been loaded, before it's swapped in, to set up what depends on it. The methods of the
+		// new version can be reached with GetVersionFunction() from there.
+		typedef std::function<void(ReloadableAssembly& assembly, uint32_t version)> ReloadHandler;
+
+	private:
+		struct Version
+		{
+			int32_t id = -1; // Of the managed load context.
+			uint32_t number = 0;
+			std::array<std::atomic<void*>, MAX_FUNCTIONS> functions{};
+			std::atomic<int32_t> activeCalls{ 0 };
+		};
+
+		struct FunctionName
+		{
+			std::basic_string<char_t> typeName;
+			std::basic_string<char_t> methodName;
+		};
+
+		std::filesystem::path assemblyPath;
+
+		// Serializes reloads and resolving new functions.
+		std::mutex mutex;
+		std::vector<FunctionName> functionNames;
+		std::vector<ReloadHandler> reloadHandlers;
+		ReloadStats stats;
+
+		// Replaced versions are never freed (only their load contexts are unloaded), since a caller on another thread may
+		// still be about to look into one.
+		std::vector<std::unique_ptr<Version>> versions;
+		std::atomic<Version*> current{ nullptr };
+
+		// Replaced while the reloading thread had calls running in them, so they're unloaded by a later reload.
+		std::vector<Version*> deferredUnloads;
+
+		// The thread running the reload handlers, which can't reload again.
+		std::atomic<std::thread::id> reloadingThread;
+
+	public:
+		// Load the first version of the assembly. Requires HostComm to be initialized.
+		// Throws std::runtime_error if the assembly can't be loaded.
+		explicit ReloadableAssembly(const std::filesystem::path& assemblyPath);
+
+		// Unloads the current version. Nothing may be calling into the assembly anymore.
+		~ReloadableAssembly();
+
+		ReloadableAssembly(const ReloadableAssembly&) = delete;
+		ReloadableAssembly& operator=(const ReloadableAssembly&) = delete;
+
+		// Resolve a method in the current version (and in every later one).
+		/// @param typeName The full type name, optionally assembly qualified to look it up in a dependency.
+		/// Throws std::invalid_argument if it's not found.
+		template<typename Signature>
+		ReloadableFunction<Signature> GetFunction(const char_t* typeName, const char_t* methodName)
+		{
+			return ReloadableFunction<Signature>{ this, ResolveFunction(typeName, methodName) };
+		}
+
+		void AddReloadHandler(ReloadHandler handler);
+
+		// Load a new version of the assembly (from the same path by default), swap it in, and unload the old version once
+		// its calls have returned. If the new version can't be loaded, or lacks one of the functions resolved so far or of
+		// the methods registered with the other registries, the old version stays. Throws std::logic_error if it's called
+		// from a reload handler. If a reload handler throws, the new version is unloaded and the exception is passed on.
+		/// @return False if the new version hasn't been swapped in.
+		bool Reload(const std::optional<std::filesystem::path>& newAssemblyPath = {});
+
+		uint32_t GetVersion() const { return current.load(std::memory_order_acquire)->number; }
+		ReloadStats GetStats();
+
+		// Get a pointer to a method of a specific version. Only for reload handlers, which run while the versions can't
+		// change. Returns nullptr if it's not found.
+		void* GetVersionFunction(uint32_t version, const char_t* typeName, const char_t* methodName);
+
+		// Keeps the current version from being unloaded while a call is running in it.
+		class CallScope
+		{
+		private:
+			// The scopes of a thread are chained from the innermost one, so a reload can tell the calls it's nested in.
+			static thread_local const CallScope* innermost;
+
+			Version* version;
+			const CallScope* outer;
+
+		public:
+			explicit CallScope(ReloadableAssembly& assembly);
+			~CallScope();
+
+			CallScope(const CallScope&) = delete;
+			CallScope& operator=(const CallScope&) = delete;
+
+			void* GetFunction(size_t slot) const { return version->functions[slot].load(std::memory_order_acquire); }
+
+			/// @return How many calls the calling thread has running in the version.
+			static int32_t CountOnThisThread(const Version* version);
+		};
+
+	private:
+		size_t ResolveFunction(const char_t* typeName, const char_t* methodName);
+		std::unique_ptr<Version> LoadVersion(const std::filesystem::path& path, uint32_t number);
+		bool UnloadVersion(Version& version);
+		void UnloadDeferred();
+	};
+
+	template<typename R, typename... Args>
+	R ReloadableFunction<R(Args...)>::operator()(Args... args) const
+	{
+		ReloadableAssembly::CallScope scope{ *assembly };
+		return ((Pointer)scope.GetFunction(slot))(args...);
+	}
+}
@@ -0,0 +1,314 @@
+#include "host_trace.h"
+#include "startup_profile.h"
+
+#include <mutex>
+#include <deque>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <unordered_map>
+
+namespace
+{
+	struct TraceEvent
+	{
+		int64_t timeNs; // steady_clock, the same as the startup profile.
+		uint32_t nameId;
+		bool isEnd;
+	};
+
+	constexpr size_t CHUNK_EVENTS = 4096;
+
+	// Only the owning thread appends to a chunk. It publishes the events by storing the count, so WriteTrace() can read
+	// them while the thread goes on recording.
+	struct TraceChunk
+	{
+		std::array<TraceEvent, CHUNK_EVENTS> events;
+		std::atomic<uint32_t> count{ 0 };
+		std::atomic<TraceChunk*> next{ nullptr };
+	};
+
+	struct ThreadTrace
+	{
+		uint32_t threadId = 0;
+
+		// Set while the thread is recording, so StartTrace() waits for it before freeing the chunks.
+		std::atomic<bool> isRecording{ false };
+
+		std::atomic<TraceChunk*> first{ nullptr };
+		TraceChunk* last = nullptr; // Only used by the owning thread (and StartTrace(), while it's not recording).
+		size_t events = 0;
+		std::atomic<uint64_t> dropped{ 0 };
+
+		~ThreadTrace()
+		{
+			TraceChunk* chunk = first.load(std::memory_order_relaxed);
+			while (chunk != nullptr)
+				delete std::exchange(chunk, chunk->next.load(std::memory_order_relaxed));
+		}
+	};
+
+	// Threads are never removed, so a thread's calls stay in the trace after it exits.
+	std::mutex g_traceMutex;
+	std::vector<std::unique_ptr<ThreadTrace>> g_threads;
+	std::deque<std::string> g_names; // Indexed by the name ID.
+	std::unordered_map<std::string, uint32_t> g_nameIds;
+
+	thread_local ThreadTrace* t_thread = nullptr;
+
+	ThreadTrace* GetThreadTrace()
+	{
+		if (t_thread != nullptr)
+			return t_thread;
+
+		std::lock_guard lock{ g_traceMutex };
+
+		t_thread = g_threads.emplace_back(std::make_unique<ThreadTrace>()).get();
+		t_thread->threadId = NetHost::GetProfileThreadId();
+		return t_thread;
+	}
+
+	void Record(uint32_t nameId, bool isEnd)
+	{
+		ThreadTrace* thread = GetThreadTrace();
+
+		// Sequentially consistent with the flag StartTrace() sets, so either the trace sees the thread recording and waits
+		// for it, or the thread sees the trace stopped and records nothing.
+		thread->isRecording.store(true);
+		if (NetHost::TraceInternals::g_isTracing.load())
+		{
+			if (thread->events < NetHost::MAX_TRACE_EVENTS_PER_THREAD)
+			{
+				TraceChunk* chunk = thread->last;
+				uint32_t count = chunk != nullptr ? chunk->count.load(std::memory_order_relaxed) : 0;
+
+				if (chunk == nullptr || count == CHUNK_EVENTS)
+				{
+					TraceChunk* next = new TraceChunk{};
+					if (chunk != nullptr)
+						chunk->next.store(next, std::memory_order_release);
+					else
+						thread->first.store(next, std::memory_order_release);
+
+					thread->last = chunk = next;
+					count = 0;
+				}
+
+				int64_t timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+				chunk->events[count] = { timeNs, nameId, isEnd };
+				chunk->count.store(count + 1, std::memory_order_release);
+				thread->events++;
+			}
+			else
+			{
+				thread->dropped.store(thread->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			}
+		}
+
+		thread->isRecording.store(false, std::memory_order_release);
+	}
+
+	void WriteJsonString(std::ostream& output, std::string_view text)
+	{
+		output << '"';
+		for (char ch : text)
+		{
+			if (ch == '"' || ch == '\\')
+				output << '\\' << ch;
+			else if ((unsigned char)ch < 0x20)
+				output << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)ch << std::dec << std::setfill(' ');
+			else
+				output << ch;
+		}
+
+		output << '"';
+	}
+
+	std::string ToUtf8(const char_t* text)
+	{
+		std::u8string utf8 = std::filesystem::path(text).u8string();
+		return std::string(utf8.begin(), utf8.end());
+	}
+}
+
+namespace NetHost
+{
+	void StartTrace()
+	{
+		std::lock_guard lock{ g_traceMutex };
+		if (TraceInternals::g_isTracing.load())
+			return;
+
+		// Nothing records while no trace runs, except for threads that are finishing an event they've started before.
+		for (const std::unique_ptr<ThreadTrace>& thread : g_threads)
+		{
+			while (thread->isRecording.load())
+				std::this_thread::yield();
+
+			TraceChunk* chunk = thread->first.exchange(nullptr);
+			while (chunk != nullptr)
+				delete std::exchange(chunk, chunk->next.load(std::memory_order_relaxed));
+
+			thread->last = nullptr;
+			thread->events = 0;
+			thread->dropped.store(0, std::memory_order_relaxed);
+		}
+
+		TraceInternals::g_isTracing.store(true);
+	}
+
+	void StopTrace()
+	{
+		TraceInternals::g_isTracing.store(false);
+	}
+
+	uint64_t GetDroppedTraceEvents()
+	{
+		std::lock_guard lock{ g_traceMutex };
+
+		uint64_t dropped = 0;
+		for (const std::unique_ptr<ThreadTrace>& thread : g_threads)
+			dropped += thread->dropped.load(std::memory_order_relaxed);
+
+		return dropped;
+	}
+
+	uint32_t InternTraceName(std::string_view name)
+	{
+		std::lock_guard lock{ g_traceMutex };
+
+		auto [entry, isAdded] = g_nameIds.try_emplace(std::string{ name }, (uint32_t)g_names.size());
+		if (isAdded)
+			g_names.emplace_back(name);
+
+		return entry->second;
+	}
+
+	uint32_t InternMethodTraceName(const char_t* typeName, const char_t* methodName)
+	{
+		std::string name = ToUtf8(typeName);
+		name = name.substr(0, name.find(','));
+		name += '.';
+		name += ToUtf8(methodName);
+
+		return InternTraceName(name);
+	}
+
+	void TraceBegin(uint32_t nameId)
+	{
+		if (IsTracing())
+			Record(nameId, false);
+	}
+
+	void TraceEnd(uint32_t nameId)
+	{
+		if (IsTracing())
+			Record(nameId, true);
+	}
+
+	bool WriteTrace(const std::filesystem::path& filePath)
+	{
+		StartupProfile profile = GetStartupProfile();
+
+		std::lock_guard lock{ g_traceMutex };
+
+		std::ofstream output{ filePath, std::ios::trunc };
+		if (!output)
+			return false;
+
+		// Everything is timed from the earliest event, whether it's a startup phase or a traced one.
+		int64_t profileOriginNs = std::chrono::duration_cast<std::chrono::nanoseconds>(profile.origin.time_since_epoch()).count();
+		int64_t originNs = !profile.phases.empty() ? profileOriginNs : INT64_MAX;
+
+		for (const std::unique_ptr<ThreadTrace>& thread : g_threads)
+		{
+			if (TraceChunk* chunk = thread->first.load(std::memory_order_acquire); chunk != nullptr && chunk->count.load(std::memory_order_acquire) != 0)
+				originNs = std::min(originNs, chunk->events[0].timeNs);
+		}
+
+		auto toUs = [originNs](int64_t timeNs) { return (double)(timeNs - originNs) / 1000.0; };
+		const char* separator = "";
+
+		// Startup phases as complete ("X") events, and the traced spans as begin ("B") and end ("E") events, with the
+		// timestamps in microseconds.
+		output << std::fixed << std::setprecision(3);
+		output << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+		for (const StartupPhase& phase : profile.phases)
+		{
+			output << separator << "{\"name\":\"" << phase.name << "\",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":" << phase.threadId
+				<< ",\"ts\":" << toUs(profileOriginNs + (int64_t)phase.startNs) << ",\"dur\":" << phase.durationNs / 1000.0 << "}";
+			separator = ",\n";
+		}
+
+		auto writeEvent = [&](const ThreadTrace& thread, const TraceEvent& event)
+		{
+			output << separator << "{\"name\":";
+			WriteJsonString(output, g_names[event.nameId]);
+			output << ",\"cat\":\"host\",\"ph\":\"" << (event.isEnd ? 'E' : 'B') << "\",\"pid\":1,\"tid\":" << thread.threadId
+				<< ",\"ts\":" << toUs(event.timeNs) << "}";
+			separator = ",\n";
+		};
+
+		for (const std::unique_ptr<ThreadTrace>& thread : g_threads)
+		{
+			// A span may have begun before the trace has started, or not have ended yet, so the ends without a beginning
+			// are skipped and the spans still open are closed at the thread's last event.
+			std::vector<uint32_t> openSpans;
+			int64_t lastTimeNs = 0;
+
+			for (TraceChunk* chunk = thread->first.load(std::memory_order_acquire); chunk != nullptr; chunk = chunk->next.load(std::memory_order_acquire))
+			{
+				uint32_t count = chunk->count.load(std::memory_order_acquire);
+				for (uint32_t i = 0; i < count; i++)
+				{
+					const TraceEvent& event = chunk->events[i];
+					if (event.isEnd)
+					{
+						if (openSpans.empty())
+							continue;
+
+						openSpans.pop_back();
+					}
+					else
+					{
+						openSpans.push_back(event.nameId);
+					}
+
+					writeEvent(*thread, event);
+					lastTimeNs = event.timeNs;
+				}
+			}
+
+			while (!openSpans.empty())
+			{
+				writeEvent(*thread, { lastTimeNs, openSpans.back(), true });
+				openSpans.pop_back();
+			}
+		}
+
+		output << "\n]}\n";
+		return (bool)output;
+	}
+}
+
+uint32_t DELEGATE_CALLTYPE HostComm::Builtins::TraceName(const char* name)
+{
+	return NetHost::InternTraceName(name != nullptr ? name : "");
+}
+
+void DELEGATE_CALLTYPE HostComm::Builtins::TraceBegin(uint32_t nameId)
+{
+	NetHost::TraceBegin(nameId);
+}
+
+void DELEGATE_CALLTYPE HostComm::Builtins::TraceEnd(uint32_t nameId)
+{
+	NetHost::TraceEnd(nameId);
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+#include <filesystem>
+
+#include "net_hosting.h"
+
+// Tracing calls across the boundary: native code calling managed entrypoints, managed code calling native utilities,
+// and spans the managed side marks itself (ManagedApp.HostTrace), all on one timeline. Every thread records begin/end
+// events into its own buffer without locking, timestamped by the same steady clock as the startup profile, and
+// WriteTrace() writes them, along with the startup phases, into a single Chrome trace (JSON) that chrome://tracing or
+// Perfetto can open.
+//
+// What's traced:
+// - Calls through TracedFunction, which GetTracedFunction() resolves like the runtime delegates' GetFunction().
+// - Native utility calls, through the trampolines of host_utility_stats.h. So only the typed utilities registered after
+//   HostComm::EnableUtilityStats() are traced.
+// - TraceSpan scopes, and the managed HostTrace spans (through the `hostcomm_trace_*` native utilities).
+//
+// Spans must end on the thread they've begun on. Recording costs a branch while no trace is running.
+
+namespace NetHost
+{
+	// Past this many events, a thread's events are dropped until the next trace starts.
+	constexpr size_t MAX_TRACE_EVENTS_PER_THREAD = 1 << 20;
+
+	namespace TraceInternals
+	{
+		inline std::atomic<bool> g_isTracing{ false };
+	}
+
+	inline bool IsTracing() { return TraceInternals::g_isTracing.load(std::memory_order_relaxed); }
+
+	// Start recording, discarding what the previous trace has recorded. Does nothing if a trace is running.
+	void StartTrace();
+	void StopTrace();
+
+	// Write the startup phases and the events recorded since the trace has started. Can be called while the trace runs,
+	// but not at the same time as StartTrace().
+	/// @return False if the file couldn't be written.
+	bool WriteTrace(const std::filesystem::path& filePath);
+
+	// How many events the threads have dropped in this trace because their buffers were full.
+	uint64_t GetDroppedTraceEvents();
+
+	// Get the ID of an event name, to record events with. The same name always gets the same ID.
+	uint32_t InternTraceName(std::string_view name);
+
+	// Record the beginning and the end of a span on the current thread. Does nothing if no trace is running.
+	void TraceBegin(uint32_t nameId);
+	void TraceEnd(uint32_t nameId);
+
+	// Traces the scope it lives in, if a trace is running when it's constructed.
+	class TraceSpan
+	{
+	private:
+		uint32_t nameId;
+		bool isTraced;
+
+	public:
+		explicit TraceSpan(uint32_t nameId) : nameId(nameId), isTraced(IsTracing())
+		{
+			if (isTraced)
+				TraceBegin(nameId);
+		}
+
+		~TraceSpan()
+		{
+			if (isTraced)
+				TraceEnd(nameId);
+		}
+
+		TraceSpan(const TraceSpan&) = delete;
+		TraceSpan& operator=(const TraceSpan&) = delete;
+	};
+
+	// A ManagedFunction that traces its calls, named after the managed method. Costs a branch more per call while no
+	// trace is running.
+	template<typename Signature>
+	class TracedFunction;
+
+	template<typename R, typename... Args>
+	class TracedFunction<R(Args...)>
+	{
+	public:
+		typedef R (DELEGATE_CALLTYPE *Pointer)(Args...);
+
+	private:
+		Pointer pointer = nullptr;
+		uint32_t nameId = 0;
+
+	public:
+		TracedFunction() = default;
+		TracedFunction(void* pointer, uint32_t nameId) : pointer((Pointer)pointer), nameId(nameId) {}
+
+		R operator()(Args... args) const
+		{
+			TraceSpan span{ nameId };
+			return pointer(args...);
+		}
+
+		bool HasValue() const { return pointer != nullptr; }
+		Pointer Get() const { return pointer; }
+	};
+
+	// The name managed methods are traced by: "Namespace.Type.Method", without the assembly of the type.
+	uint32_t InternMethodTraceName(const char_t* typeName, const char_t* methodName);
+
+	template<typename Signature>
+	TracedFunction<Signature> GetTracedFunction(const rd_LoadAssemblyAndGetFuncPointer& loadAndGetFuncPointer, const char_t* assemblyPath,
+		const char_t* typeName, const char_t* methodName, const char_t* delegateTypeName = nullptr)
+	{
+		return { loadAndGetFuncPointer(assemblyPath, typeName, methodName, delegateTypeName), InternMethodTraceName(typeName, methodName) };
+	}
+
+	template<typename Signature>
+	TracedFunction<Signature> GetTracedFunction(const rd_GetFuncPointer& getFuncPointer, const char_t* typeName, const char_t* methodName,
+		const char_t* delegateTypeName = nullptr)
+	{
+		return { getFuncPointer(typeName, methodName, delegateTypeName), InternMethodTraceName(typeName, methodName) };
+	}
+}
+
+namespace HostComm::Builtins
+{
+	uint32_t DELEGATE_CALLTYPE TraceName(const char* name);
+	void DELEGATE_CALLTYPE TraceBegin(uint32_t nameId);
+	void DELEGATE_CALLTYPE TraceEnd(uint32_t nameId);
+}
@@ -0,0 +1,271 @@
+#include "host_utility_stats.h"
+
+#include <mutex>
+#include <deque>
+#include <memory>
+#include <thread>
+
+namespace
+{
+	// Every running thread that has made a counted call. Its counts are added to the retired ones when it exits.
+	struct ThreadSlots
+	{
+		std::array<HostComm::UtilityCounting::Slot*, HostComm::MAX_COUNTED_UTILITIES> slots{};
+		std::array<std::unique_ptr<HostComm::UtilityCounting::Slot>, HostComm::MAX_COUNTED_UTILITIES> ownedSlots;
+	};
+
+	// What the exited threads have counted for a utility.
+	struct RetiredCounts
+	{
+		uint64_t calls = 0;
+		uint64_t sampledTicks = 0;
+		std::array<uint64_t, HostComm::UTILITY_LATENCY_BUCKETS> buckets{};
+	};
+
+	// Retires the slots of the thread when it exits.
+	struct ThreadSlotsOwner
+	{
+		ThreadSlots* thread = nullptr;
+
+		~ThreadSlotsOwner();
+	};
+
+	struct ClockPoint
+	{
+		uint64_t ticks;
+		std::chrono::steady_clock::time_point time;
+
+		static ClockPoint Now()
+		{
+			return { HostComm::UtilityCounting::ReadTicks(), std::chrono::steady_clock::now() };
+		}
+	};
+}
+
+// Names are only ever added, under the mutex, so the pointers handed out stay valid for good. The slots of a thread are
+// only freed by the thread itself, once it's done calling.
+static std::mutex g_statsMutex;
+static std::atomic<bool> g_isEnabled{ false };
+static std::deque<std::string> g_utilityNames;
+static std::vector<RetiredCounts> g_retiredCounts;
+static std::vector<std::unique_ptr<ThreadSlots>> g_threads;
+
+// Plain pointers and flags, so they can still be read while the thread's destructors run.
+static thread_local ThreadSlots* t_thread = nullptr;
+static thread_local bool t_isExiting = false;
+static thread_local ThreadSlotsOwner t_slotsOwner;
+
+// The ticks are converted to nanoseconds by how many of them have passed since stats were enabled, which is at least
+// MIN_CALIBRATION_TIME, since enabling waits that long.
+static ClockPoint g_enabledAt{};
+static constexpr std::chrono::milliseconds MIN_CALIBRATION_TIME{ 10 };
+
+ThreadSlotsOwner::~ThreadSlotsOwner()
+{
+	t_isExiting = true;
+	if (thread == nullptr)
+		return;
+
+	std::lock_guard lock{ g_statsMutex };
+
+	for (size_t index = 0; index < g_retiredCounts.size(); index++)
+	{
+		const HostComm::UtilityCounting::Slot* slot = thread->slots[index];
+		if (slot == nullptr)
+			continue;
+
+		RetiredCounts& retired = g_retiredCounts[index];
+		retired.calls += slot->calls.load(std::memory_order_relaxed);
+		retired.sampledTicks += slot->sampledTicks.load(std::memory_order_relaxed);
+
+		for (size_t bucket = 0; bucket < HostComm::UTILITY_LATENCY_BUCKETS; bucket++)
+			retired.buckets[bucket] += slot->buckets[bucket].load(std::memory_order_relaxed);
+	}
+
+	// A counted call from a later thread_local destructor gets new slots, which are kept for good then.
+	t_thread = nullptr;
+	HostComm::UtilityCounting::t_slots = nullptr;
+	std::erase_if(g_threads, [this](const std::unique_ptr<ThreadSlots>& slots) { return slots.get() == thread; });
+}
+
+static double GetNsPerTick()
+{
+	ClockPoint now = ClockPoint::Now();
+	auto elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time - g_enabledAt.time).count();
+	return now.ticks > g_enabledAt.ticks ? (double)elapsedNs / (double)(now.ticks - g_enabledAt.ticks) : 1.0;
+}
+
+// The upper bound of the bucket the percentile falls into.
+static uint64_t GetPercentileNs(const HostComm::UtilityStats& stats, const std::array<uint64_t, HostComm::UTILITY_LATENCY_BUCKETS>& bucketUpperNs, double percentile)
+{
+	if (stats.sampledCalls == 0)
+		return 0;
+
+	uint64_t rank = (uint64_t)(percentile * (double)(stats.sampledCalls - 1));
+	uint64_t seen = 0;
+
+	for (size_t bucket = 0; bucket < stats.histogram.size(); bucket++)
+	{
+		seen += stats.histogram[bucket];
+		if (seen > rank)
+			return bucketUpperNs[bucket];
+	}
+
+	return bucketUpperNs.back();
+}
+
+// Mirrors HostComm.UtilityStatsEntry (see HostComm.cs).
+struct ManagedUtilityStats
+{
+	const char* name;
+	uint64_t calls;
+	uint64_t sampledCalls;
+	uint64_t totalNs;
+	uint64_t p50Ns;
+	uint64_t p90Ns;
+	uint64_t p99Ns;
+	uint64_t histogram[HostComm::UTILITY_LATENCY_BUCKETS];
+};
+
+namespace HostComm
+{
+	void EnableUtilityStats()
+	{
+		if (g_isEnabled.load(std::memory_order_acquire))
+			return;
+
+		// Calibrated before taking the lock, so the threads making their first counted calls don't wait for it.
+		ClockPoint enabledAt = ClockPoint::Now();
+		std::this_thread::sleep_for(MIN_CALIBRATION_TIME);
+
+		std::lock_guard lock{ g_statsMutex };
+		if (g_isEnabled.load(std::memory_order_relaxed))
+			return;
+
+		g_enabledAt = enabledAt;
+		g_isEnabled.store(true, std::memory_order_release);
+	}
+
+	bool IsUtilityStatsEnabled()
+	{
+		return g_isEnabled.load(std::memory_order_acquire);
+	}
+
+	UtilityStatsSnapshot GetUtilityStats()
+	{
+		std::lock_guard lock{ g_statsMutex };
+
+		UtilityStatsSnapshot snapshot;
+		if (!g_isEnabled.load(std::memory_order_relaxed))
+			return snapshot;
+
+		double nsPerTick = GetNsPerTick();
+		for (size_t bucket = 0; bucket < UTILITY_LATENCY_BUCKETS; bucket++)
+			snapshot.bucketUpperNs[bucket] = (uint64_t)((double)(uint64_t(1) << bucket) * nsPerTick);
+
+		for (size_t index = 0; index < g_utilityNames.size(); index++)
+		{
+			UtilityStats& stats = snapshot.utilities.emplace_back();
+			stats.name = g_utilityNames[index];
+
+			const RetiredCounts& retired = g_retiredCounts[index];
+			stats.calls = retired.calls;
+			stats.histogram = retired.buckets;
+
+			uint64_t sampledTicks = retired.sampledTicks;
+			for (const std::unique_ptr<ThreadSlots>& thread : g_threads)
+			{
+				const UtilityCounting::Slot* slot = thread->slots[index];
+				if (slot == nullptr)
+					continue;
+
+				stats.calls += slot->calls.load(std::memory_order_relaxed);
+				sampledTicks += slot->sampledTicks.load(std::memory_order_relaxed);
+
+				for (size_t bucket = 0; bucket < UTILITY_LATENCY_BUCKETS; bucket++)
+					stats.histogram[bucket] += slot->buckets[bucket].load(std::memory_order_relaxed);
+			}
+
+			for (uint64_t count : stats.histogram)
+				stats.sampledCalls += count;
+
+			if (stats.sampledCalls != 0)
+				stats.totalNs = (uint64_t)((double)sampledTicks * nsPerTick * (double)stats.calls / (double)stats.sampledCalls);
+
+			stats.p50Ns = GetPercentileNs(stats, snapshot.bucketUpperNs, 0.50);
+			stats.p90Ns = GetPercentileNs(stats, snapshot.bucketUpperNs, 0.90);
+			stats.p99Ns = GetPercentileNs(stats, snapshot.bucketUpperNs, 0.99);
+		}
+
+		return snapshot;
+	}
+
+	namespace UtilityCounting
+	{
+		uint32_t AddUtility(const char* utilityName)
+		{
+			std::lock_guard lock{ g_statsMutex };
+
+			for (size_t index = 0; index < g_utilityNames.size(); index++)
+			{
+				if (g_utilityNames[index] == utilityName)
+					return (uint32_t)index;
+			}
+
+			if (g_utilityNames.size() == MAX_COUNTED_UTILITIES)
+				return NOT_COUNTED;
+
+			g_utilityNames.emplace_back(utilityName);
+			g_retiredCounts.emplace_back();
+			return (uint32_t)(g_utilityNames.size() - 1);
+		}
+
+		Slot* CreateSlot(uint32_t index)
+		{
+			std::lock_guard lock{ g_statsMutex };
+
+			if (t_thread == nullptr)
+			{
+				t_thread = g_threads.emplace_back(std::make_unique<ThreadSlots>()).get();
+				t_slots = t_thread->slots.data();
+
+				if (!t_isExiting)
+					t_slotsOwner.thread = t_thread;
+			}
+
+			// The snapshot reads the slot pointers under the mutex, so they're published to it by unlocking.
+			t_thread->ownedSlots[index] = std::make_unique<Slot>();
+			Slot* slot = t_thread->ownedSlots[index].get();
+			t_slots[index] = slot;
+			return slot;
+		}
+	}
+
+	int32_t DELEGATE_CALLTYPE Builtins::GetUtilityStats(void* entries, int32_t capacity, uint64_t* bucketUpperNs)
+	{
+		UtilityStatsSnapshot snapshot = HostComm::GetUtilityStats();
+
+		std::copy(snapshot.bucketUpperNs.begin(), snapshot.bucketUpperNs.end(), bucketUpperNs);
+
+		std::lock_guard lock{ g_statsMutex };
+
+		int32_t count = std::min((int32_t)snapshot.utilities.size(), capacity);
+		for (int32_t i = 0; i < count; i++)
+		{
+			const UtilityStats& stats = snapshot.utilities[i];
+			ManagedUtilityStats& entry = ((ManagedUtilityStats*)entries)[i];
+
+			// The names of the counted utilities are never removed, so the pointer stays valid.
+			entry.name = g_utilityNames[i].c_str();
+			entry.calls = stats.calls;
+			entry.sampledCalls = stats.sampledCalls;
+			entry.totalNs = stats.totalNs;
+			entry.p50Ns = stats.p50Ns;
+			entry.p90Ns = stats.p90Ns;
+			entry.p99Ns = stats.p99Ns;
+			std::copy(stats.histogram.begin(), stats.histogram.end(), entry.histogram);
+		}
+
+		return (int32_t)snapshot.utilities.size();
+	}
+}
@@ -0,0 +1,209 @@
+#pragma once
+#include <bit>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+#include "net_hosting.h"
+#include "host_trace.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+	#include <x86intrin.h>
+#endif
+
+// Counting the calls into native utilities, and how long they take. Once EnableUtilityStats() is called, the typed
+// utilities registered afterwards (RegisterNativeUtility<"name", signature>, and the built-in `hostcomm_` ones if it's
+// called before anything is registered) are registered as counting trampolines instead of their callbacks. A trampoline
+// counts every call in the calling thread's own slot of the utility, so the threads never write to shared cache lines,
+// and times every LATENCY_SAMPLE_INTERVAL-th call with the CPU's timestamp counter. Reading the counter costs more than
+// the rest of the trampoline (a lot more in some VMs), so sampling keeps the cost at a few nanoseconds per call.
+// Utilities registered as plain void* have no known signature to wrap, so they aren't counted. While a trace runs (see
+// host_trace.h), the trampolines trace the calls as well.
+//
+// GetUtilityStats() sums the slots of all threads up. The managed side reads the same with HostComm.GetUtilityStats().
+
+namespace HostComm
+{
+	// The latency histograms have a bucket per power of two ticks of the timestamp counter.
+	constexpr size_t UTILITY_LATENCY_BUCKETS = 48;
+
+	// Every how many calls of a thread one is timed.
+	constexpr uint64_t LATENCY_SAMPLE_INTERVAL = 16;
+
+	// The most utilities that can be counted. The ones registered after that are registered uncounted.
+	constexpr size_t MAX_COUNTED_UTILITIES = 256;
+
+	struct UtilityStats
+	{
+		std::string name;
+		uint64_t calls = 0;
+		uint64_t sampledCalls = 0; // The timed ones.
+		uint64_t totalNs = 0; // Estimated from the timed calls.
+
+		// The upper bounds of the buckets the percentiles fall into, so they may be up to twice the real ones.
+		uint64_t p50Ns = 0;
+		uint64_t p90Ns = 0;
+		uint64_t p99Ns = 0;
+
+		// The timed calls by their latency: bucket i counts those up to UtilityStatsSnapshot::bucketUpperNs[i].
+		std::array<uint64_t, UTILITY_LATENCY_BUCKETS> histogram{};
+	};
+
+	struct UtilityStatsSnapshot
+	{
+		std::vector<UtilityStats> utilities; // In the order they were first registered, including ones with no calls.
+		std::array<uint64_t, UTILITY_LATENCY_BUCKETS> bucketUpperNs{};
+	};
+
+	// Count the typed utilities registered from now on. Can't be turned off, since the trampolines stay registered.
+	// Takes about 10 ms the first time, to calibrate the timestamp counter against the clock.
+	void EnableUtilityStats();
+	bool IsUtilityStatsEnabled();
+
+	// The calls counted so far, by all threads (including the ones that have exited). Safe to call from any thread;
+	// the calls still running on other threads may or may not be in it.
+	UtilityStatsSnapshot GetUtilityStats();
+
+	namespace UtilityCounting
+	{
+		// What a thread has counted for a single utility. Only the thread writes to it, so it's never contended.
+		struct alignas(64) Slot
+		{
+			std::atomic<uint64_t> calls{ 0 };
+			std::atomic<uint64_t> sampledTicks{ 0 };
+			std::array<std::atomic<uint64_t>, UTILITY_LATENCY_BUCKETS> buckets{};
+
+			// Plain loads and stores rather than read-modify-writes (which would lock the bus), since nothing else writes here.
+			/// @return Whether the call should be timed.
+			bool CountCall()
+			{
+				uint64_t count = calls.load(std::memory_order_relaxed);
+				calls.store(count + 1, std::memory_order_relaxed);
+				return count % LATENCY_SAMPLE_INTERVAL == 0;
+			}
+
+			void RecordLatency(uint64_t ticks)
+			{
+				size_t bucket = std::min<size_t>(std::bit_width(ticks), UTILITY_LATENCY_BUCKETS - 1);
+
+				sampledTicks.store(sampledTicks.load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+				buckets[bucket].store(buckets[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			}
+		};
+
+		constexpr uint32_t NOT_COUNTED = UINT32_MAX;
+
+		// The slots of the current thread, indexed by the utility's index. Allocated on the thread's first counted call.
+		inline thread_local Slot** t_slots = nullptr;
+
+		// Assign (or find) the index of a utility, or NOT_COUNTED if there's no room for more.
+		uint32_t AddUtility(const char* utilityName);
+
+		// Allocate the current thread's slot of the utility.
+		Slot* CreateSlot(uint32_t index);
+
+		inline uint64_t ReadTicks()
+		{
+		#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+			return __rdtsc();
+		#elif defined(__aarch64__)
+			uint64_t ticks;
+			asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+			return ticks;
+		#else
+			return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+		#endif
+		}
+
+		class CountedCall
+		{
+		private:
+			Slot* slot;
+			uint64_t start = 0;
+			uint32_t traceNameId;
+			bool isTimed;
+			bool isTraced;
+
+		public:
+			CountedCall(uint32_t index, uint32_t traceNameId) : traceNameId(traceNameId), isTraced(NetHost::IsTracing())
+			{
+				Slot** slots = t_slots;
+				slot = slots != nullptr && slots[index] != nullptr ? slots[index] : CreateSlot(index);
+
+				if (isTraced)
+					NetHost::TraceBegin(traceNameId);
+
+				isTimed = slot->CountCall();
+				if (isTimed)
+					start = ReadTicks();
+			}
+
+			~CountedCall()
+			{
+				if (isTimed)
+					slot->RecordLatency(ReadTicks() - start);
+
+				if (isTraced)
+					NetHost::TraceEnd(traceNameId);
+			}
+
+			CountedCall(const CountedCall&) = delete;
+			CountedCall& operator=(const CountedCall&) = delete;
+		};
+
+		// The trampoline registered in place of a typed utility. There's one per name, so it knows its callback and index
+		// without taking any context.
+		template<typename Signature>
+		struct Trampoline;
+
+		template<typename R, typename... Args>
+		struct Trampoline<R(Args...)>
+		{
+			typedef R (DELEGATE_CALLTYPE *Pointer)(Args...);
+
+			template<auto Name>
+			struct For
+			{
+				static inline std::atomic<Pointer> callback{ nullptr };
+				static inline std::atomic<uint32_t> index{ NOT_COUNTED };
+				static inline std::atomic<uint32_t> traceNameId{ 0 };
+
+				static R DELEGATE_CALLTYPE Call(Args... args)
+				{
+					CountedCall call{ index.load(std::memory_order_relaxed), traceNameId.load(std::memory_order_relaxed) };
+					return callback.load(std::memory_order_relaxed)(args...);
+				}
+			};
+		};
+
+		// What to register for a typed utility: the counting trampoline, or the callback itself if it can't be counted.
+		template<auto Name, typename Signature>
+		void* Wrap(typename Trampoline<Signature>::Pointer callback)
+		{
+			using Counted = typename Trampoline<Signature>::template For<Name>;
+
+			uint32_t index = AddUtility(Name.value);
+			if (index == NOT_COUNTED)
+				return (void*)callback;
+
+			Counted::callback.store(callback, std::memory_order_relaxed);
+			Counted::index.store(index, std::memory_order_relaxed);
+			Counted::traceNameId.store(NetHost::InternTraceName(Name.value), std::memory_order_relaxed);
+			return (void*)&Counted::Call;
+		}
+	}
+
+	namespace Builtins
+	{
+		// Writes up to `capacity` entries of the managed HostComm.UtilityStatsEntry layout (see HostComm.cs).
+		/// @return The number of counted utilities, which may be more than `capacity`.
+		int32_t DELEGATE_CALLTYPE GetUtilityStats(void* entries, int32_t capacity, uint64_t* bucketUpperNs);
+	}
+}
@@ -0,0 +1,104 @@
+#include "host_warmup.h"
+#include "host_comm.h"
+#include "startup_profile.h"
+
+#include <chrono>
+#include <thread>
+#include <fstream>
+
+// Mirrors the entries ManagedApp.HostWarmup.Run reads.
+struct ManagedWarmupEntry
+{
+	const char_t* assemblyPath;
+	const char_t* typeName;
+	const char_t* methodName;
+};
+
+// The fields are converted through paths, which know the encoding of char_t on each platform.
+static std::string ToUtf8(const std::basic_string<char_t>& text)
+{
+	std::u8string utf8 = std::filesystem::path(text).u8string();
+	return std::string(utf8.begin(), utf8.end());
+}
+
+static std::basic_string<char_t> FromUtf8(const std::string& text)
+{
+	return std::filesystem::path(std::u8string(text.begin(), text.end())).native();
+}
+
+namespace HostComm
+{
+	WarmupManifest WarmupManifest::FromResolutionLog(const NetHost::HostContext& hostContext)
+	{
+		WarmupManifest manifest;
+
+		for (NetHost::ResolvedMethod& method : hostContext.GetResolutionLog())
+			manifest.entries.push_back({ std::move(method.assemblyPath), std::move(method.typeName), std::move(method.methodName) });
+
+		return manifest;
+	}
+
+	std::optional<WarmupManifest> WarmupManifest::Load(const std::filesystem::path& filePath)
+	{
+		std::ifstream input{ filePath, std::ios::binary };
+		if (!input)
+			return std::nullopt;
+
+		WarmupManifest manifest;
+		for (std::string line; std::getline(input, line);)
+		{
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+
+			size_t typeStart = line.find('\t');
+			size_t methodStart = typeStart != std::string::npos ? line.find('\t', typeStart + 1) : std::string::npos;
+			if (methodStart == std::string::npos)
+				continue;
+
+			manifest.entries.push_back({
+				FromUtf8(line.substr(0, typeStart)),
+				FromUtf8(line.substr(typeStart + 1, methodStart - typeStart - 1)),
+				FromUtf8(line.substr(methodStart + 1))
+			});
+		}
+
+		return manifest;
+	}
+
+	bool WarmupManifest::Save(const std::filesystem::path& filePath) const
+	{
+		std::ofstream output{ filePath, std::ios::binary | std::ios::trunc };
+		for (const Entry& entry : entries)
+			output << ToUtf8(entry.assemblyPath) << '\t' << ToUtf8(entry.typeName) << '\t' << ToUtf8(entry.methodName) << '\n';
+
+		return output.good();
+	}
+
+	std::shared_future<WarmupReport> Warmup(const WarmupManifest& manifest, int32_t maxParallelism)
+	{
+		auto run = GetHostMethod<void(const ManagedWarmupEntry*, int32_t, int32_t, WarmupReport*)>(NH_STR("ManagedApp.HostWarmup"), NH_STR("Run"));
+
+		std::promise<WarmupReport> promise;
+		std::shared_future<WarmupReport> result = promise.get_future().share();
+
+		std::thread{ [run, manifest, maxParallelism, promise = std::move(promise)]() mutable
+		{
+			NetHost::StartupSpan span{ NetHost::StartupPhases::WARMUP };
+			auto start = std::chrono::steady_clock::now();
+
+			std::vector<ManagedWarmupEntry> entries;
+			entries.reserve(manifest.entries.size());
+
+			for (const WarmupManifest::Entry& entry : manifest.entries)
+				entries.push_back({ entry.assemblyPath.c_str(), entry.typeName.c_str(), entry.methodName.c_str() });
+
+			WarmupReport report;
+			run(entries.data(), (int32_t)entries.size(), maxParallelism, &report);
+
+			report.durationNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+			promise.set_value(report);
+		} }.detach();
+
+		return result;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <future>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+
+#include "net_hosting.h"
+
+// Warming the managed code up before it's first called. A warm-up runs the static constructors of the listed types and
+// JIT-compiles the listed methods (RuntimeHelpers.PrepareMethod) on background threads (ManagedApp.HostWarmup), while the
+// native side goes on initializing, so the first calls into them don't stall on the JIT.
+//
+// The manifest of what to warm up is either written by hand, or captured from the methods a host context has resolved
+// in a previous run (HostContext::GetResolutionLog()) and saved next to the app.
+
+namespace HostComm
+{
+	struct WarmupManifest
+	{
+		struct Entry
+		{
+			std::basic_string<char_t> assemblyPath; // Where the type is loaded from by load_assembly_and_get_function_pointer, or empty for the default load context.
+			std::basic_string<char_t> typeName; // Assembly qualified, like "ManagedApp.Program, ManagedApp".
+			std::basic_string<char_t> methodName; // Every overload with the name is prepared, or every method of the type if empty.
+		};
+
+		std::vector<Entry> entries;
+
+		// What the context has resolved so far, one entry per method.
+		static WarmupManifest FromResolutionLog(const NetHost::HostContext& hostContext);
+
+		// Read a manifest saved by Save(). Returns std::nullopt if the file doesn't exist or can't be read.
+		static std::optional<WarmupManifest> Load(const std::filesystem::path& filePath);
+
+		// Save the manifest as UTF-8 text, an entry per line with its fields separated by tabs.
+		/// @return False if the file couldn't be written.
+		bool Save(const std::filesystem::path& filePath) const;
+	};
+
+	struct WarmupReport
+	{
+		int32_t initializedTypes = 0; // Whose static constructors have run (or had run before).
+		int32_t preparedMethods = 0;
+		int32_t failures = 0; // Entries whose assembly or type isn't found, and methods that have failed to compile.
+		uint64_t durationNs = 0;
+	};
+
+	// Start warming the manifest up on a background thread, which spreads the work over the thread pool. The calls into
+	// the warmed up methods don't have to wait for it, they just JIT whatever isn't compiled yet as usual.
+	// Requires HostComm to be initialized, and the warm-up to complete before the runtime is shut down.
+	/// @param maxParallelism How many threads compile at once, or 0 for the number of processors.
+	/// @return Becomes ready once the warm-up is complete.
+	std::shared_future<WarmupReport> Warmup(const WarmupManifest& manifest, int32_t maxParallelism = 0);
+}
@@ -0,0 +1,147 @@
+#include "host_worker_pool.h"
+#include "host_comm.h"
+
+#include <latch>
+#include <stdexcept>
+#include <exception>
+
+namespace HostComm
+{
+	WorkerPool::WorkerPool(size_t threadCount, ThreadInit threadInit)
+	{
+		std::latch attached{ (std::ptrdiff_t)threadCount };
+		std::mutex errorMutex;
+		std::exception_ptr error;
+
+		threads.reserve(threadCount);
+		try
+		{
+			for (size_t i = 0; i < threadCount; i++)
+			{
+				StartThread(i, threadInit, attached, errorMutex, error);
+			}
+		}
+		catch (...)
+		{
+			// The threads that haven't started never count down, so they're counted down here before waiting for the rest.
+			attached.count_down((std::ptrdiff_t)(threadCount - threads.size()));
+			attached.wait();
+
+			Stop();
+			throw;
+		}
+
+		attached.wait();
+
+		if (error)
+		{
+			Stop();
+			std::rethrow_exception(error);
+		}
+	}
+
+	void WorkerPool::StartThread(size_t index, const ThreadInit& threadInit, std::latch& attached, std::mutex& errorMutex, std::exception_ptr& error)
+	{
+		// Counted before the thread starts, since it decrements the counter when it exits.
+		{
+			std::lock_guard lock{ mutex };
+			runningThreads++;
+		}
+
+		try
+		{
+			threads.emplace_back([this, index, &threadInit, &attached, &errorMutex, &error]()
+			{
+				try
+				{
+					AttachCurrentThread();
+					if (threadInit)
+						threadInit(index);
+				}
+				catch (...)
+				{
+					std::lock_guard lock{ errorMutex };
+					if (!error)
+						error = std::current_exception();
+				}
+
+				// Nothing captured by reference is touched after this, as the constructor may have returned already.
+				attached.count_down();
+				RunTasks();
+			});
+		}
+		catch (...)
+		{
+			std::lock_guard lock{ mutex };
+			runningThreads--;
+			throw;
+		}
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		Stop();
+	}
+
+	void WorkerPool::Post(Task task)
+	{
+		{
+			// While stopping, the tasks are still run as long as a thread is, including the ones posted by the tasks.
+			std::lock_guard lock{ mutex };
+			if (isStopping && runningThreads == 0)
+				throw std::runtime_error{ "The pool has stopped, so the task would never run" };
+
+			tasks.push_back(std::move(task));
+		}
+
+		hasTasks.notify_one();
+	}
+
+	size_t WorkerPool::GetPendingTasks() const
+	{
+		std::lock_guard lock{ mutex };
+		return tasks.size();
+	}
+
+	void WorkerPool::RunTasks()
+	{
+		while (true)
+		{
+			Task task;
+			{
+				std::unique_lock lock{ mutex };
+				hasTasks.wait(lock, [this]() { return isStopping || !tasks.empty(); });
+
+				// The queued tasks are finished before stopping.
+				if (tasks.empty())
+				{
+					runningThreads--;
+					return;
+				}
+
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+
+			task();
+		}
+	}
+
+	void WorkerPool::Stop()
+	{
+		{
+			std::lock_guard lock{ mutex };
+			isStopping = true;
+		}
+
+		hasTasks.notify_all();
+
+		for (std::thread& thread : threads)
+		{
+			if (thread.joinable())
+				thread.join();
+		}
+
+		threads.clear();
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <latch>
+#include <mutex>
+#include <deque>
+#include <memory>
+#include <future>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <type_traits>
+#include <condition_variable>
+
+namespace HostComm
+{
+	// A pool of native threads for calling into the managed side. Every thread is attached to the runtime (see
+	// AttachCurrentThread()) when the pool starts, so no task pays for setting up its thread in the runtime.
+	class WorkerPool
+	{
+	public:
+		typedef std::function<void()> Task;
+
+		// Called on every thread once it's attached, before it takes any task. Useful to warm up the thread further.
+		typedef std::function<void(size_t workerIndex)> ThreadInit;
+
+	private:
+		std::vector<std::thread> threads;
+
+		mutable std::mutex mutex;
+		std::condition_variable hasTasks;
+		std::deque<Task> tasks;
+		bool isStopping = false;
+		size_t runningThreads = 0; // The threads that haven't exited RunTasks() yet.
+
+	public:
+		// Start the threads, and return once all of them are attached to the runtime. Requires HostComm to be initialized.
+		// Throws what attaching a thread (or the init callback) or starting a thread has thrown, having stopped the others.
+		explicit WorkerPool(size_t threadCount, ThreadInit threadInit = {});
+
+		// Run the tasks that are still queued, and stop the threads.
+		~WorkerPool();
+
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+
+		// Queue a task. It must not throw (use Submit() for that). Throws std::runtime_error if the pool has stopped.
+		void Post(Task task);
+
+		// Queue a function, and get its result (or exception) through the future.
+		template<typename Function>
+		std::future<std::invoke_result_t<Function>> Submit(Function&& function)
+		{
+			typedef std::invoke_result_t<Function> Result;
+
+			auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+			std::future<Result> result = task->get_future();
+
+			Post([task]() { (*task)(); });
+			return result;
+		}
+
+		size_t GetThreadCount() const { return threads.size(); }
+		size_t GetPendingTasks() const;
+
+	private:
+		void StartThread(size_t index, const ThreadInit& threadInit, std::latch& attached, std::mutex& errorMutex, std::exception_ptr& error);
+		void RunTasks();
+		void Stop();
+	};
+}
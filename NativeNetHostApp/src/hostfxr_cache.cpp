@@ -0,0 +1,282 @@
+#include "hostfxr_cache.h"
+
+#include <map>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+
+#include <sys/stat.h>
+
+#if _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h>
+#else
+	#include <unistd.h>
+	#include <limits.h>
+#endif
+
+using std::filesystem::path;
+
+namespace
+{
+	constexpr const char* CACHE_FORMAT_VERSION = "1";
+
+	// What tells a file was replaced or modified, without reading it.
+	struct FileStamp
+	{
+		int64_t mtime = 0;
+		uint64_t inode = 0; // Always 0 on Windows, where stat doesn't report it.
+		uint64_t size = 0;
+
+		std::string ToString() const
+		{
+			return std::to_string(mtime) + " " + std::to_string(inode) + " " + std::to_string(size);
+		}
+	};
+
+	std::optional<FileStamp> GetFileStamp(const path& filePath)
+	{
+		std::error_code error;
+		auto mtime = std::filesystem::last_write_time(filePath, error);
+		if (error)
+			return std::nullopt;
+
+		FileStamp stamp;
+		stamp.mtime = (int64_t)mtime.time_since_epoch().count();
+
+#if _WIN32
+		struct _stat64 info;
+		if (_wstat64(filePath.c_str(), &info) != 0)
+			return std::nullopt;
+#else
+		struct stat info;
+		if (stat(filePath.c_str(), &info) != 0)
+			return std::nullopt;
+#endif
+
+		stamp.inode = (uint64_t)info.st_ino;
+		stamp.size = std::filesystem::is_directory(filePath, error) ? 0 : (uint64_t)info.st_size;
+		return stamp;
+	}
+
+	std::string StampOf(const path& filePath)
+	{
+		std::optional<FileStamp> stamp = GetFileStamp(filePath);
+		return stamp.has_value() ? stamp->ToString() : "missing";
+	}
+
+	std::string ToUtf8(const path& filePath)
+	{
+		std::u8string text = filePath.u8string();
+		return std::string(text.begin(), text.end());
+	}
+
+	path FromUtf8(const std::string& text)
+	{
+		return path(std::u8string(text.begin(), text.end()));
+	}
+
+	std::string GetEnvironmentValue(const char* name)
+	{
+		const char* value = std::getenv(name);
+		return value != nullptr ? value : "";
+	}
+
+	// The hostfxr library is at <dotnet root>/host/fxr/<version>/, and a runtime installing a newer version changes the fxr directory.
+	path GetFxrVersionsDirectory(const path& hostFxrPath)
+	{
+		return hostFxrPath.parent_path().parent_path();
+	}
+
+	// The framework reference(s) of a runtime config, like "Microsoft.NETCore.App 8.0.0". Only the "framework" or
+	// "frameworks" value is scanned, taking the string values of its "name" and "version" properties.
+	std::string ReadFrameworkReference(const path& runtimeConfigPath)
+	{
+		std::ifstream input{ runtimeConfigPath, std::ios::binary };
+		std::string json{ std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>() };
+
+		size_t position = json.find("\"framework");
+		if (position == std::string::npos)
+			return "";
+
+		position = json.find(':', position);
+		if (position == std::string::npos)
+			return "";
+
+		std::string reference;
+		std::string lastKey;
+		int depth = 0;
+		bool isValueExpected = false;
+
+		for (size_t i = position + 1; i < json.size(); i++)
+		{
+			char ch = json[i];
+			if (ch == '{' || ch == '[')
+			{
+				depth++;
+			}
+			else if (ch == '}' || ch == ']')
+			{
+				if (--depth <= 0)
+					break;
+			}
+			else if (ch == ':')
+			{
+				isValueExpected = true;
+			}
+			else if (ch == ',')
+			{
+				isValueExpected = false;
+			}
+			else if (ch == '"')
+			{
+				size_t end = json.find('"', i + 1);
+				if (end == std::string::npos)
+					break;
+
+				std::string text = json.substr(i + 1, end - i - 1);
+				if (!isValueExpected)
+				{
+					lastKey = text;
+				}
+				else if (lastKey == "name" || lastKey == "version")
+				{
+					reference += reference.empty() ? text : " " + text;
+				}
+
+				isValueExpected = false;
+				i = end;
+			}
+		}
+
+		return reference;
+	}
+
+	path GetExecutablePath()
+	{
+#ifdef _WIN32
+		wchar_t buffer[MAX_PATH]{};
+		return path(std::wstring(buffer, GetModuleFileNameW(NULL, buffer, MAX_PATH)));
+#else
+		char buffer[PATH_MAX]{};
+		ssize_t chRead = readlink("/proc/self/exe", buffer, PATH_MAX); // readlink does not null terminate!
+		return path(std::string(buffer, chRead > 0 ? chRead : 0));
+#endif
+	}
+
+	std::map<std::string, std::string> ReadCacheFile(const path& cacheFile)
+	{
+		std::map<std::string, std::string> values;
+
+		std::ifstream input{ cacheFile };
+		for (std::string line; std::getline(input, line);)
+		{
+			size_t separator = line.find('=');
+			if (separator != std::string::npos)
+				values[line.substr(0, separator)] = line.substr(separator + 1);
+		}
+
+		return values;
+	}
+}
+
+namespace NetHost::HostFxrCache
+{
+	path GetCacheFilePath(bool nextToExecutable)
+	{
+		path executable = GetExecutablePath();
+		path fileName = executable.stem();
+		fileName += ".hostfxr-cache";
+
+		if (nextToExecutable)
+			return executable.parent_path() / fileName;
+
+#if _WIN32
+		path cacheDir = FromUtf8(GetEnvironmentValue("LOCALAPPDATA"));
+#else
+		path cacheDir = FromUtf8(GetEnvironmentValue("XDG_CACHE_HOME"));
+		if (cacheDir.empty() && !GetEnvironmentValue("HOME").empty())
+			cacheDir = FromUtf8(GetEnvironmentValue("HOME")) / ".cache";
+#endif
+
+		if (cacheDir.empty())
+			return executable.parent_path() / fileName;
+
+		return cacheDir / "NetHosting" / fileName;
+	}
+
+	std::optional<path> Load(const path& cacheFile, const std::optional<path>& runtimeConfigPath)
+	{
+		std::map<std::string, std::string> values = ReadCacheFile(cacheFile);
+		if (values["version"] != CACHE_FORMAT_VERSION || values["hostfxr"].empty())
+			return std::nullopt;
+
+		path hostFxrPath = FromUtf8(values["hostfxr"]);
+		if (values["hostfxr_stamp"] != StampOf(hostFxrPath) || values["fxr_dir_stamp"] != StampOf(GetFxrVersionsDirectory(hostFxrPath)))
+			return std::nullopt;
+
+		if (values["dotnet_root"] != GetEnvironmentValue("DOTNET_ROOT"))
+			return std::nullopt;
+
+		std::string configPath = runtimeConfigPath.has_value() ? ToUtf8(std::filesystem::absolute(*runtimeConfigPath)) : "";
+		if (values["config"] != configPath)
+			return std::nullopt;
+
+		// An edited runtime config is still fine if it references the same framework.
+		if (runtimeConfigPath.has_value() && values["config_stamp"] != StampOf(*runtimeConfigPath))
+		{
+			if (values["framework"] != ReadFrameworkReference(*runtimeConfigPath))
+				return std::nullopt;
+
+			Store(cacheFile, hostFxrPath, runtimeConfigPath);
+		}
+
+		return hostFxrPath;
+	}
+
+	void Store(const path& cacheFile, const path& hostFxrPath, const std::optional<path>& runtimeConfigPath)
+	{
+		std::ostringstream content;
+		content << "version=" << CACHE_FORMAT_VERSION << "\n";
+		content << "hostfxr=" << ToUtf8(hostFxrPath) << "\n";
+		content << "hostfxr_stamp=" << StampOf(hostFxrPath) << "\n";
+		content << "fxr_dir_stamp=" << StampOf(GetFxrVersionsDirectory(hostFxrPath)) << "\n";
+		content << "dotnet_root=" << GetEnvironmentValue("DOTNET_ROOT") << "\n";
+
+		if (runtimeConfigPath.has_value())
+		{
+			content << "config=" << ToUtf8(std::filesystem::absolute(*runtimeConfigPath)) << "\n";
+			content << "config_stamp=" << StampOf(*runtimeConfigPath) << "\n";
+			content << "framework=" << ReadFrameworkReference(*runtimeConfigPath) << "\n";
+		}
+		else
+		{
+			content << "config=\n";
+		}
+
+		std::error_code error;
+		std::filesystem::create_directories(cacheFile.parent_path(), error);
+
+		// Written aside and renamed, so a concurrently starting process never reads a half-written cache.
+		path temporaryFile = cacheFile;
+#if _WIN32
+		temporaryFile += "." + std::to_string(GetCurrentProcessId()) + ".tmp";
+#else
+		temporaryFile += "." + std::to_string(getpid()) + ".tmp";
+#endif
+
+		{
+			std::ofstream output{ temporaryFile, std::ios::trunc };
+			output << content.str();
+			if (!output)
+				return;
+		}
+
+		std::filesystem::rename(temporaryFile, cacheFile, error);
+		if (error)
+			std::filesystem::remove(temporaryFile, error);
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <optional>
+#include <filesystem>
+
+// The on-disk cache of the hostfxr path resolved by nethost (see NetHost::InitOptions). get_hostfxr_path probes
+// environment variables, install locations and version directories every time, which is slow on cold containers and
+// network filesystems, so the resolved path is remembered together with what it depends on:
+// - the hostfxr library itself, and the directory with the installed hostfxr versions (modification time, inode and size);
+// - the runtime config (stamps, and the framework reference it has, so an edit that keeps the reference doesn't count);
+// - the DOTNET_ROOT environment variable.
+// The cached path is only used when all of them still match.
+
+namespace NetHost::HostFxrCache
+{
+	// Where the cache file of this executable goes: next to it, or under the user's cache directory
+	// ($XDG_CACHE_HOME or ~/.cache on Linux, %LOCALAPPDATA% on Windows).
+	std::filesystem::path GetCacheFilePath(bool nextToExecutable);
+
+	// Read the cached hostfxr path, or return nothing if there's no cache, or it doesn't validate anymore.
+	std::optional<std::filesystem::path> Load(const std::filesystem::path& cacheFile, const std::optional<std::filesystem::path>& runtimeConfigPath);
+
+	// Remember the resolved hostfxr path. Failing to write the cache is not an error, it's just not used next time.
+	void Store(const std::filesystem::path& cacheFile, const std::filesystem::path& hostFxrPath, const std::optional<std::filesystem::path>& runtimeConfigPath);
+}
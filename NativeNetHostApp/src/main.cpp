@@ -1,8 +1,15 @@
 ﻿#include "net_hosting.h"
 #include "host_comm.h"
+#include "host_warmup.h"
+#include "native_utility.h"
+#include "host_utility_stats.h"
+#include "host_trace.h"
+#include "host_memory.h"
+#include "startup_profile.h"
 
 #include <iostream>
 #include <filesystem>
+#include <cstdlib>
 
 #if _WIN32
 #define WIN32_LEAN_AND_MEAN
@@ -20,8 +27,6 @@ static path GetExecutablePath();
 static void ERRWRITER_CALLTYPE DebugDNetError(const char_t* message);
 static void DELEGATE_CALLTYPE DoTestUtility();
 
-typedef void (DELEGATE_CALLTYPE* VoidNoArgPointer)();
-
 int main()
 {
     //SetEnvironmentVariable(L"COREHOST_TRACE", L"1");
@@ -32,27 +37,128 @@ int main()
     path pathToRuntimeConfig = executableDir / L"ManagedApp.runtimeconfig.json";
     path assemblyPath = executableDir / L"ManagedApp.dll";
 
-    if (!NetHost::Init())
+    NetHost::InitOptions initOptions;
+    initOptions.hostFxrCache = NetHost::HostFxrCacheLocation::NextToExecutable;
+    initOptions.runtimeConfigPath = pathToRuntimeConfig;
+
+    // The NativeAOT build of ManagedApp (NETHOST_BUILD_NATIVEAOT in CMake) replaces hostfxr and CoreCLR entirely.
+    if (std::getenv("NETHOST_NATIVEAOT") != nullptr)
+    {
+        initOptions.backend = NetHost::HostBackend::NativeAot;
+#ifdef _WIN32
+        initOptions.nativeAotLibrary = executableDir / L"nativeaot" / L"ManagedApp.dll";
+#else
+        initOptions.nativeAotLibrary = executableDir / "nativeaot" / "ManagedApp.so";
+#endif
+    }
+
+    // Count the calls into the native utilities (Program.Main prints them). Must come before any utility is registered.
+    // A trace needs it too, since the utility calls are traced by the same trampolines.
+    const char* tracePath = std::getenv("NETHOST_TRACE");
+    if (std::getenv("NETHOST_UTILITY_STATS") != nullptr || tracePath != nullptr)
+    {
+        HostComm::EnableUtilityStats();
+    }
+
+    if (tracePath != nullptr)
+    {
+        NetHost::StartTrace();
+    }
+
+    // hostfxr is found and loaded, the runtime started and ManagedApp loaded in the background, while the native side goes
+    // on with its own initialization.
+    std::shared_future<bool> init = NetHost::InitAsync(initOptions);
+    std::future<NetHost::HostContext> hostReady = HostComm::InitAsync(NetHost::NewContextForRuntimeConfigAsync(init, pathToRuntimeConfig),
+        assemblyPath.native(), NH_STR("ManagedApp"), true);
+
+    path warmupManifestPath = executableDir / L"NativeNetHostApp.warmup";
+    std::optional<HostComm::WarmupManifest> warmupManifest;
+
+    {
+        NetHost::StartupSpan span{ "native initialization" };
+
+        // Delivered to the managed side whether HostComm::Init has run by now or not, so the typed bindings are bound before Main.
+        HostComm::RegisterNativeUtility<"test_utility", void()>(&DoTestUtility);
+        HostComm::FreezeNativeUtilities();
+
+        // What the previous run has resolved, or the whole of Program on the first run.
+        warmupManifest = HostComm::WarmupManifest::Load(warmupManifestPath);
+        if (!warmupManifest.has_value())
+        {
+            warmupManifest.emplace();
+            warmupManifest->entries.push_back({ assemblyPath.native(), NH_STR("ManagedApp.Program, ManagedApp"), {} });
+        }
+    }
+
+    if (!init.get())
     {
         std::cout << "Failed to initialize .NET host.\n";
         return -1;
     }
 
-    NetHost::HostContext context = NetHost::NewContextForRuntimeConfig(pathToRuntimeConfig.c_str());
     NetHost::SetErrorWriter(DebugDNetError);
+    NetHost::HostContext context = hostReady.get();
     std::cout << "The .NET hosting environment has been initialized.\n";
 
     std::cout << "Switching to the .NET world...\n";
 
-    HostComm::Init(context, assemblyPath.c_str(), NH_STR("ManagedApp"));
-    HostComm::RegisterNativeUtility("test_utility", (void*)&DoTestUtility);
+    std::shared_future<HostComm::WarmupReport> warmup = HostComm::Warmup(*warmupManifest);
 
     auto loadAndGetDelegate = context.GetLoadAssemblyAndGetFuncPointer();
 
-    void* callback;
-    callback = loadAndGetDelegate(assemblyPath.native().c_str(), NH_STR("ManagedApp.Program, ManagedApp"), NH_STR("Main"), NH_STR("System.Action, netstandard"));
+    auto managedMain = NetHost::GetTracedFunction<void()>(loadAndGetDelegate, assemblyPath.native().c_str(), NH_STR("ManagedApp.Program, ManagedApp"), NH_STR("Main"), NH_STR("System.Action, netstandard"));
+
+    HostComm::WarmupReport warmupReport = warmup.get();
+    std::cout << "Warmed up " << warmupReport.preparedMethods << " methods and " << warmupReport.initializedTypes << " types in "
+        << warmupReport.durationNs / 1000 << " us (" << warmupReport.failures << " failures).\n";
+
+    // Watch the managed memory, and collect once the heap gets over the budget (in KiB, since this demo's heap stays well
+    // under a MiB). The heap is measured at every publication, unlike the committed memory, which is only known as of the
+    // last GC (and reads 0 until the first one).
+    const char* memoryBudget = std::getenv("NETHOST_MEMORY_BUDGET_KB");
+    if (memoryBudget != nullptr)
+    {
+        HostComm::AddMemoryThreshold(HostComm::MemoryMetric::CURRENT_HEAP, std::strtoull(memoryBudget, nullptr, 10) * 1024,
+            [](const HostComm::ManagedMemoryStats& stats, HostComm::MemoryMetric, uint64_t budgetBytes)
+        {
+            std::cout << "The managed heap has " << stats.currentHeapBytes / 1024 << " KiB allocated (over " << budgetBytes / 1024 << " KiB), collecting.\n";
+            HostComm::CollectManagedMemory();
+        });
+
+        HostComm::StartMemoryTelemetry();
+    }
+
+    {
+        // The first call of the app itself, which includes JIT-compiling it (unless precompiled, see NETHOST_MANAGED_PRECOMPILE).
+        NetHost::StartupSpan span{ "ManagedApp.Program.Main" };
+        managedMain();
+    }
+
+    // Where the startup phases went, viewable in chrome://tracing or Perfetto.
+    if (const char* startupTracePath = std::getenv("NETHOST_STARTUP_TRACE"))
+    {
+        NetHost::WriteStartupTrace(startupTracePath);
+    }
+
+    // The same, with the calls across the boundary since.
+    if (tracePath != nullptr)
+    {
+        NetHost::StopTrace();
+        NetHost::WriteTrace(tracePath);
+    }
+
+    if (memoryBudget != nullptr)
+    {
+        HostComm::StopMemoryTelemetry();
+
+        HostComm::ManagedMemoryStats memory = HostComm::UpdateManagedMemoryStats();
+        std::cout << "Managed memory: " << memory.currentHeapBytes / 1024 << " KiB allocated, " << memory.heapSizeBytes / 1024 << " KiB heap as of the last GC ("
+            << memory.fragmentedBytes / 1024 << " KiB fragmented), "
+            << memory.committedBytes / 1024 << " KiB committed, " << memory.GetPinnedObjectHeapBytes() / 1024 << " KiB pinned object heap, "
+            << memory.collections[0] << "/" << memory.collections[1] << "/" << memory.collections[2] << " collections.\n";
+    }
 
-    ((VoidNoArgPointer)callback)();
+    HostComm::WarmupManifest::FromResolutionLog(context).Save(warmupManifestPath);
 
     context.Close();
     NetHost::Shutdown();
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <string_view>
+#include <type_traits>
+
+#include "host_comm.h"
+#include "host_utility_stats.h"
+
+// Typed native utilities. Registering a utility with its signature (instead of a plain void*) lets the build generate
+// C# bindings for it: static `delegate* unmanaged<...>` function pointers that the managed side calls directly, without
+// creating delegates or looking anything up by name (see native_utility_list.h and tools/native_utility_bindgen.cpp).
+
+namespace HostComm
+{
+	// A string literal usable as a template argument, like RegisterNativeUtility<"test_utility", void()>(...).
+	template<size_t N>
+	struct UtilityName
+	{
+		char value[N]{};
+
+		constexpr UtilityName(const char (&name)[N])
+		{
+			std::copy_n(name, N, value);
+		}
+
+		constexpr std::string_view View() const { return { value, N - 1 }; }
+	};
+
+	// A stable numeric ID of a native utility name (32-bit FNV-1a). Both sides compute it from the name only, so it can be
+	// baked into the generated bindings.
+	constexpr uint32_t GetUtilityId(std::string_view utilityName)
+	{
+		uint32_t hash = 2166136261u;
+		for (char ch : utilityName)
+		{
+			hash ^= (unsigned char)ch;
+			hash *= 16777619u;
+		}
+
+		return hash;
+	}
+
+	template<UtilityName Name>
+	inline constexpr uint32_t UtilityId = GetUtilityId(Name.View());
+
+	// Only the types that can be passed across the boundary as they are (no marshalling) are allowed in typed utilities.
+	template<typename T>
+	inline constexpr bool IsBlittableUtilityType = std::is_pointer_v<T> ||
+		(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>) ||
+		(std::is_class_v<T> && std::is_trivially_copyable_v<T> && std::is_standard_layout_v<T>);
+
+	template<typename Signature>
+	struct NativeUtilitySignature;
+
+	template<typename R, typename... Args>
+	struct NativeUtilitySignature<R(Args...)>
+	{
+		typedef R (DELEGATE_CALLTYPE *Pointer)(Args...);
+
+		static constexpr bool IsBlittable = (std::is_void_v<R> || IsBlittableUtilityType<R>) && (IsBlittableUtilityType<Args> && ...);
+	};
+
+	// Register a native utility with its signature. It's the same as the untyped registration (returning false the same way),
+	// but checks the callback against the signature at compile time, and counts its calls if EnableUtilityStats() has been called.
+	template<UtilityName Name, typename Signature>
+	bool RegisterNativeUtility(typename NativeUtilitySignature<Signature>::Pointer callback)
+	{
+		static_assert(Name.View().size() > 0, "The utility name is empty");
+		static_assert(NativeUtilitySignature<Signature>::IsBlittable, "Typed native utilities can only take and return blittable types");
+
+		if (IsUtilityStatsEnabled())
+			return RegisterNativeUtility(Name.value, UtilityCounting::Wrap<Name, Signature>(callback));
+
+		return RegisterNativeUtility(Name.value, (void*)callback);
+	}
+
+	template<UtilityName Name>
+	void UnregisterNativeUtility()
+	{
+		UnregisterNativeUtility(Name.value);
+	}
+}
@@ -0,0 +1,34 @@
+// The typed native utilities the managed bindings (ManagedApp/Generated/NativeUtilities.g.cs) are generated from.
+// Each entry is NATIVE_UTILITY(name, signature), and the native side should register it with the same signature:
+// HostComm::RegisterNativeUtility<"name", signature>(callback). The ones prefixed with `hostcomm_` are registered by
+// HostComm itself. The macro should be variadic, since the signature may contain commas.
+// No include guard: the list is meant to be included multiple times with different NATIVE_UTILITY definitions.
+
+NATIVE_UTILITY(test_utility, void())
+
+// Channels (host_channel.h).
+NATIVE_UTILITY(hostcomm_open_channel, void*(const char*))
+NATIVE_UTILITY(hostcomm_wait_channel, int32_t(void*, int32_t))
+NATIVE_UTILITY(hostcomm_notify_channel, void(void*))
+
+// Async calls (host_async.h).
+NATIVE_UTILITY(hostcomm_complete_async, void(uint64_t, int32_t, const void*, int32_t))
+
+// Memory-mapped files (host_mapped_file.h).
+NATIVE_UTILITY(hostcomm_map_window, const void*(void*, int64_t))
+NATIVE_UTILITY(hostcomm_release_window, void(void*, int64_t))
+
+// Buffer pools (host_buffer_pool.h).
+NATIVE_UTILITY(hostcomm_lend_buffer, void(void*, int32_t, void*, int32_t))
+NATIVE_UTILITY(hostcomm_return_buffer, void(void*, int32_t, uint32_t))
+
+// Memory telemetry (host_memory.h).
+NATIVE_UTILITY(hostcomm_memory_stats_published, void())
+
+// Utility stats (host_utility_stats.h).
+NATIVE_UTILITY(hostcomm_get_utility_stats, int32_t(void*, int32_t, uint64_t*))
+
+// Tracing (host_trace.h).
+NATIVE_UTILITY(hostcomm_trace_name, uint32_t(const char*))
+NATIVE_UTILITY(hostcomm_trace_begin, void(uint32_t))
+NATIVE_UTILITY(hostcomm_trace_end, void(uint32_t))
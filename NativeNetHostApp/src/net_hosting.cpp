@@ -1,9 +1,17 @@
 #include "net_hosting.h"
+#include "startup_profile.h"
+#include "hostfxr_cache.h"
 
 #include <cassert>
 #include <utility>
 #include <stdexcept>
 #include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <unordered_map>
+#include <iterator>
+#include <cstdlib>
 
 #include <nethost.h>
 #include <hostfxr.h>
@@ -42,6 +50,9 @@ namespace NetHost
 		hostfxr_initialize_for_dotnet_command_line_fn initialize_for_dotnet_command_line;
 		hostfxr_initialize_for_runtime_config_fn initialize_for_runtime_config;
 		hostfxr_get_runtime_delegate_fn get_runtime_delegate;
+		hostfxr_get_runtime_property_value_fn get_runtime_property_value;
+		hostfxr_set_runtime_property_value_fn set_runtime_property_value;
+		hostfxr_get_runtime_properties_fn get_runtime_properties;
 		hostfxr_run_app_fn run_app;
 		hostfxr_close_fn close;
 	};
@@ -52,15 +63,356 @@ namespace NetHost
 		HostFxrFuncs funcs;
 	};
 
-	static bool i_isHostFxrLoaded = false;
+	// Looked up far more often than stored to, from any number of threads at once, so lookups only share the lock.
+	class ResolutionCache
+	{
+	private:
+		std::shared_mutex mutex;
+		std::unordered_map<std::basic_string<char_t>, void*> entries;
+		std::vector<ResolvedMethod> log; // Every method resolved in the context, in order. Survives Clear().
+
+	public:
+		void* Find(const std::basic_string<char_t>& key)
+		{
+			std::shared_lock lock{ mutex };
+
+			auto it = entries.find(key);
+			return it != entries.end() ? it->second : nullptr;
+		}
+
+		void Store(const std::basic_string<char_t>& key, void* function)
+		{
+			std::lock_guard lock{ mutex };
+			if (!entries.try_emplace(key, function).second)
+				return;
+
+			// The key is `assembly path \0 type \0 method \0 delegate type` (see MakeResolutionKey()).
+			size_t typeStart = key.find(NH_STR('\0')) + 1;
+			size_t methodStart = key.find(NH_STR('\0'), typeStart) + 1;
+			size_t methodEnd = key.find(NH_STR('\0'), methodStart);
+
+			log.push_back({ key.substr(0, typeStart - 1), key.substr(typeStart, methodStart - typeStart - 1), key.substr(methodStart, methodEnd - methodStart) });
+		}
+
+		std::vector<ResolvedMethod> GetLog()
+		{
+			std::shared_lock lock{ mutex };
+			return log;
+		}
+
+		void Clear()
+		{
+			std::lock_guard lock{ mutex };
+			entries.clear();
+		}
+	};
+
+	// Build a key identifying a managed method within a context. The parts are separated with '\0' as it can't be a part of
+	// any name, and the delegate type name is prefixed with a tag since it can be null, or a special UNMANAGED_CALLERS_ONLY value.
+	static std::basic_string<char_t> MakeResolutionKey(const char_t* assemblyPath, const char_t* typeName, const char_t* methodName, const char_t* delegateTypeName)
+	{
+		std::basic_string<char_t> key;
+		if (assemblyPath != nullptr)
+			key += assemblyPath;
+
+		key += NH_STR('\0');
+		key += typeName;
+		key += NH_STR('\0');
+		key += methodName;
+		key += NH_STR('\0');
+
+		if (delegateTypeName == nullptr)
+		{
+			key += NH_STR('D');
+		}
+		else if (delegateTypeName == UNMANAGED_CALLERS_ONLY)
+		{
+			key += NH_STR('U');
+		}
+		else
+		{
+			key += NH_STR('T');
+			key += delegateTypeName;
+		}
+
+		return key;
+	}
+
+	namespace TuningProperties
+	{
+		const char_t* const SERVER_GC = NH_STR("System.GC.Server");
+		const char_t* const CONCURRENT_GC = NH_STR("System.GC.Concurrent");
+		const char_t* const GC_HEAP_HARD_LIMIT = NH_STR("System.GC.HeapHardLimit");
+		const char_t* const GC_HEAP_COUNT = NH_STR("System.GC.HeapCount");
+		const char_t* const GC_HEAP_AFFINITIZE_MASK = NH_STR("System.GC.HeapAffinitizeMask");
+		const char_t* const TIERED_COMPILATION = NH_STR("System.Runtime.TieredCompilation");
+		const char_t* const TIERED_PGO = NH_STR("System.Runtime.TieredPGO");
+		const char_t* const QUICK_JIT_FOR_LOOPS = NH_STR("System.Runtime.TieredCompilation.QuickJitForLoops");
+	}
+
+	const char_t* const READY_TO_RUN_VARIABLE = NH_STR("DOTNET_ReadyToRun");
+
+	static std::basic_string<char_t> ToPropertyValue(bool value)
+	{
+		return value ? NH_STR("true") : NH_STR("false");
+	}
+
+	// The GC reads numeric settings with base auto-detection, so the hex form is fine for both limits and masks.
+	static std::basic_string<char_t> ToPropertyValue(uint64_t value)
+	{
+		char_t buffer[24];
+		char_t* end = buffer + std::size(buffer);
+		char_t* start = end;
+
+		do
+		{
+			*--start = NH_STR("0123456789abcdef")[value & 0xF];
+			value >>= 4;
+		} while (value != 0);
+
+		return std::basic_string<char_t>(NH_STR("0x")) + std::basic_string<char_t>(start, end);
+	}
+
+	static std::optional<bool> ParseTuningBool(const std::optional<std::basic_string<char_t>>& value)
+	{
+		if (!value.has_value())
+			return std::nullopt;
+
+		const std::basic_string<char_t>& text = *value;
+		if (text == NH_STR("true") || text == NH_STR("True") || text == NH_STR("1"))
+			return true;
+		if (text == NH_STR("false") || text == NH_STR("False") || text == NH_STR("0"))
+			return false;
+
+		return std::nullopt;
+	}
+
+	static std::optional<uint64_t> ParseTuningNumber(const std::optional<std::basic_string<char_t>>& value)
+	{
+		if (!value.has_value() || value->empty())
+			return std::nullopt;
+
+		try
+		{
+			size_t parsed = 0;
+			uint64_t number = std::stoull(*value, &parsed, 0);
+			return parsed == value->size() ? std::optional<uint64_t>(number) : std::nullopt;
+		}
+		catch (const std::exception&)
+		{
+			return std::nullopt;
+		}
+	}
+
+	static std::optional<std::basic_string<char_t>> GetEnvironmentValue(const char_t* name)
+	{
+#if _WIN32
+		char_t buffer[64];
+		DWORD length = GetEnvironmentVariable(name, buffer, (DWORD)std::size(buffer));
+		if (length == 0 || length >= std::size(buffer))
+			return std::nullopt;
+
+		return std::basic_string<char_t>(buffer, length);
+#else
+		const char* value = getenv(name);
+		return value != nullptr ? std::optional<std::basic_string<char_t>>(value) : std::nullopt;
+#endif
+	}
+
+	static void SetEnvironmentValue(const char_t* name, const char_t* value)
+	{
+#if _WIN32
+		SetEnvironmentVariable(name, value);
+#else
+		setenv(name, value, 1);
+#endif
+	}
+
+	// ReadyToRun is set in the environment of the process, which the runtime reads when it's loaded. So it's only applied
+	// until then, and on the thread creating the context (other threads may be reading the environment meanwhile).
+	static std::mutex i_readyToRunMutex;
+	static bool i_isRuntimeLoaded = false;
+	static std::optional<bool> i_readyToRun; // Applied by a tuning, or what the runtime has been loaded with.
+
+	/// Throws std::runtime_error if the runtime is loaded already.
+	static void ApplyReadyToRun(std::optional<bool> readyToRun)
+	{
+		if (!readyToRun.has_value())
+			return;
+
+		std::lock_guard lock{ i_readyToRunMutex };
+		if (i_isRuntimeLoaded)
+			throw std::runtime_error("Failed to apply ReadyToRun, the runtime is loaded already");
+
+		SetEnvironmentValue(READY_TO_RUN_VARIABLE, *readyToRun ? NH_STR("1") : NH_STR("0"));
+		i_readyToRun = readyToRun;
+	}
+
+	// Called once the runtime is about to be loaded (by the first runtime delegate, or by running the app).
+	static void OnRuntimeLoaded()
+	{
+		std::lock_guard lock{ i_readyToRunMutex };
+		if (i_isRuntimeLoaded)
+			return;
+
+		// Unless a tuning has set it, the runtime goes by the environment the process has been started with.
+		i_isRuntimeLoaded = true;
+		if (!i_readyToRun.has_value())
+			i_readyToRun = ParseTuningBool(GetEnvironmentValue(READY_TO_RUN_VARIABLE));
+	}
+
+	// Fill the settings that are passed as runtime properties from the values `getProperty` returns.
+	template<typename PropertyGetter>
+	static void ReadRuntimeTuning(RuntimeTuning& tuning, PropertyGetter&& getProperty)
+	{
+		using namespace TuningProperties;
+
+		tuning.serverGC = ParseTuningBool(getProperty(SERVER_GC));
+		tuning.concurrentGC = ParseTuningBool(getProperty(CONCURRENT_GC));
+		tuning.gcHeapHardLimit = ParseTuningNumber(getProperty(GC_HEAP_HARD_LIMIT));
+		tuning.gcHeapAffinitizeMask = ParseTuningNumber(getProperty(GC_HEAP_AFFINITIZE_MASK));
+		tuning.tieredCompilation = ParseTuningBool(getProperty(TIERED_COMPILATION));
+		tuning.tieredPGO = ParseTuningBool(getProperty(TIERED_PGO));
+		tuning.quickJitForLoops = ParseTuningBool(getProperty(QUICK_JIT_FOR_LOOPS));
+
+		if (auto heapCount = ParseTuningNumber(getProperty(GC_HEAP_COUNT)))
+			tuning.gcHeapCount = (uint32_t)*heapCount;
+	}
+
+	// With the NativeAot backend, the functions emulate hostfxr on top of the loaded library (see NativeAot below),
+	// so everything else works the same way for both backends.
+	// Init() and Shutdown() are serialized by the mutex. The backend state is only written before the flag is set (and
+	// after it's cleared), so any thread that sees the flag set can use the state without locking.
+	static std::mutex i_initMutex;
+	static std::atomic<bool> i_isBackendLoaded{ false };
+	static HostBackend i_backend = HostBackend::HostFxr;
 	static LoadedHostFxr i_loadedFxr{};
 
-	// Find and load the hostfxr by using nethost, or load it directly if the path is specified.
-	static sharedlib_t LoadHostFxr(std::optional<std::filesystem::path> pathToRuntime);
+	// Only the first call that actually goes into the runtime is a startup phase, the later ones are much cheaper.
+	static std::atomic<bool> i_isFirstLoadAssemblyRecorded{ false };
+
+	namespace NativeAot
+	{
+		// "ManagedApp.HostComm, ManagedApp" + "Init" -> "ManagedApp_HostComm_Init". Type and method names are plain
+		// identifiers, so they are narrowed to the ASCII the export names are looked up with.
+		static std::string GetExportName(const char_t* typeName, const char_t* methodName)
+		{
+			std::string name;
+			for (const char_t* ch = typeName; *ch != NH_STR('\0') && *ch != NH_STR(','); ch++)
+				name += (*ch == NH_STR('.') || *ch == NH_STR('+')) ? '_' : (char)*ch;
+
+			name += '_';
+			for (const char_t* ch = methodName; *ch != NH_STR('\0'); ch++)
+				name += (char)*ch;
+
+			return name;
+		}
+
+		static int CORECLR_DELEGATE_CALLTYPE GetFunctionPointer(const char_t* typeName, const char_t* methodName, [[maybe_unused]] const char_t* delegateTypeName,
+			[[maybe_unused]] void* loadContext, [[maybe_unused]] void* reserved, void** outDelegate)
+		{
+			*outDelegate = (void*)SHAREDLIB_SYM(i_loadedFxr.module, GetExportName(typeName, methodName).c_str());
+			return *outDelegate != nullptr ? StatusCode::Success : StatusCode::CoreHostEntryPointFailure;
+		}
+
+		// Everything is compiled into the library already, so there's no assembly to load.
+		static int CORECLR_DELEGATE_CALLTYPE LoadAssemblyAndGetFunctionPointer([[maybe_unused]] const char_t* assemblyPath, const char_t* typeName, const char_t* methodName,
+			const char_t* delegateTypeName, void* reserved, void** outDelegate)
+		{
+			return GetFunctionPointer(typeName, methodName, delegateTypeName, nullptr, reserved, outDelegate);
+		}
+
+		static hostfxr_error_writer_fn HOSTFXR_CALLTYPE SetErrorWriter([[maybe_unused]] hostfxr_error_writer_fn errorWriter)
+		{
+			return nullptr;
+		}
+
+		static int32_t HOSTFXR_CALLTYPE InitializeForCommandLine([[maybe_unused]] int argc, [[maybe_unused]] const char_t** argv, [[maybe_unused]] const hostfxr_initialize_parameters* parameters, hostfxr_handle* outHandle)
+		{
+			*outHandle = nullptr;
+			return StatusCode::HostApiUnsupportedScenario;
+		}
+
+		// The runtime is a part of the library, so any number of contexts just refer to it.
+		static int32_t HOSTFXR_CALLTYPE InitializeForRuntimeConfig([[maybe_unused]] const char_t* configPath, [[maybe_unused]] const hostfxr_initialize_parameters* parameters, hostfxr_handle* outHandle)
+		{
+			*outHandle = (hostfxr_handle)i_loadedFxr.module;
+			return StatusCode::Success;
+		}
+
+		static int32_t HOSTFXR_CALLTYPE GetRuntimeDelegate([[maybe_unused]] const hostfxr_handle handle, hostfxr_delegate_type type, void** outDelegate)
+		{
+			switch (type)
+			{
+			case hdt_load_assembly_and_get_function_pointer:
+				*outDelegate = (void*)&LoadAssemblyAndGetFunctionPointer;
+				return StatusCode::Success;
+			case hdt_get_function_pointer:
+				*outDelegate = (void*)&GetFunctionPointer;
+				return StatusCode::Success;
+			default:
+				*outDelegate = nullptr;
+				return StatusCode::HostApiUnsupportedScenario;
+			}
+		}
+
+		static int32_t HOSTFXR_CALLTYPE GetRuntimePropertyValue([[maybe_unused]] const hostfxr_handle handle, [[maybe_unused]] const char_t* name, const char_t** outValue)
+		{
+			*outValue = nullptr;
+			return StatusCode::HostApiUnsupportedScenario;
+		}
+
+		static int32_t HOSTFXR_CALLTYPE SetRuntimePropertyValue([[maybe_unused]] const hostfxr_handle handle, [[maybe_unused]] const char_t* name, [[maybe_unused]] const char_t* value)
+		{
+			return StatusCode::HostApiUnsupportedScenario;
+		}
+
+		static int32_t HOSTFXR_CALLTYPE GetRuntimeProperties([[maybe_unused]] const hostfxr_handle handle, size_t* count, [[maybe_unused]] const char_t** keys, [[maybe_unused]] const char_t** values)
+		{
+			*count = 0;
+			return StatusCode::Success;
+		}
+
+		static int32_t HOSTFXR_CALLTYPE RunApp([[maybe_unused]] const hostfxr_handle handle)
+		{
+			return StatusCode::HostApiUnsupportedScenario;
+		}
+
+		static int32_t HOSTFXR_CALLTYPE Close([[maybe_unused]] const hostfxr_handle handle)
+		{
+			return StatusCode::Success;
+		}
+
+		static bool Load(const std::filesystem::path& libraryPath)
+		{
+			StartupSpan span{ StartupPhases::LOAD_NATIVE_AOT };
+
+			i_loadedFxr.module = SHAREDLIB_LOAD(libraryPath.c_str());
+			if (i_loadedFxr.module == NULL)
+			{
+				std::cerr << "Failed to load the NativeAOT library: " << libraryPath << "\n";
+				return false;
+			}
+
+			i_loadedFxr.funcs.set_error_writer = &SetErrorWriter;
+			i_loadedFxr.funcs.initialize_for_dotnet_command_line = &InitializeForCommandLine;
+			i_loadedFxr.funcs.initialize_for_runtime_config = &InitializeForRuntimeConfig;
+			i_loadedFxr.funcs.get_runtime_delegate = &GetRuntimeDelegate;
+			i_loadedFxr.funcs.get_runtime_property_value = &GetRuntimePropertyValue;
+			i_loadedFxr.funcs.set_runtime_property_value = &SetRuntimePropertyValue;
+			i_loadedFxr.funcs.get_runtime_properties = &GetRuntimeProperties;
+			i_loadedFxr.funcs.run_app = &RunApp;
+			i_loadedFxr.funcs.close = &Close;
+			return true;
+		}
+	}
+
+	// Find and load the hostfxr by using nethost (or the cache), or load it directly if the path is specified.
+	static sharedlib_t LoadHostFxr(const InitOptions& options);
 
 	static void ThrowIfUninitialized()
 	{
-		if (!i_isHostFxrLoaded)
+		if (!i_isBackendLoaded.load(std::memory_order_acquire))
 		{
 			throw std::runtime_error("Init is required to execute this");
 		}
@@ -68,10 +420,31 @@ namespace NetHost
 
 	bool Init(std::optional<std::filesystem::path> pathToRuntime)
 	{
-		if (i_isHostFxrLoaded)
+		InitOptions options;
+		options.pathToRuntime = std::move(pathToRuntime);
+
+		return Init(options);
+	}
+
+	bool Init(const InitOptions& options)
+	{
+		std::lock_guard lock{ i_initMutex };
+		if (i_isBackendLoaded.load(std::memory_order_relaxed))
 			return true;
 
-		i_loadedFxr.module = LoadHostFxr(std::move(pathToRuntime));
+		StartupSpan span{ StartupPhases::INIT };
+
+		if (options.backend == HostBackend::NativeAot)
+		{
+			if (!options.nativeAotLibrary.has_value() || !NativeAot::Load(*options.nativeAotLibrary))
+				return false;
+
+			i_backend = HostBackend::NativeAot;
+			i_isBackendLoaded.store(true, std::memory_order_release);
+			return true;
+		}
+
+		i_loadedFxr.module = LoadHostFxr(options);
 		if (i_loadedFxr.module == NULL)
 		{
 			return false;
@@ -82,25 +455,42 @@ namespace NetHost
 		i_loadedFxr.funcs.initialize_for_dotnet_command_line = (hostfxr_initialize_for_dotnet_command_line_fn)SHAREDLIB_SYM(i_loadedFxr.module, "hostfxr_initialize_for_dotnet_command_line");
 		i_loadedFxr.funcs.initialize_for_runtime_config = (hostfxr_initialize_for_runtime_config_fn)SHAREDLIB_SYM(i_loadedFxr.module, "hostfxr_initialize_for_runtime_config");
 		i_loadedFxr.funcs.get_runtime_delegate = (hostfxr_get_runtime_delegate_fn)SHAREDLIB_SYM(i_loadedFxr.module, "hostfxr_get_runtime_delegate");
+		i_loadedFxr.funcs.get_runtime_property_value = (hostfxr_get_runtime_property_value_fn)SHAREDLIB_SYM(i_loadedFxr.module, "hostfxr_get_runtime_property_value");
+		i_loadedFxr.funcs.set_runtime_property_value = (hostfxr_set_runtime_property_value_fn)SHAREDLIB_SYM(i_loadedFxr.module, "hostfxr_set_runtime_property_value");
+		i_loadedFxr.funcs.get_runtime_properties = (hostfxr_get_runtime_properties_fn)SHAREDLIB_SYM(i_loadedFxr.module, "hostfxr_get_runtime_properties");
 		i_loadedFxr.funcs.run_app = (hostfxr_run_app_fn)SHAREDLIB_SYM(i_loadedFxr.module, "hostfxr_run_app");
 		i_loadedFxr.funcs.close = (hostfxr_close_fn)SHAREDLIB_SYM(i_loadedFxr.module, "hostfxr_close");
 
-		i_isHostFxrLoaded = true;
+		i_backend = HostBackend::HostFxr;
+		i_isBackendLoaded.store(true, std::memory_order_release);
 		return true;
 	}
 
+	std::shared_future<bool> InitAsync(const InitOptions& options)
+	{
+		return std::async(std::launch::async, [options]() { return Init(options); }).share();
+	}
+
 	void Shutdown()
 	{
-		if (!i_isHostFxrLoaded)
+		std::lock_guard lock{ i_initMutex };
+		if (!i_isBackendLoaded.load(std::memory_order_relaxed))
 			return;
 
-		SHAREDLIB_FREE(i_loadedFxr.module);
-		i_isHostFxrLoaded = false;
+		i_isBackendLoaded.store(false, std::memory_order_release);
+
+		if (i_backend == HostBackend::HostFxr)
+			SHAREDLIB_FREE(i_loadedFxr.module);
 	}
 
 	bool IsInited()
 	{
-		return i_isHostFxrLoaded;
+		return i_isBackendLoaded.load(std::memory_order_acquire);
+	}
+
+	HostBackend GetBackend()
+	{
+		return i_backend;
 	}
 
 	void SetErrorWriter(ErrorWriterCallback callback)
@@ -109,15 +499,18 @@ namespace NetHost
 		i_loadedFxr.funcs.set_error_writer(callback);
 	}
 
-	HostContext::HostContext(void* handle) : handle(handle)
+	HostContext::HostContext(void* handle) : handle(handle), cache(std::make_shared<ResolutionCache>())
 	{
 	}
 
 	HostContext::HostContext(HostContext&& other) noexcept
 	{
 		handle = std::exchange(other.handle, nullptr);
+		cache = std::move(other.cache);
 	}
 
+	HostContext::~HostContext() = default;
+
 	void HostContext::Close()
 	{
 		ThrowIfUninitialized();
@@ -125,6 +518,14 @@ namespace NetHost
 
 		i_loadedFxr.funcs.close(handle);
 		handle = nullptr;
+
+		// The function pointers may become invalid with the context.
+		cache->Clear();
+	}
+
+	std::vector<ResolvedMethod> HostContext::GetResolutionLog() const
+	{
+		return cache != nullptr ? cache->GetLog() : std::vector<ResolvedMethod>{};
 	}
 
 	int HostContext::RunApp() const
@@ -132,9 +533,66 @@ namespace NetHost
 		ThrowIfUninitialized();
 		ThrowIfNoValidHandle();
 
+		OnRuntimeLoaded();
 		return i_loadedFxr.funcs.run_app(handle);
 	}
 
+	std::optional<std::basic_string<char_t>> HostContext::GetRuntimeProperty(const char_t* name) const
+	{
+		ThrowIfUninitialized();
+		ThrowIfNoValidHandle();
+
+		const char_t* value = nullptr;
+		int result = i_loadedFxr.funcs.get_runtime_property_value(handle, name, &value);
+		if (!STATUS_CODE_SUCCEEDED(result) || value == nullptr)
+			return std::nullopt;
+
+		return value;
+	}
+
+	bool HostContext::SetRuntimeProperty(const char_t* name, const char_t* value) const
+	{
+		ThrowIfUninitialized();
+		ThrowIfNoValidHandle();
+
+		int result = i_loadedFxr.funcs.set_runtime_property_value(handle, name, value);
+		return STATUS_CODE_SUCCEEDED(result);
+	}
+
+	std::vector<std::pair<std::basic_string<char_t>, std::basic_string<char_t>>> HostContext::GetRuntimeProperties() const
+	{
+		ThrowIfUninitialized();
+		ThrowIfNoValidHandle();
+
+		size_t count = 0;
+		int result = i_loadedFxr.funcs.get_runtime_properties(handle, &count, nullptr, nullptr);
+		if (result != (int)StatusCode::HostApiBufferTooSmall && !STATUS_CODE_SUCCEEDED(result))
+			return {};
+
+		std::vector<const char_t*> keys(count);
+		std::vector<const char_t*> values(count);
+
+		result = i_loadedFxr.funcs.get_runtime_properties(handle, &count, keys.data(), values.data());
+		if (!STATUS_CODE_SUCCEEDED(result))
+			return {};
+
+		std::vector<std::pair<std::basic_string<char_t>, std::basic_string<char_t>>> properties;
+		for (size_t i = 0; i < count; i++)
+			properties.emplace_back(keys[i], values[i] != nullptr ? values[i] : NH_STR(""));
+
+		return properties;
+	}
+
+	RuntimeTuning HostContext::GetRuntimeTuning() const
+	{
+		RuntimeTuning tuning;
+		ReadRuntimeTuning(tuning, [this](const char_t* name) { return GetRuntimeProperty(name); });
+
+		std::lock_guard lock{ i_readyToRunMutex };
+		tuning.readyToRun = i_readyToRun;
+		return tuning;
+	}
+
 	void HostContext::ThrowIfNoValidHandle() const
 	{
 		if (!IsValid())
@@ -145,19 +603,45 @@ namespace NetHost
 
 	void* rd_LoadAssemblyAndGetFuncPointer::operator()(const char_t* assemblyPath, const char_t* typeName, const char_t* methodName, const char_t* delegateTypeName) const
 	{
-		void* outCallback;
+		std::basic_string<char_t> key;
+		if (cache != nullptr)
+		{
+			key = MakeResolutionKey(assemblyPath, typeName, methodName, delegateTypeName);
+			if (void* cached = cache->Find(key))
+				return cached;
+		}
+
+		std::optional<StartupSpan> span;
+		if (!i_isFirstLoadAssemblyRecorded.load(std::memory_order_relaxed) && !i_isFirstLoadAssemblyRecorded.exchange(true))
+			span.emplace(StartupPhases::FIRST_LOAD_ASSEMBLY);
+
+		void* outCallback = nullptr;
 		int result = ((load_assembly_and_get_function_pointer_fn)delegate)(assemblyPath, typeName, methodName, delegateTypeName, nullptr, &outCallback);
 
 		assert(result == StatusCode::Success);
+		if (cache != nullptr && outCallback != nullptr)
+			cache->Store(key, outCallback);
+
 		return outCallback;
 	}
 
 	void* rd_GetFuncPointer::operator()(const char_t* typeName, const char_t* methodName, const char_t* delegateTypeName) const
 	{
-		void* outCallback;
+		std::basic_string<char_t> key;
+		if (cache != nullptr)
+		{
+			key = MakeResolutionKey(nullptr, typeName, methodName, delegateTypeName);
+			if (void* cached = cache->Find(key))
+				return cached;
+		}
+
+		void* outCallback = nullptr;
 		int result = ((get_function_pointer_fn)delegate)(typeName, methodName, delegateTypeName, nullptr, nullptr, &outCallback);
 
 		assert(result == StatusCode::Success);
+		if (cache != nullptr && outCallback != nullptr)
+			cache->Store(key, outCallback);
+
 		return outCallback;
 	}
 
@@ -169,11 +653,13 @@ namespace NetHost
 		hostfxr_delegate_type delegateType = hdt_load_assembly_and_get_function_pointer;
 		void* delegate = nullptr;
 
+		StartupSpan span{ StartupPhases::GET_RUNTIME_DELEGATE };
 		int result = i_loadedFxr.funcs.get_runtime_delegate(handle, delegateType, &delegate);
 		if (!STATUS_CODE_SUCCEEDED(result))
 			return {};
 
-		return { delegate };
+		OnRuntimeLoaded();
+		return { delegate, cache };
 	}
 
 	rd_GetFuncPointer HostContext::GetGetFuncPointer() const
@@ -184,11 +670,13 @@ namespace NetHost
 		hostfxr_delegate_type delegateType = hdt_get_function_pointer;
 		void* delegate = nullptr;
 
+		StartupSpan span{ StartupPhases::GET_RUNTIME_DELEGATE };
 		int result = i_loadedFxr.funcs.get_runtime_delegate(handle, delegateType, &delegate);
 		if (!STATUS_CODE_SUCCEEDED(result))
 			return {};
 
-		return { delegate };
+		OnRuntimeLoaded();
+		return { delegate, cache };
 	}
 
 	HostContext NewContextForCommandLine(int argc, const char_t** argv)
@@ -196,6 +684,7 @@ namespace NetHost
 		ThrowIfUninitialized();
 
 		hostfxr_handle hostHandle;
+		StartupSpan span{ StartupPhases::INITIALIZE_FOR_COMMAND_LINE };
 		int result = i_loadedFxr.funcs.initialize_for_dotnet_command_line(argc, argv, NULL, &hostHandle);
 		assert(result == StatusCode::Success);
 
@@ -207,34 +696,114 @@ namespace NetHost
 		ThrowIfUninitialized();
 
 		hostfxr_handle hostHandle;
+		StartupSpan span{ StartupPhases::INITIALIZE_FOR_RUNTIME_CONFIG };
 		int result = i_loadedFxr.funcs.initialize_for_runtime_config(configPath, NULL, &hostHandle);
 		assert(result == StatusCode::Success);
 
 		return HostContext(hostHandle);
 	}
 
-	sharedlib_t LoadHostFxr(std::optional<std::filesystem::path> pathToRuntime)
+	// Create a context with the settings of the tuning that are runtime properties, leaving ReadyToRun to the caller.
+	static HostContext NewContextWithProperties(const char_t* configPath, const RuntimeTuning& tuning)
 	{
-		auto dllToLoad = pathToRuntime.value_or(std::filesystem::path());
-		if (!pathToRuntime.has_value())
+		using namespace TuningProperties;
+
+		HostContext context = NewContextForRuntimeConfig(configPath);
+
+		std::vector<std::pair<const char_t*, std::basic_string<char_t>>> properties;
+		if (tuning.serverGC.has_value())
+			properties.emplace_back(SERVER_GC, ToPropertyValue(*tuning.serverGC));
+		if (tuning.concurrentGC.has_value())
+			properties.emplace_back(CONCURRENT_GC, ToPropertyValue(*tuning.concurrentGC));
+		if (tuning.gcHeapHardLimit.has_value())
+			properties.emplace_back(GC_HEAP_HARD_LIMIT, ToPropertyValue(*tuning.gcHeapHardLimit));
+		if (tuning.gcHeapCount.has_value())
+			properties.emplace_back(GC_HEAP_COUNT, ToPropertyValue((uint64_t)*tuning.gcHeapCount));
+		if (tuning.gcHeapAffinitizeMask.has_value())
+			properties.emplace_back(GC_HEAP_AFFINITIZE_MASK, ToPropertyValue(*tuning.gcHeapAffinitizeMask));
+		if (tuning.tieredCompilation.has_value())
+			properties.emplace_back(TIERED_COMPILATION, ToPropertyValue(*tuning.tieredCompilation));
+		if (tuning.tieredPGO.has_value())
+			properties.emplace_back(TIERED_PGO, ToPropertyValue(*tuning.tieredPGO));
+		if (tuning.quickJitForLoops.has_value())
+			properties.emplace_back(QUICK_JIT_FOR_LOOPS, ToPropertyValue(*tuning.quickJitForLoops));
+
+		for (const auto& [name, value] : properties)
 		{
-			char_t hostFxrPathBuffer[MAX_PATH];
-			size_t buffSize = MAX_PATH;
-
-			int result = get_hostfxr_path(hostFxrPathBuffer, &buffSize, nullptr);
-			if (result == StatusCode::CoreHostLibMissingFailure)
+			if (!context.SetRuntimeProperty(name, value.c_str()))
 			{
-				std::cerr << "The core host lib is missing. Failed to find hostfxr.dll.\n";
-				return NULL;
+				context.Close();
+				throw std::runtime_error("Failed to apply the runtime tuning, the runtime is probably loaded already");
 			}
+		}
 
-			assert(result != StatusCode::HostApiBufferTooSmall);
-			assert(STATUS_CODE_SUCCEEDED(result));
+		return context;
+	}
 
-			dllToLoad = std::basic_string_view<char_t>(hostFxrPathBuffer, buffSize);
+	HostContext NewContextForRuntimeConfig(const char_t* configPath, const RuntimeTuning& tuning)
+	{
+		HostContext context = NewContextWithProperties(configPath, tuning);
+
+		// Read by the runtime when it starts, which is when the first runtime delegate is taken.
+		try
+		{
+			ApplyReadyToRun(tuning.readyToRun);
 		}
-		else
+		catch (...)
+		{
+			context.Close();
+			throw;
+		}
+
+		return context;
+	}
+
+	std::future<HostContext> NewContextForRuntimeConfigAsync(std::shared_future<bool> init, std::filesystem::path configPath, std::optional<RuntimeTuning> tuning)
+	{
+		// Set right away, since changing the environment on the background thread would race with this one reading it.
+		if (tuning.has_value())
+			ApplyReadyToRun(tuning->readyToRun);
+
+		return std::async(std::launch::async, [init = std::move(init), configPath = std::move(configPath), tuning = std::move(tuning)]()
+		{
+			if (!init.get())
+				throw std::runtime_error("NetHost::Init has failed");
+
+			HostContext context = tuning.has_value() ? NewContextWithProperties(configPath.c_str(), *tuning) : NewContextForRuntimeConfig(configPath.c_str());
+
+			// Taking the first runtime delegate is what starts the runtime.
+			context.GetLoadAssemblyAndGetFuncPointer();
+			return context;
+		});
+	}
+
+	// Find the hostfxr with nethost, or return an empty path if it has failed.
+	static std::filesystem::path FindHostFxr()
+	{
+		char_t hostFxrPathBuffer[MAX_PATH];
+		size_t buffSize = MAX_PATH;
+
+		StartupSpan span{ StartupPhases::GET_HOSTFXR_PATH };
+		int result = get_hostfxr_path(hostFxrPathBuffer, &buffSize, nullptr);
+		if (result == StatusCode::CoreHostLibMissingFailure)
+		{
+			std::cerr << "The core host lib is missing. Failed to find hostfxr.dll.\n";
+			return {};
+		}
+
+		assert(result != StatusCode::HostApiBufferTooSmall);
+		assert(STATUS_CODE_SUCCEEDED(result));
+
+		// The returned size may include the null terminator.
+		return std::basic_string<char_t>(hostFxrPathBuffer);
+	}
+
+	sharedlib_t LoadHostFxr(const InitOptions& options)
+	{
+		std::filesystem::path dllToLoad;
+		if (options.pathToRuntime.has_value())
 		{
+			dllToLoad = *options.pathToRuntime;
 			if (!std::filesystem::is_directory(dllToLoad))
 			{
 				std::cerr << "The path must point to a folder containing runtime, but it's not a directory.\n";
@@ -249,7 +818,31 @@ namespace NetHost
 				return NULL;
 			}
 		}
+		else if (options.hostFxrCache != HostFxrCacheLocation::None)
+		{
+			auto cacheFile = HostFxrCache::GetCacheFilePath(options.hostFxrCache == HostFxrCacheLocation::NextToExecutable);
+			{
+				StartupSpan span{ StartupPhases::READ_HOSTFXR_CACHE };
+				dllToLoad = HostFxrCache::Load(cacheFile, options.runtimeConfigPath).value_or(std::filesystem::path());
+			}
+
+			if (dllToLoad.empty())
+			{
+				dllToLoad = FindHostFxr();
+				if (dllToLoad.empty())
+					return NULL;
+
+				HostFxrCache::Store(cacheFile, dllToLoad, options.runtimeConfigPath);
+			}
+		}
+		else
+		{
+			dllToLoad = FindHostFxr();
+			if (dllToLoad.empty())
+				return NULL;
+		}
 
+		StartupSpan span{ StartupPhases::LOAD_HOSTFXR };
 		sharedlib_t module = SHAREDLIB_LOAD(dllToLoad.c_str());
 		if (module == NULL)
 		{
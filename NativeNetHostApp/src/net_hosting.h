@@ -1,5 +1,10 @@
 #pragma once
 #include <string>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <future>
 #include <optional>
 #include <filesystem>
 
@@ -50,23 +55,105 @@ namespace NetHost
 	/// @param pathToRuntime Optionally a custom path may be specified to the folder containing hostfxr which will skip using nethost to find the hostfxr library.
 	bool Init(std::optional<std::filesystem::path> pathToRuntime = {});
 
+	// Where the resolved hostfxr path is cached between launches (see hostfxr_cache.h).
+	enum class HostFxrCacheLocation
+	{
+		None, // Always find hostfxr with nethost.
+		NextToExecutable,
+		UserCache, // $XDG_CACHE_HOME (or ~/.cache) on Linux, %LOCALAPPDATA% on Windows.
+	};
+
+	// What runs the managed code.
+	enum class HostBackend
+	{
+		// CoreCLR, started by hostfxr (found with nethost).
+		HostFxr,
+
+		// A NativeAOT-compiled shared library of the managed app, so there's no runtime to find and start. Managed methods are
+		// resolved as exports named after them: "Namespace_Type_Method" (dots and '+' replaced with '_'), which are declared
+		// with `[UnmanagedCallersOnly(EntryPoint = "Namespace_Type_Method")]`. The assembly path and the delegate type name are
+		// ignored, so the export must have the exact native signature the caller uses. Runtime properties are not supported,
+		// and the library is never unloaded.
+		NativeAot,
+	};
+
+	struct InitOptions
+	{
+		HostBackend backend = HostBackend::HostFxr;
+
+		// The NativeAOT-compiled shared library to load (required for the NativeAot backend).
+		std::optional<std::filesystem::path> nativeAotLibrary;
+
+		// [HostFxr] A custom path to the folder containing hostfxr, which skips using nethost (and the cache) to find it.
+		std::optional<std::filesystem::path> pathToRuntime;
+
+		// [HostFxr, opt-in] Remember the hostfxr path nethost has found, and load it directly on the next launches, as long as the
+		// library, the installed hostfxr versions, DOTNET_ROOT and the runtime config's framework reference haven't changed.
+		HostFxrCacheLocation hostFxrCache = HostFxrCacheLocation::None;
+
+		// The runtime config the contexts will be created for, so the cache is invalidated when its framework reference changes.
+		std::optional<std::filesystem::path> runtimeConfigPath;
+	};
+
+	// The same as above, but with more options.
+	bool Init(const InitOptions& options);
+
+	// Init() on a background thread, so the native side can initialize its own subsystems while hostfxr is found and loaded.
+	std::shared_future<bool> InitAsync(const InitOptions& options);
+
+	// Init() and Shutdown() can be called from any thread, and everything else can be used from any number of threads at once
+	// in between. Nothing may be in use by other threads while Shutdown() runs though.
+
 	// Deinitialize the utilities and unload the hostfxr library. Does nothing if it's not inited.
+	// A NativeAOT library stays loaded, since it can't be unloaded safely.
 	void Shutdown();
 
 	// Determine is library inited successfully.
 	bool IsInited();
 
+	// The backend selected at Init().
+	HostBackend GetBackend();
+
 	// Specify a callback that will be invoked by .NET hosting components when an error is occured.
 	void SetErrorWriter(ErrorWriterCallback callback);
 
+	// A typed wrapper over a raw pointer to a managed method, so the call site doesn't have to cast it to the right
+	// signature with the right calling convention. Calling it costs exactly one indirect call.
+	template<typename Signature>
+	class ManagedFunction;
+
+	template<typename R, typename... Args>
+	class ManagedFunction<R(Args...)>
+	{
+	public:
+		typedef R (DELEGATE_CALLTYPE *Pointer)(Args...);
+
+	private:
+		Pointer pointer = nullptr;
+
+	public:
+		ManagedFunction() = default;
+		explicit ManagedFunction(void* pointer) : pointer((Pointer)pointer) {}
+
+		R operator()(Args... args) const { return pointer(args...); }
+
+		bool HasValue() const { return pointer != nullptr; }
+		Pointer Get() const { return pointer; }
+	};
+
+	// Remembers the managed methods already resolved within a single host context, so resolving the same
+	// (assembly, type, method, delegate type) again doesn't go back into the runtime. Defined in net_hosting.cpp.
+	class ResolutionCache;
+
 	// Base class for all runtime delegates, which are basically functors that wrap runtime delegates that hostfxr provides via `get_runtime_delegate`.
 	class RuntimeDelegate
 	{
 	protected:
 		void* delegate = nullptr;
+		std::shared_ptr<ResolutionCache> cache; // Shared with the context, so a delegate can outlive the context object.
 
 	public:
-		RuntimeDelegate(void* delegate) : delegate(delegate) {}
+		RuntimeDelegate(void* delegate, std::shared_ptr<ResolutionCache> cache = nullptr) : delegate(delegate), cache(std::move(cache)) {}
 		RuntimeDelegate() = default;
 
 		bool HasValue() const { return delegate != nullptr; }
@@ -80,6 +167,13 @@ namespace NetHost
 		using RuntimeDelegate::RuntimeDelegate;
 
 		void* operator()(const char_t* assemblyPath, const char_t* typeName, const char_t* methodName, const char_t* delegateTypeName = nullptr) const;
+
+		// The same as invoking the delegate, but wraps the pointer into a function object of the specified signature.
+		template<typename Signature>
+		ManagedFunction<Signature> GetFunction(const char_t* assemblyPath, const char_t* typeName, const char_t* methodName, const char_t* delegateTypeName = nullptr) const
+		{
+			return ManagedFunction<Signature>{ (*this)(assemblyPath, typeName, methodName, delegateTypeName) };
+		}
 	};
 
 	// A delegate to get function pointer to a managed method [NET 5+].
@@ -89,16 +183,56 @@ namespace NetHost
 		using RuntimeDelegate::RuntimeDelegate;
 
 		void* operator()(const char_t* typeName, const char_t* methodName, const char_t* delegateTypeName = nullptr) const;
+
+		// The same as invoking the delegate, but wraps the pointer into a function object of the specified signature.
+		template<typename Signature>
+		ManagedFunction<Signature> GetFunction(const char_t* typeName, const char_t* methodName, const char_t* delegateTypeName = nullptr) const
+		{
+			return ManagedFunction<Signature>{ (*this)(typeName, methodName, delegateTypeName) };
+		}
 	};
 
+	// GC and JIT settings applied to a runtime before it starts, instead of editing its runtimeconfig.json. Every setting left
+	// empty keeps what the runtime config says (or the runtime's default). Most of them are passed as runtime properties,
+	// the same ones runtimeconfig.json's "configProperties" set.
+	struct RuntimeTuning
+	{
+		std::optional<bool> serverGC; // System.GC.Server
+		std::optional<bool> concurrentGC; // System.GC.Concurrent
+		std::optional<uint64_t> gcHeapHardLimit; // System.GC.HeapHardLimit, in bytes.
+		std::optional<uint32_t> gcHeapCount; // System.GC.HeapCount (Server GC only).
+		std::optional<uint64_t> gcHeapAffinitizeMask; // System.GC.HeapAffinitizeMask (Server GC only).
+
+		std::optional<bool> tieredCompilation; // System.Runtime.TieredCompilation
+		std::optional<bool> tieredPGO; // System.Runtime.TieredPGO
+		std::optional<bool> quickJitForLoops; // System.Runtime.TieredCompilation.QuickJitForLoops
+
+		// Whether precompiled (ReadyToRun) code is used. The runtime has no property for it, so it's set with the
+		// DOTNET_ReadyToRun environment variable of this process instead, which only works until the runtime is loaded.
+		std::optional<bool> readyToRun;
+	};
+
+	// A managed method resolved through the runtime delegates of a host context.
+	struct ResolvedMethod
+	{
+		std::basic_string<char_t> assemblyPath; // Empty if it's resolved from the default load context (rd_GetFuncPointer).
+		std::basic_string<char_t> typeName; // Assembly qualified.
+		std::basic_string<char_t> methodName;
+	};
+
+	// Runtime delegates taken from a host context share its resolution cache, so the same managed method is looked up
+	// by the runtime only once per context. The cache is emptied when the context is closed, and freed with the last of
+	// the context and its delegates, so the delegates stay usable (like HostComm's) after the context object is gone.
 	class HostContext
 	{
 	private:
 		void* handle = nullptr;
+		std::shared_ptr<ResolutionCache> cache;
 
 	public:
 		HostContext(void* handle);
 		HostContext(HostContext&& other) noexcept;
+		~HostContext();
 
 		HostContext(const HostContext& handle) = delete;
 		HostContext& operator=(const HostContext& handle) = delete;
@@ -108,9 +242,28 @@ namespace NetHost
 		rd_LoadAssemblyAndGetFuncPointer GetLoadAssemblyAndGetFuncPointer() const;
 		rd_GetFuncPointer GetGetFuncPointer() const;
 
+		// Every managed method resolved through the context so far (even if it's closed since), in the order they were
+		// first resolved. Useful to warm the same methods up in the next run (see host_warmup.h).
+		std::vector<ResolvedMethod> GetResolutionLog() const;
+
 		// Run the managed app (works if you use InitForCommandLine() to host an app) and return when it exits.
 		int RunApp() const;
 
+		// Get a runtime property of the context (from its runtime config, or set by the host), or nothing if there's no such property.
+		std::optional<std::basic_string<char_t>> GetRuntimeProperty(const char_t* name) const;
+
+		// Set (or remove if the value is null) a runtime property. Only possible for the first context, before the runtime
+		// is loaded (that is, before the first runtime delegate is taken). Returns false if it's not possible anymore.
+		bool SetRuntimeProperty(const char_t* name, const char_t* value) const;
+
+		// All runtime properties of the context.
+		std::vector<std::pair<std::basic_string<char_t>, std::basic_string<char_t>>> GetRuntimeProperties() const;
+
+		// The effective tuning: the runtime properties (whether they come from RuntimeTuning or the runtime config), and
+		// ReadyToRun as a tuning has applied it, or as the runtime has been loaded with. Settings that aren't set anywhere
+		// are left empty (the runtime's default).
+		RuntimeTuning GetRuntimeTuning() const;
+
 		// A host context is valid if it wasn't disposed or moved to another object, meaning that you can safely work with it.
 		inline bool IsValid() const { return handle != nullptr; }
 
@@ -128,4 +281,16 @@ namespace NetHost
 	// The component part means you **load** a library in addition to the native application, in contrast to running it as a
 	// managed sub-application.
 	HostContext NewContextForRuntimeConfig(const char_t* configPath);
+
+	// The same as above, but applies the tuning to the runtime before it starts. Throws std::runtime_error if the tuning
+	// can't be applied, which is the case when the runtime is already loaded by another context. The environment is
+	// changed (for ReadyToRun) on the calling thread, so no other thread may be reading it meanwhile.
+	HostContext NewContextForRuntimeConfig(const char_t* configPath, const RuntimeTuning& tuning);
+
+	// Create a context for the runtime config on a background thread once `init` has succeeded, and start the runtime in it
+	// (by taking its first runtime delegate), so all of that overlaps with the native side's own initialization. Since the
+	// runtime is started, runtime properties can only be set through the tuning.
+	/// @return The context. Throws std::runtime_error if the init or applying the tuning has failed. ReadyToRun is applied
+	/// on the calling thread before returning (throwing right away if the runtime is loaded already).
+	std::future<HostContext> NewContextForRuntimeConfigAsync(std::shared_future<bool> init, std::filesystem::path configPath, std::optional<RuntimeTuning> tuning = {});
 }
@@ -0,0 +1,119 @@
+#include "startup_profile.h"
+
+#include <mutex>
+#include <atomic>
+#include <limits>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+namespace
+{
+	struct RecordedPhase
+	{
+		const char* name;
+		std::chrono::steady_clock::time_point start;
+		std::chrono::steady_clock::time_point end;
+		uint32_t threadId;
+	};
+
+	// Phases like get_runtime_delegate may be repeated by the app, so the profile can't grow forever.
+	constexpr size_t MAX_RECORDED_PHASES = 256;
+
+	std::mutex g_profileMutex;
+	std::vector<RecordedPhase> g_recordedPhases;
+
+	uint64_t ToNs(std::chrono::steady_clock::duration duration)
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+	}
+}
+
+namespace NetHost
+{
+	uint32_t GetProfileThreadId()
+	{
+		static std::atomic<uint32_t> s_nextThreadId{ 1 };
+		thread_local uint32_t threadId = s_nextThreadId.fetch_add(1, std::memory_order_relaxed);
+
+		return threadId;
+	}
+
+	StartupSpan::~StartupSpan()
+	{
+		auto end = std::chrono::steady_clock::now();
+
+		std::lock_guard lock{ g_profileMutex };
+		if (g_recordedPhases.size() < MAX_RECORDED_PHASES)
+			g_recordedPhases.push_back(RecordedPhase{ name, start, end, GetProfileThreadId() });
+	}
+
+	const StartupPhase* StartupProfile::Find(const char* name) const
+	{
+		for (const StartupPhase& phase : phases)
+		{
+			if (strcmp(phase.name, name) == 0)
+				return &phase;
+		}
+
+		return nullptr;
+	}
+
+	uint64_t StartupProfile::GetTotalNs() const
+	{
+		uint64_t end = 0;
+		for (const StartupPhase& phase : phases)
+			end = std::max(end, phase.startNs + phase.durationNs);
+
+		return end;
+	}
+
+	StartupProfile GetStartupProfile()
+	{
+		std::lock_guard lock{ g_profileMutex };
+
+		StartupProfile profile;
+		if (g_recordedPhases.empty())
+			return profile;
+
+		auto origin = std::min_element(g_recordedPhases.begin(), g_recordedPhases.end(),
+			[](const RecordedPhase& a, const RecordedPhase& b) { return a.start < b.start; })->start;
+
+		profile.origin = origin;
+		profile.phases.reserve(g_recordedPhases.size());
+		for (const RecordedPhase& phase : g_recordedPhases)
+			profile.phases.push_back(StartupPhase{ phase.name, ToNs(phase.start - origin), ToNs(phase.end - phase.start), phase.threadId });
+
+		return profile;
+	}
+
+	bool WriteStartupTrace(const std::filesystem::path& filePath)
+	{
+		StartupProfile profile = GetStartupProfile();
+
+		std::ofstream output{ filePath, std::ios::trunc };
+		if (!output)
+			return false;
+
+		// Complete ("X") events, with the timestamps in microseconds.
+		output << std::fixed << std::setprecision(3);
+		output << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+		for (size_t i = 0; i < profile.phases.size(); i++)
+		{
+			const StartupPhase& phase = profile.phases[i];
+			output << "{\"name\":\"" << phase.name << "\",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":" << phase.threadId
+				<< ",\"ts\":" << phase.startNs / 1000.0 << ",\"dur\":" << phase.durationNs / 1000.0 << "}"
+				<< (i + 1 < profile.phases.size() ? ",\n" : "\n");
+		}
+
+		output << "]}\n";
+		return (bool)output;
+	}
+
+	void ResetStartupProfile()
+	{
+		std::lock_guard lock{ g_profileMutex };
+		g_recordedPhases.clear();
+	}
+}
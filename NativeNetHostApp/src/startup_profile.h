@@ -0,0 +1,80 @@
+#pragma once
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+
+// Timing of the phases the hosting goes through before the first managed call: finding and loading hostfxr,
+// initializing the runtime, getting the runtime delegates, the first load_assembly_and_get_function_pointer, and
+// HostComm::Init. Each phase is timed by a StartupSpan, which only reads the clock twice and appends one entry, so the
+// profile is always collected.
+
+namespace NetHost
+{
+	// The names of the recorded phases.
+	namespace StartupPhases
+	{
+		constexpr const char* INIT = "NetHost::Init";
+		constexpr const char* READ_HOSTFXR_CACHE = "read hostfxr cache";
+		constexpr const char* GET_HOSTFXR_PATH = "get_hostfxr_path";
+		constexpr const char* LOAD_HOSTFXR = "load hostfxr";
+		constexpr const char* LOAD_NATIVE_AOT = "load NativeAOT library";
+		constexpr const char* INITIALIZE_FOR_RUNTIME_CONFIG = "hostfxr_initialize_for_runtime_config";
+		constexpr const char* INITIALIZE_FOR_COMMAND_LINE = "hostfxr_initialize_for_dotnet_command_line";
+		constexpr const char* GET_RUNTIME_DELEGATE = "hostfxr_get_runtime_delegate";
+		constexpr const char* FIRST_LOAD_ASSEMBLY = "first load_assembly_and_get_function_pointer";
+		constexpr const char* HOSTCOMM_INIT = "HostComm::Init";
+		constexpr const char* WARMUP = "HostComm::Warmup"; // On a background thread, overlapping the phases after it.
+	}
+
+	struct StartupPhase
+	{
+		const char* name; // One of StartupPhases.
+		uint64_t startNs; // Since the first recorded phase has started.
+		uint64_t durationNs;
+		uint32_t threadId; // A small number identifying the thread within the process (see GetProfileThreadId()).
+	};
+
+	struct StartupProfile
+	{
+		// In the order the phases have finished, so nested phases come before the ones containing them.
+		std::vector<StartupPhase> phases;
+
+		// When the first recorded phase has started, which the phases are timed from.
+		std::chrono::steady_clock::time_point origin;
+
+		// Find the first recorded phase with the name, or return nullptr.
+		const StartupPhase* Find(const char* name) const;
+
+		// From the start of the first phase to the end of the last one.
+		uint64_t GetTotalNs() const;
+	};
+
+	// A small number identifying the calling thread, the same in the startup profile and in the traces (see host_trace.h).
+	uint32_t GetProfileThreadId();
+
+	// A copy of the phases recorded so far. Safe to call from any thread.
+	StartupProfile GetStartupProfile();
+
+	// Write the recorded phases as a Chrome trace (JSON), that chrome://tracing or Perfetto can open.
+	/// @return False if the file couldn't be written.
+	bool WriteStartupTrace(const std::filesystem::path& filePath);
+
+	// Forget the recorded phases, e.g. before measuring the startup of a new host context.
+	void ResetStartupProfile();
+
+	// Times a phase from its construction to its destruction, and adds it to the startup profile.
+	class StartupSpan
+	{
+	private:
+		const char* name;
+		std::chrono::steady_clock::time_point start;
+
+	public:
+		explicit StartupSpan(const char* name) : name(name), start(std::chrono::steady_clock::now()) {}
+		~StartupSpan();
+
+		StartupSpan(const StartupSpan&) = delete;
+		StartupSpan& operator=(const StartupSpan&) = delete;
+	};
+}
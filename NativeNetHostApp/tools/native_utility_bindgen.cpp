@@ -0,0 +1,203 @@
+// Generates C# bindings for the typed native utilities listed in native_utility_list.h.
+// Usage: NativeUtilityBindgen <output .cs file>
+//
+// Every utility becomes a static `delegate* unmanaged<...>` field plus a wrapper method calling it (or throwing
+// InvalidOperationException if the utility isn't registered), so the managed side calls native utilities directly. The default unmanaged calling convention of the platform is the same as
+// DELEGATE_CALLTYPE (stdcall on Windows x86, cdecl everywhere else).
+
+#include "native_utility.h"
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <cctype>
+
+namespace
+{
+	// Maps a blittable native type to the name of the same type in C#.
+	template<typename T, typename = void>
+	struct CsType
+	{
+		static_assert(sizeof(T) == 0, "There's no C# type mapped for this native type, add a CsType specialization");
+	};
+
+	template<typename T>
+	struct CsTypeName
+	{
+		static std::string Get() { return CsType<T>::name; }
+	};
+
+	template<typename T>
+	struct CsTypeName<T*>
+	{
+		static std::string Get() { return CsTypeName<std::remove_cv_t<T>>::Get() + "*"; }
+	};
+
+	template<> struct CsType<void> { static constexpr const char* name = "void"; };
+	template<> struct CsType<char> { static constexpr const char* name = "byte"; };
+	template<> struct CsType<float> { static constexpr const char* name = "float"; };
+	template<> struct CsType<double> { static constexpr const char* name = "double"; };
+
+	// Integers are mapped by their size and signedness, since e.g. `long` has different sizes on different platforms.
+	template<typename T>
+	struct CsType<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char>>>
+	{
+		static constexpr const char* name =
+			sizeof(T) == 1 ? (std::is_signed_v<T> ? "sbyte" : "byte") :
+			sizeof(T) == 2 ? (std::is_signed_v<T> ? "short" : "ushort") :
+			sizeof(T) == 4 ? (std::is_signed_v<T> ? "int" : "uint") :
+			(std::is_signed_v<T> ? "long" : "ulong");
+	};
+
+	struct UtilityBinding
+	{
+		std::string name;
+		uint32_t id;
+		std::string returnType;
+		std::vector<std::string> parameterTypes;
+	};
+
+	template<typename Signature>
+	struct BindingOf;
+
+	template<typename R, typename... Args>
+	struct BindingOf<R(Args...)>
+	{
+		static UtilityBinding Make(const char* name)
+		{
+			static_assert(HostComm::NativeUtilitySignature<R(Args...)>::IsBlittable, "Typed native utilities can only take and return blittable types");
+			return { name, HostComm::GetUtilityId(name), CsTypeName<std::remove_cv_t<R>>::Get(), { CsTypeName<std::remove_cv_t<Args>>::Get()... } };
+		}
+	};
+
+	// snake_case to PascalCase, so the generated members look like the rest of the C# code.
+	std::string ToPascalCase(const std::string& name)
+	{
+		std::string result;
+		bool upperNext = true;
+
+		for (char ch : name)
+		{
+			if (ch == '_')
+			{
+				upperNext = true;
+				continue;
+			}
+
+			result += upperNext ? (char)toupper((unsigned char)ch) : ch;
+			upperNext = false;
+		}
+
+		return result;
+	}
+
+	std::string GetFunctionPointerType(const UtilityBinding& binding)
+	{
+		std::string pointerType = "delegate* unmanaged<";
+		for (const std::string& type : binding.parameterTypes)
+			pointerType += type + ", ";
+
+		return pointerType + binding.returnType + ">";
+	}
+
+	std::string GenerateBindings(const std::vector<UtilityBinding>& bindings)
+	{
+		std::ostringstream out;
+		out << "// <auto-generated>\n";
+		out << "// Generated by NativeUtilityBindgen from NativeNetHostApp/src/native_utility_list.h. Don't edit it manually.\n";
+		out << "// </auto-generated>\n\n";
+		out << "namespace ManagedApp\n{\n";
+		out << "    /// <summary>\n";
+		out << "    /// Direct function pointers to the typed native utilities. They're bound by <see cref=\"HostComm\"/> when it's\n";
+		out << "    /// initialized, and rebound whenever it notices the native utilities have changed.\n";
+		out << "    /// </summary>\n";
+		out << "    public static unsafe class NativeUtilities\n    {\n";
+
+		for (const UtilityBinding& binding : bindings)
+		{
+			std::string pascalName = ToPascalCase(binding.name);
+			std::string pointerType = GetFunctionPointerType(binding);
+
+			std::string parameters;
+			std::string arguments;
+			for (size_t i = 0; i < binding.parameterTypes.size(); i++)
+			{
+				if (i != 0)
+				{
+					parameters += ", ";
+					arguments += ", ";
+				}
+
+				parameters += binding.parameterTypes[i] + " arg" + std::to_string(i);
+				arguments += "arg" + std::to_string(i);
+			}
+
+			out << "        public const uint " << pascalName << "Id = 0x" << std::hex << std::setw(8) << std::setfill('0') << binding.id << std::dec << ";\n";
+			out << "        public static " << pointerType << " " << pascalName << "Pointer;\n";
+			// The field is read once, since it may be rebound to null (the utility unregistered) in between.
+			out << "        public static " << binding.returnType << " " << pascalName << "(" << parameters << ")\n        {\n";
+			out << "            var pointer = " << pascalName << "Pointer;\n";
+			out << "            if (pointer == null)\n";
+			out << "                throw NotRegistered(\"" << binding.name << "\");\n\n";
+			out << "            " << (binding.returnType == "void" ? "" : "return ") << "pointer(" << arguments << ");\n";
+			out << "        }\n\n";
+		}
+
+		out << "        private static InvalidOperationException NotRegistered(string utilityName) =>\n";
+		out << "            new($\"The native utility '{utilityName}' isn't registered\");\n\n";
+
+		out << "        internal static void Bind()\n        {\n";
+		for (const UtilityBinding& binding : bindings)
+		{
+			std::string pascalName = ToPascalCase(binding.name);
+			std::string pointerType = GetFunctionPointerType(binding);
+
+			out << "            " << pascalName << "Pointer = (" << pointerType << ")HostComm.FindTypedNativeUtility(" << pascalName << "Id, \"" << binding.name << "\");\n";
+		}
+		out << "        }\n";
+
+		out << "    }\n}\n";
+		return out.str();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 2)
+	{
+		std::cerr << "Usage: NativeUtilityBindgen <output .cs file>\n";
+		return 1;
+	}
+
+	std::vector<UtilityBinding> bindings{
+#define NATIVE_UTILITY(name, ...) BindingOf<__VA_ARGS__>::Make(#name),
+#include "native_utility_list.h"
+#undef NATIVE_UTILITY
+	};
+
+	std::string generated = GenerateBindings(bindings);
+
+	// Don't touch the file if nothing has changed, so the managed project isn't rebuilt for no reason.
+	{
+		std::ifstream existing{ argv[1], std::ios::binary };
+		std::ostringstream existingContent;
+		existingContent << existing.rdbuf();
+
+		if (existing && existingContent.str() == generated)
+			return 0;
+	}
+
+	std::ofstream output{ argv[1], std::ios::binary | std::ios::trunc };
+	if (!output)
+	{
+		std::cerr << "Failed to open the output file: " << argv[1] << "\n";
+		return 1;
+	}
+
+	output << generated;
+	return 0;
+}
@@ -0,0 +1,187 @@
+﻿using System.Diagnostics;
+using System.Runtime.InteropServices;
+using System.Text;
+using ManagedApp;
+
+namespace NetHostBench
+{
+    /// <summary>
+    /// The same signature as the native DefaultDNetCallback, used for the explicit delegate type invocation style.
+    /// </summary>
+    public delegate int BenchCallback(IntPtr args, int sizeBytes);
+
+    /// <summary>
+    /// Managed counterparts of the NetHostBench native benchmark. The native side calls the entrypoints below in
+    /// different invocation styles, and also asks the managed side to run loops calling a native utility.
+    /// </summary>
+    public static unsafe class Benchmarks
+    {
+        // Touch the first and the last byte of the arguments, so their size isn't entirely free.
+        private static int Touch(IntPtr args, int sizeBytes)
+        {
+            if (sizeBytes == 0)
+                return 0;
+
+            byte* bytes = (byte*)args;
+            return bytes[0] + bytes[sizeBytes - 1];
+        }
+
+        /// <summary>
+        /// Called with the default signature (no delegate type name), and also by the batched calls.
+        /// </summary>
+        public static int DefaultEntrypoint(IntPtr args, int sizeBytes) => Touch(args, sizeBytes);
+
+        /// <summary>
+        /// Called with an explicit delegate type name (<see cref="BenchCallback"/>).
+        /// </summary>
+        public static int DelegateEntrypoint(IntPtr args, int sizeBytes) => Touch(args, sizeBytes);
+
+        /// <summary>
+        /// Called with the default signature, with the arguments packed by NetHost::ArgPack: an int and a span of bytes.
+        /// </summary>
+        public static int ArgPackEntrypoint(IntPtr args, int sizeBytes)
+        {
+            var reader = new ArgReader(args, sizeBytes);
+            int value = reader.Read<int>();
+            ReadOnlySpan<byte> bytes = reader.ReadSpan<byte>();
+
+            return bytes.IsEmpty ? value : value + bytes[0] + bytes[^1];
+        }
+
+        [UnmanagedCallersOnly]
+        public static int UnmanagedEntrypoint(IntPtr args, int sizeBytes) => Touch(args, sizeBytes);
+
+        /// <summary>
+        /// Takes the arguments over into a managed array, the way data produced on the native side usually gets to the
+        /// managed side without a buffer pool (compared with <see cref="BufferPoolBenchmarks"/>).
+        /// </summary>
+        [UnmanagedCallersOnly]
+        public static int CopyEntrypoint(IntPtr args, int sizeBytes)
+        {
+            byte[] copy = new ReadOnlySpan<byte>((byte*)args, sizeBytes).ToArray();
+            return copy.Length == 0 ? 0 : copy[0] + copy[^1];
+        }
+
+        /// <summary>
+        /// Call the `bench_echo` native utility in a loop, through a delegate (style 0) or a function pointer (style 1).
+        /// </summary>
+        /// <returns>Elapsed time of the whole loop in nanoseconds, or -1 if the utility is missing.</returns>
+        [UnmanagedCallersOnly]
+        public static long RunNativeCalls(int style, long iterations, int argBytes)
+        {
+            byte* args = stackalloc byte[Math.Max(argBytes, 1)];
+            new Span<byte>(args, Math.Max(argBytes, 1)).Fill(1);
+
+            long start;
+            int sink = 0;
+
+            if (style == 0)
+            {
+                BenchCallback utility = HostComm.GetNativeUtility<BenchCallback>("bench_echo");
+                if (utility == null)
+                    return -1;
+
+                start = Stopwatch.GetTimestamp();
+                for (long i = 0; i < iterations; i++)
+                    sink += utility((IntPtr)args, argBytes);
+            }
+            else
+            {
+                int ordinal = HostComm.GetNativeUtilityOrdinal("bench_echo", out uint generation);
+                if (ordinal < 0)
+                    return -1;
+
+                var utility = (delegate* unmanaged<IntPtr, int, int>)HostComm.GetNativeUtilityPointer(ordinal, generation);
+
+                start = Stopwatch.GetTimestamp();
+                for (long i = 0; i < iterations; i++)
+                    sink += utility((IntPtr)args, argBytes);
+            }
+
+            long elapsed = Stopwatch.GetTimestamp() - start;
+            GC.KeepAlive(sink);
+
+            return (long)(elapsed * (1_000_000_000.0 / Stopwatch.Frequency));
+        }
+
+        /// <summary>
+        /// Write the description of the runtime as a null-terminated UTF-8 string, to be put into the report.
+        /// </summary>
+        [UnmanagedCallersOnly]
+        public static void GetRuntimeDescription(byte* buffer, int size)
+        {
+            string description = $"{RuntimeInformation.FrameworkDescription} ({RuntimeInformation.ProcessArchitecture})";
+
+            int written = Encoding.UTF8.GetBytes(description, new Span<byte>(buffer, size - 1));
+            buffer[written] = 0;
+        }
+    }
+
+    /// <summary>
+    /// Awaited by the async mode of the native benchmark (host_async.h). Can't be in <see cref="Benchmarks"/>, since
+    /// async methods can't be in an unsafe context.
+    /// </summary>
+    public static class AsyncBenchmarks
+    {
+        // It always yields, so every call really completes asynchronously.
+        public static async Task<byte[]> AsyncEcho(byte[] args)
+        {
+            await Task.Yield();
+            return args;
+        }
+    }
+
+    /// <summary>
+    /// Streamed into by the mapped-file mode of the native benchmark (host_mapped_file.h).
+    /// </summary>
+    public static class MappedFileBenchmarks
+    {
+        /// <summary>
+        /// Sum all bytes of the file, reading every window in place.
+        /// </summary>
+        public static long Checksum(MappedFileReader file)
+        {
+            long sum = 0;
+            file.ForEachWindow((window, offset) =>
+            {
+                foreach (byte value in window)
+                    sum += value;
+            });
+
+            return sum;
+        }
+    }
+
+    /// <summary>
+    /// Delivered to by the native benchmark, which writes into buffers of a HostComm::BufferPool (host_buffer_pool.h).
+    /// </summary>
+    public static class BufferPoolBenchmarks
+    {
+        private static int _sink;
+
+        /// <summary>
+        /// Touch the first and the last byte of the buffer, like <see cref="Benchmarks.CopyEntrypoint"/> does, and return it.
+        /// </summary>
+        public static void Consume(PooledBuffer buffer)
+        {
+            Span<byte> bytes = buffer.Span;
+            Volatile.Write(ref _sink, bytes.IsEmpty ? 0 : bytes[0] + bytes[^1]);
+
+            buffer.Return();
+        }
+    }
+
+    /// <summary>
+    /// The same as ManagedApp.ColumnKernels.UnitCircleHits, for a single record, for the columns mode of the native
+    /// benchmark to compare calls per record with batches (host_columns.h).
+    /// </summary>
+    public static unsafe class ColumnBenchmarks
+    {
+        [UnmanagedCallersOnly]
+        public static int UnitCircleHit(float x, float y, float* length)
+        {
+            *length = MathF.Sqrt(x * x + y * y);
+            return *length <= 1 ? 1 : 0;
+        }
+    }
+}
@@ -0,0 +1,70 @@
+﻿using System.Runtime.InteropServices;
+using System.Runtime.Loader;
+using ManagedApp;
+
+namespace NetHostBench
+{
+    /// <summary>
+    /// Managed counterparts of the NetHostBench stress mode (--mode stress), which calls into the hosting layer from many
+    /// native threads at once.
+    /// </summary>
+    public static unsafe class Stress
+    {
+        /// <summary>
+        /// Load this assembly into the default load context too, so the native side can resolve <see cref="StressTargets"/>
+        /// with get_function_pointer, which only looks into the default context.
+        /// </summary>
+        /// <returns>1 on success, 0 otherwise.</returns>
+        [UnmanagedCallersOnly]
+        public static int LoadIntoDefaultContext()
+        {
+            try
+            {
+                AssemblyLoadContext.Default.LoadFromAssemblyPath(typeof(Stress).Assembly.Location);
+                return 1;
+            }
+            catch (Exception)
+            {
+                return 0;
+            }
+        }
+
+        /// <summary>
+        /// Look the `bench_echo` native utility up by its name and call it, over and over.
+        /// </summary>
+        /// <returns>How many lookups or calls have failed.</returns>
+        [UnmanagedCallersOnly]
+        public static long LookUpNativeUtilities(long iterations)
+        {
+            long failures = 0;
+            byte arg = 7;
+
+            for (long i = 0; i < iterations; i++)
+            {
+                BenchCallback utility = HostComm.GetNativeUtility<BenchCallback>("bench_echo");
+                if (utility == null || utility((IntPtr)(&arg), 1) != arg * 2)
+                    failures++;
+            }
+
+            return failures;
+        }
+    }
+
+    /// <summary>
+    /// Resolved by the native stress test from the default load context, so it must not depend on ManagedApp.
+    /// </summary>
+    public static class StressTargets
+    {
+        [UnmanagedCallersOnly]
+        public static int Add1(int value) => value + 1;
+
+        [UnmanagedCallersOnly]
+        public static int Add2(int value) => value + 2;
+
+        [UnmanagedCallersOnly]
+        public static int Add3(int value) => value + 3;
+
+        [UnmanagedCallersOnly]
+        public static int Add4(int value) => value + 4;
+    }
+}
@@ -0,0 +1,889 @@
+// NetHostBench: measures what the different ways of calling across the native/managed boundary cost.
+//
+// Native to managed: the default signature (no delegate type name), with the arguments packed by NetHost::ArgPack
+// (arg_pack.h), an explicit delegate type name,
+// UNMANAGED_CALLERS_ONLY, and batched calls (host_batch.h). Data produced on the native side gets to the managed side
+// either copied into a new managed array, or written into a pinned managed buffer of a HostComm::BufferPool
+// (host_buffer_pool.h) and delivered in place. Managed to native: a native utility called through a delegate
+// from HostComm.GetNativeUtility<T>(), and through a raw function pointer from the handed off utility table.
+// Every style is measured for 1..N threads and different argument sizes, and the results are written as JSON.
+//
+// The stress mode (--mode stress) instead checks the hosting layer holds up under concurrent use: a HostComm::WorkerPool
+// of --max-threads threads resolves managed methods (rd_GetFuncPointer, rd_LoadAssemblyAndGetFuncPointer) and looks the
+// native utilities up from both sides, while another thread keeps registering and unregistering utilities. It exits
+// with 1 if any lookup or call has returned something wrong.
+//
+// The async mode (--mode async) awaits a managed async method from coroutines (host_async.h): --in-flight coroutines
+// are resumed on a HostComm::WorkerPool of --max-threads threads, and make --iterations calls in total.
+//
+// The mapped-file mode (--mode mapped-file) streams --file into a managed handler reading it in place, window by window
+// (host_mapped_file.h), and reports the throughput.
+//
+// The columns mode (--mode columns) compares calling a managed method once per record with running a vectorized managed
+// kernel on batches of --batch-sizes records passed as columns (host_columns.h), and reports the ns per record.
+//
+// The reload mode (--mode reload) loads the benchmark assembly as a HostComm::ReloadableAssembly (host_reload.h), and
+// reloads it --reloads times while --max-threads threads keep calling into it (directly, and through a batch entrypoint
+// the reloads rebind), reporting how long the reloads and the slowest calls took.
+//
+// Usage: NetHostBench [--mode bench|stress|async|mapped-file|columns|reload] [--in-flight N] [--file path] [--batch-sizes 1,16,256] [--reloads N] [--utility-stats on|off] [--iterations N] [--max-threads N] [--arg-sizes 0,64,1024] [--output results.json]
+
+#include "net_hosting.h"
+#include "host_comm.h"
+#include "host_batch.h"
+#include "host_worker_pool.h"
+#include "host_async.h"
+#include "arg_pack.h"
+#include "host_mapped_file.h"
+#include "host_reload.h"
+#include "host_buffer_pool.h"
+#include "host_columns.h"
+#include "native_utility.h"
+
+#include <latch>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <vector>
+#include <random>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <functional>
+#include <filesystem>
+#include <cstring>
+#include <algorithm>
+
+#if _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <unistd.h>
+#include <limits.h>
+#endif
+
+using std::filesystem::path;
+
+namespace
+{
+	struct Options
+	{
+		uint64_t iterations = 1'000'000; // Per thread.
+		int maxThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+		std::vector<int> argSizes{ 0, 64, 1024, 16384 };
+		std::string outputPath;
+		std::string mode = "bench";
+		int inFlight = 1000; // Only for the async mode.
+		std::string filePath; // Only for the mapped-file mode.
+		std::vector<int> batchSizes{ 1, 16, 256, 4096, 65536 }; // Only for the columns mode.
+		int reloads = 20; // Only for the reload mode.
+		bool isUtilityStatsEnabled = false; // Count the calls into bench_echo (see host_utility_stats.h).
+	};
+
+	struct BenchResult
+	{
+		std::string style;
+		std::string direction;
+		int threads;
+		int argBytes;
+		uint64_t calls;
+		double nsPerCall;
+		double callsPerSecond;
+	};
+
+	// Runs `iterations` calls on the current thread, with an argument buffer of the measured size.
+	typedef std::function<void(std::byte* args, int argBytes, uint64_t iterations)> CallLoop;
+
+	const char_t* const BENCH_TYPE = NH_STR("NetHostBench.Benchmarks, NetHostBench.Managed");
+	const char_t* const ASYNC_BENCH_TYPE = NH_STR("NetHostBench.AsyncBenchmarks, NetHostBench.Managed");
+	const char_t* const BUFFER_POOL_BENCH_TYPE = NH_STR("NetHostBench.BufferPoolBenchmarks, NetHostBench.Managed");
+	const char_t* const COLUMN_BENCH_TYPE = NH_STR("NetHostBench.ColumnBenchmarks, NetHostBench.Managed");
+	const char_t* const COLUMN_KERNELS_TYPE = NH_STR("ManagedApp.ColumnKernels, ManagedApp");
+	const char_t* const MAPPED_FILE_BENCH_TYPE = NH_STR("NetHostBench.MappedFileBenchmarks, NetHostBench.Managed");
+	const char_t* const STRESS_TYPE = NH_STR("NetHostBench.Stress, NetHostBench.Managed");
+	const char_t* const STRESS_TARGETS_TYPE = NH_STR("NetHostBench.StressTargets, NetHostBench.Managed");
+}
+
+static int DELEGATE_CALLTYPE BenchEcho(void* args, int sizeBytes)
+{
+	if (sizeBytes == 0)
+		return 0;
+
+	auto bytes = (const unsigned char*)args;
+	return bytes[0] + bytes[sizeBytes - 1];
+}
+
+static path GetExecutablePath()
+{
+#ifdef _WIN32
+	TCHAR buffer[MAX_PATH]{};
+	path exePath = std::basic_string<TCHAR>(buffer, GetModuleFileName(NULL, buffer, MAX_PATH));
+#else
+	char buffer[PATH_MAX];
+	memset(buffer, 0, sizeof(buffer)); // readlink does not null terminate!
+
+	int chRead = readlink("/proc/self/exe", buffer, PATH_MAX);
+	path exePath = std::string(buffer, chRead);
+#endif
+
+	return exePath.parent_path();
+}
+
+static double RunThreads(int threads, int argBytes, uint64_t iterations, const CallLoop& loop)
+{
+	typedef std::chrono::steady_clock::time_point TimePoint;
+
+	std::latch ready{ threads };
+	std::vector<std::thread> workers;
+	std::vector<TimePoint> starts(threads);
+	std::vector<TimePoint> ends(threads);
+
+	for (int i = 0; i < threads; i++)
+	{
+		workers.emplace_back([&, i]()
+		{
+			std::vector<std::byte> args(std::max(argBytes, 1), std::byte{ 1 });
+
+			// Let every thread pay for its first transition before the measurement starts.
+			loop(args.data(), argBytes, 1);
+
+			ready.arrive_and_wait();
+			starts[i] = std::chrono::steady_clock::now();
+			loop(args.data(), argBytes, iterations);
+			ends[i] = std::chrono::steady_clock::now();
+		});
+	}
+
+	for (std::thread& worker : workers)
+		worker.join();
+
+	// From the first thread starting to the last one finishing.
+	TimePoint start = *std::min_element(starts.begin(), starts.end());
+	TimePoint end = *std::max_element(ends.begin(), ends.end());
+	return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+static void Measure(const Options& options, std::vector<BenchResult>& results, const char* style, const char* direction, const CallLoop& loop)
+{
+	for (int argBytes : options.argSizes)
+	{
+		// Warm up (JIT, tiering) on a single thread before measuring anything.
+		RunThreads(1, argBytes, std::max<uint64_t>(options.iterations / 10, 1), loop);
+
+		for (int threads = 1; threads <= options.maxThreads; threads *= 2)
+		{
+			double elapsedNs = RunThreads(threads, argBytes, options.iterations, loop);
+			uint64_t calls = options.iterations * threads;
+
+			double nsPerCall = elapsedNs * threads / calls; // Per call on a single thread.
+			double callsPerSecond = calls / (elapsedNs / 1e9);
+
+			BenchResult result{ style, direction, threads, argBytes, calls, nsPerCall, callsPerSecond };
+			results.push_back(result);
+
+			std::cerr << style << " (" << direction << "), threads: " << threads << ", arg bytes: " << argBytes
+				<< " -> " << result.nsPerCall << " ns/call, " << (uint64_t)result.callsPerSecond << " calls/s\n";
+		}
+	}
+}
+
+static std::string EscapeJson(const std::string& text)
+{
+	std::string escaped;
+	for (char ch : text)
+	{
+		if (ch == '"' || ch == '\\')
+			escaped += '\\';
+
+		escaped += ch;
+	}
+
+	return escaped;
+}
+
+static std::string ToJson(const std::string& runtime, const std::vector<BenchResult>& results, const Options& options)
+{
+	std::ostringstream out;
+	out << "{\n";
+	out << "  \"runtime\": \"" << EscapeJson(runtime) << "\",\n";
+	out << "  \"iterationsPerThread\": " << options.iterations << ",\n";
+	out << "  \"results\": [\n";
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult& result = results[i];
+		out << "    { \"style\": \"" << result.style << "\", \"direction\": \"" << result.direction << "\", \"threads\": " << result.threads
+			<< ", \"argBytes\": " << result.argBytes << ", \"calls\": " << result.calls << ", \"nsPerCall\": " << result.nsPerCall
+			<< ", \"callsPerSecond\": " << result.callsPerSecond << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+
+	out << "  ]\n}\n";
+	return out.str();
+}
+
+static void WriteOutput(const Options& options, const std::string& json)
+{
+	if (options.outputPath.empty())
+	{
+		std::cout << json;
+	}
+	else
+	{
+		std::ofstream output{ options.outputPath, std::ios::trunc };
+		output << json;
+	}
+}
+
+static int RunStress(const Options& options, const NetHost::HostContext& context, const char_t* assembly)
+{
+	auto loadAndGetFuncPointer = context.GetLoadAssemblyAndGetFuncPointer();
+	auto getFuncPointer = context.GetGetFuncPointer();
+
+	auto loadIntoDefaultContext = loadAndGetFuncPointer.GetFunction<int32_t()>(assembly, STRESS_TYPE, NH_STR("LoadIntoDefaultContext"), NetHost::UNMANAGED_CALLERS_ONLY);
+	auto lookUpNativeUtilities = loadAndGetFuncPointer.GetFunction<int64_t(int64_t)>(assembly, STRESS_TYPE, NH_STR("LookUpNativeUtilities"), NetHost::UNMANAGED_CALLERS_ONLY);
+
+	if (loadIntoDefaultContext() == 0)
+	{
+		std::cerr << "Failed to load the benchmark assembly into the default load context.\n";
+		return -1;
+	}
+
+	const char_t* const targets[] = { NH_STR("Add1"), NH_STR("Add2"), NH_STR("Add3"), NH_STR("Add4") };
+	void* const benchEcho = (void*)&BenchEcho;
+
+	std::atomic<uint64_t> failures{ 0 };
+	std::atomic<bool> isDone{ false };
+
+	// Keeps replacing the utility registry under the readers.
+	std::thread registryChurn([&]()
+	{
+		for (uint64_t i = 0; !isDone.load(std::memory_order_relaxed); i++)
+		{
+			std::string name = "stress_utility_" + std::to_string(i % 8);
+			if (HostComm::GetNativeUtility(name) == nullptr)
+				HostComm::RegisterNativeUtility(name.c_str(), benchEcho);
+			else
+				HostComm::UnregisterNativeUtility(name.c_str());
+		}
+	});
+
+	auto start = std::chrono::steady_clock::now();
+	{
+		HostComm::WorkerPool pool{ (size_t)options.maxThreads };
+		std::latch go{ options.maxThreads };
+		std::vector<std::future<void>> workers;
+
+		for (int worker = 0; worker < options.maxThreads; worker++)
+		{
+			workers.push_back(pool.Submit([&]()
+			{
+				// All the threads start at once, so they race for the same cold resolutions.
+				go.arrive_and_wait();
+
+				uint64_t localFailures = 0;
+				for (uint64_t i = 0; i < options.iterations; i++)
+				{
+					int target = (int)(i % 4);
+					auto add = getFuncPointer.GetFunction<int(int)>(STRESS_TARGETS_TYPE, targets[target], NetHost::UNMANAGED_CALLERS_ONLY);
+					if (!add.HasValue() || add((int)i) != (int)i + target + 1)
+						localFailures++;
+
+					if (HostComm::GetNativeUtility("bench_echo") != benchEcho)
+						localFailures++;
+
+					if (i % 16 == 0 && loadAndGetFuncPointer(assembly, BENCH_TYPE, NH_STR("UnmanagedEntrypoint"), NetHost::UNMANAGED_CALLERS_ONLY) == nullptr)
+						localFailures++;
+
+					if (i % 64 == 0)
+						localFailures += (uint64_t)lookUpNativeUtilities(4);
+				}
+
+				failures.fetch_add(localFailures, std::memory_order_relaxed);
+			}));
+		}
+
+		for (std::future<void>& worker : workers)
+			worker.get();
+	}
+	double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	isDone = true;
+	registryChurn.join();
+
+	std::ostringstream out;
+	out << "{\n";
+	out << "  \"mode\": \"stress\",\n";
+	out << "  \"threads\": " << options.maxThreads << ",\n";
+	out << "  \"iterationsPerThread\": " << options.iterations << ",\n";
+	out << "  \"elapsedMs\": " << elapsedMs << ",\n";
+	out << "  \"failures\": " << failures.load() << "\n";
+	out << "}\n";
+	WriteOutput(options, out.str());
+
+	std::cerr << "Stress: " << options.maxThreads << " threads, " << options.iterations << " iterations each, "
+		<< failures.load() << " failures, " << elapsedMs << " ms\n";
+
+	return failures.load() == 0 ? 0 : 1;
+}
+
+static HostComm::DetachedTask RunAsyncCalls(int32_t entrypointId, uint64_t calls, HostComm::AsyncExecutor executor, std::atomic<uint64_t>& failures, std::latch& done)
+{
+	for (uint64_t i = 0; i < calls; i++)
+	{
+		uint32_t value = (uint32_t)i;
+		std::vector<std::byte> result = co_await HostComm::CallAsync(entrypointId, &value, sizeof(value), executor);
+
+		if (result.size() != sizeof(value) || memcmp(result.data(), &value, sizeof(value)) != 0)
+			failures.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	done.count_down();
+}
+
+static int RunAsync(const Options& options)
+{
+	int32_t entrypointId = HostComm::RegisterAsyncEntrypoint(ASYNC_BENCH_TYPE, NH_STR("AsyncEcho"));
+
+	std::atomic<uint64_t> failures{ 0 };
+	uint64_t callsPerCoroutine = std::max<uint64_t>(options.iterations / options.inFlight, 1);
+	uint64_t calls = callsPerCoroutine * options.inFlight;
+
+	HostComm::WorkerPool pool{ (size_t)options.maxThreads };
+	HostComm::AsyncExecutor executor = HostComm::ExecutorOf(pool);
+
+	std::latch done{ options.inFlight };
+	auto start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < options.inFlight; i++)
+		RunAsyncCalls(entrypointId, callsPerCoroutine, executor, failures, done);
+
+	done.wait();
+	double elapsedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+	std::ostringstream out;
+	out << "{\n";
+	out << "  \"mode\": \"async\",\n";
+	out << "  \"threads\": " << options.maxThreads << ",\n";
+	out << "  \"inFlight\": " << options.inFlight << ",\n";
+	out << "  \"calls\": " << calls << ",\n";
+	out << "  \"nsPerCall\": " << elapsedNs / calls << ",\n";
+	out << "  \"callsPerSecond\": " << calls / (elapsedNs / 1e9) << ",\n";
+	out << "  \"failures\": " << failures.load() << "\n";
+	out << "}\n";
+	WriteOutput(options, out.str());
+
+	std::cerr << "Async: " << options.inFlight << " in flight on " << options.maxThreads << " threads, " << calls << " calls, "
+		<< (uint64_t)(calls / (elapsedNs / 1e9)) << " calls/s, " << failures.load() << " failures\n";
+
+	return failures.load() == 0 ? 0 : 1;
+}
+
+static int RunMappedFile(const Options& options)
+{
+	if (options.filePath.empty())
+	{
+		std::cerr << "The mapped-file mode needs a --file to stream.\n";
+		return -1;
+	}
+
+	std::error_code error;
+	uint64_t fileSize = std::filesystem::file_size(options.filePath, error);
+	if (error)
+	{
+		std::cerr << "Failed to get the size of " << options.filePath << ": " << error.message() << "\n";
+		return -1;
+	}
+
+	int32_t handlerId = HostComm::RegisterFileHandler(MAPPED_FILE_BENCH_TYPE, NH_STR("Checksum"));
+
+	// Once cold (as it comes), then warm from the page cache.
+	std::ostringstream runs;
+	for (int run = 0; run < 2; run++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		int64_t checksum;
+		try
+		{
+			checksum = HostComm::StreamFile(handlerId, options.filePath);
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "Failed to stream " << options.filePath << ": " << e.what() << "\n";
+			return -1;
+		}
+
+		double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		double bytesPerSecond = fileSize / elapsedSeconds;
+		runs << (run == 0 ? "" : ",\n") << "    { \"seconds\": " << elapsedSeconds << ", \"bytesPerSecond\": " << bytesPerSecond << ", \"checksum\": " << checksum << " }";
+
+		std::cerr << "Mapped file (" << (run == 0 ? "first" : "second") << " run): " << fileSize << " bytes in " << elapsedSeconds << " s, "
+			<< bytesPerSecond / (1024 * 1024) << " MiB/s, checksum " << checksum << "\n";
+	}
+
+	std::ostringstream out;
+	out << "{\n";
+	out << "  \"mode\": \"mapped-file\",\n";
+	out << "  \"fileBytes\": " << fileSize << ",\n";
+	out << "  \"runs\": [\n" << runs.str() << "\n  ]\n";
+	out << "}\n";
+	WriteOutput(options, out.str());
+
+	return 0;
+}
+
+static int RunColumns(const Options& options, const NetHost::HostContext& context, const char_t* assembly)
+{
+	auto unitCircleHit = context.GetLoadAssemblyAndGetFuncPointer().GetFunction<int32_t(float, float, float*)>(assembly, COLUMN_BENCH_TYPE,
+		NH_STR("UnitCircleHit"), NetHost::UNMANAGED_CALLERS_ONLY);
+	int32_t kernelId = HostComm::RegisterColumnKernel(COLUMN_KERNELS_TYPE, NH_STR("UnitCircleHits"));
+
+	size_t records = (size_t)*std::max_element(options.batchSizes.begin(), options.batchSizes.end());
+	std::vector<float> xs(records);
+	std::vector<float> ys(records);
+	std::vector<float> lengths(records);
+
+	std::mt19937 random{ 42 };
+	std::uniform_real_distribution<float> coordinates{ -1.5f, 1.5f };
+	for (size_t i = 0; i < records; i++)
+	{
+		xs[i] = coordinates(random);
+		ys[i] = coordinates(random);
+	}
+
+	// Both styles must count the same hits.
+	int64_t perRecordHits = 0;
+	for (size_t i = 0; i < records; i++)
+		perRecordHits += unitCircleHit(xs[i], ys[i], &lengths[i]);
+
+	int64_t batchHits = HostComm::RunColumnKernel(kernelId, records, (const float*)xs.data(), (const float*)ys.data(), lengths.data());
+	if (batchHits != perRecordHits)
+	{
+		std::cerr << "The batched kernel has counted " << batchHits << " hits, and the calls per record " << perRecordHits << ".\n";
+		return 1;
+	}
+
+	auto measureNsPerRecord = [&](size_t batchSize, const std::function<void(size_t offset, size_t count)>& run)
+	{
+		uint64_t measured = 0;
+		auto start = std::chrono::steady_clock::now();
+		while (measured < options.iterations)
+		{
+			for (size_t offset = 0; offset + batchSize <= records && measured < options.iterations; offset += batchSize)
+			{
+				run(offset, batchSize);
+				measured += batchSize;
+			}
+		}
+
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (double)measured;
+	};
+
+	volatile int64_t sink = 0;
+
+	// Warm up both styles for long enough for the tiered JIT to have recompiled everything they call optimized (which takes
+	// a few rounds with dynamic PGO), or the first measurements would be of the unoptimized code.
+	auto warmUpEnd = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+	while (std::chrono::steady_clock::now() < warmUpEnd)
+	{
+		for (size_t i = 0; i < records; i++)
+			sink = sink + unitCircleHit(xs[i], ys[i], &lengths[i]);
+
+		for (size_t offset = 0; offset < records; offset++)
+			sink = sink + HostComm::RunColumnKernel(kernelId, std::min<size_t>(records - offset, 16), (const float*)&xs[offset], (const float*)&ys[offset], &lengths[offset]);
+	}
+
+	double perRecordNs = measureNsPerRecord(1, [&](size_t offset, size_t)
+	{
+		sink = sink + unitCircleHit(xs[offset], ys[offset], &lengths[offset]);
+	});
+
+	std::cerr << "Columns, a call per record: " << perRecordNs << " ns/record\n";
+
+	std::ostringstream runs;
+	for (size_t i = 0; i < options.batchSizes.size(); i++)
+	{
+		size_t batchSize = (size_t)options.batchSizes[i];
+		double batchNs = measureNsPerRecord(batchSize, [&](size_t offset, size_t count)
+		{
+			sink = sink + HostComm::RunColumnKernel(kernelId, count, (const float*)&xs[offset], (const float*)&ys[offset], &lengths[offset]);
+		});
+
+		runs << (i == 0 ? "" : ",\n") << "    { \"batchSize\": " << batchSize << ", \"nsPerRecord\": " << batchNs << ", \"speedup\": " << perRecordNs / batchNs << " }";
+		std::cerr << "Columns, batches of " << batchSize << ": " << batchNs << " ns/record (" << perRecordNs / batchNs << "x)\n";
+	}
+
+	std::ostringstream out;
+	out << "{\n";
+	out << "  \"mode\": \"columns\",\n";
+	out << "  \"records\": " << options.iterations << ",\n";
+	out << "  \"perRecordNsPerRecord\": " << perRecordNs << ",\n";
+	out << "  \"batches\": [\n" << runs.str() << "\n  ]\n";
+	out << "}\n";
+	WriteOutput(options, out.str());
+
+	return 0;
+}
+
+static int RunReload(const Options& options, const path& assemblyPath)
+{
+	HostComm::ReloadableAssembly assembly{ assemblyPath };
+
+	// Every version has its own copy of HostComm, which looks the native utilities up too.
+	auto add1 = assembly.GetFunction<int(int)>(NH_STR("NetHostBench.StressTargets"), NH_STR("Add1"));
+	auto lookUpNativeUtilities = assembly.GetFunction<int64_t(int64_t)>(NH_STR("NetHostBench.Stress"), NH_STR("LookUpNativeUtilities"));
+
+	// Registered from the current version, and rebound to the new one on every reload.
+	int32_t batchEntrypoint = HostComm::RegisterBatchEntrypoint(BENCH_TYPE, NH_STR("DefaultEntrypoint"));
+
+	std::atomic<uint64_t> failures{ 0 };
+	std::atomic<uint64_t> calls{ 0 };
+	std::atomic<uint64_t> maxCallNs{ 0 };
+	std::atomic<bool> isDone{ false };
+
+	std::vector<std::thread> callers;
+	for (int i = 0; i < options.maxThreads; i++)
+	{
+		callers.emplace_back([&]()
+		{
+			HostComm::CallBatch& batch = HostComm::CallBatch::ForCurrentThread();
+
+			uint64_t localMaxNs = 0;
+			for (int value = 0; !isDone.load(std::memory_order_relaxed); value++)
+			{
+				// The entrypoint adds up the first and the last byte.
+				const uint8_t args[2]{ (uint8_t)value, 1 };
+
+				auto start = std::chrono::steady_clock::now();
+				batch.Append(batchEntrypoint, args, sizeof(args));
+				if (add1(value) != value + 1 || lookUpNativeUtilities(1) != 0 || batch.Flush()[0] != args[0] + 1)
+					failures.fetch_add(1, std::memory_order_relaxed);
+
+				localMaxNs = std::max(localMaxNs, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+				calls.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			uint64_t seenMaxNs = maxCallNs.load();
+			while (seenMaxNs < localMaxNs && !maxCallNs.compare_exchange_weak(seenMaxNs, localMaxNs)) {}
+		});
+	}
+
+	double totalLoadMs = 0, totalDrainMs = 0, totalUnloadMs = 0, maxReloadMs = 0;
+	int failedReloads = 0, uncollected = 0;
+
+	for (int i = 0; i < options.reloads; i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+		if (!assembly.Reload())
+		{
+			failedReloads++;
+			continue;
+		}
+
+		HostComm::ReloadStats stats = assembly.GetStats();
+		totalLoadMs += stats.lastLoadNs / 1e6;
+		totalDrainMs += stats.lastDrainNs / 1e6;
+		totalUnloadMs += stats.lastUnloadNs / 1e6;
+		maxReloadMs = std::max(maxReloadMs, (stats.lastLoadNs + stats.lastDrainNs + stats.lastUnloadNs) / 1e6);
+		uncollected += stats.isLastUnloadCollected ? 0 : 1;
+	}
+
+	isDone = true;
+	for (std::thread& caller : callers)
+		caller.join();
+
+	int reloads = std::max(options.reloads - failedReloads, 1);
+
+	std::ostringstream out;
+	out << "{\n";
+	out << "  \"mode\": \"reload\",\n";
+	out << "  \"reloads\": " << options.reloads - failedReloads << ",\n";
+	out << "  \"failedReloads\": " << failedReloads << ",\n";
+	out << "  \"uncollectedVersions\": " << uncollected << ",\n";
+	out << "  \"averageLoadMs\": " << totalLoadMs / reloads << ",\n";
+	out << "  \"averageDrainMs\": " << totalDrainMs / reloads << ",\n";
+	out << "  \"averageUnloadMs\": " << totalUnloadMs / reloads << ",\n";
+	out << "  \"maxReloadMs\": " << maxReloadMs << ",\n";
+	out << "  \"calls\": " << calls.load() << ",\n";
+	out << "  \"maxCallMs\": " << maxCallNs.load() / 1e6 << ",\n";
+	out << "  \"failures\": " << failures.load() << "\n";
+	out << "}\n";
+	WriteOutput(options, out.str());
+
+	std::cerr << "Reload: " << options.reloads - failedReloads << " reloads (load " << totalLoadMs / reloads << " ms, drain " << totalDrainMs / reloads
+		<< " ms, unload " << totalUnloadMs / reloads << " ms on average), " << calls.load() << " calls, the slowest " << maxCallNs.load() / 1e6
+		<< " ms, " << failures.load() << " failures\n";
+
+	return failures.load() == 0 && failedReloads == 0 ? 0 : 1;
+}
+
+static bool ParseOptions(int argc, char** argv, Options& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (i + 1 >= argc)
+		{
+			std::cerr << "Missing value for " << arg << "\n";
+			return false;
+		}
+
+		std::string value = argv[++i];
+		if (arg == "--iterations")
+		{
+			options.iterations = std::stoull(value);
+		}
+		else if (arg == "--max-threads")
+		{
+			options.maxThreads = std::max(1, std::stoi(value));
+		}
+		else if (arg == "--arg-sizes")
+		{
+			options.argSizes.clear();
+
+			std::istringstream sizes{ value };
+			for (std::string size; std::getline(sizes, size, ',');)
+				options.argSizes.push_back(std::stoi(size));
+		}
+		else if (arg == "--mode")
+		{
+			if (value != "bench" && value != "stress" && value != "async" && value != "mapped-file" && value != "columns" && value != "reload")
+			{
+				std::cerr << "Unknown mode: " << value << "\n";
+				return false;
+			}
+
+			options.mode = value;
+		}
+		else if (arg == "--in-flight")
+		{
+			options.inFlight = std::max(1, std::stoi(value));
+		}
+		else if (arg == "--file")
+		{
+			options.filePath = value;
+		}
+		else if (arg == "--batch-sizes")
+		{
+			options.batchSizes.clear();
+
+			std::istringstream sizes{ value };
+			for (std::string size; std::getline(sizes, size, ',');)
+				options.batchSizes.push_back(std::max(1, std::stoi(size)));
+		}
+		else if (arg == "--reloads")
+		{
+			options.reloads = std::max(1, std::stoi(value));
+		}
+		else if (arg == "--utility-stats")
+		{
+			options.isUtilityStatsEnabled = value == "on";
+		}
+		else if (arg == "--output")
+		{
+			options.outputPath = value;
+		}
+		else
+		{
+			std::cerr << "Unknown option: " << arg << "\n";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		std::cerr << "Usage: NetHostBench [--mode bench|stress|async|mapped-file|columns|reload] [--in-flight N] [--file path] [--batch-sizes 1,16,256] [--reloads N] [--utility-stats on|off] [--iterations N] [--max-threads N] [--arg-sizes 0,64,1024] [--output results.json]\n";
+		return -1;
+	}
+
+	path executableDir = GetExecutablePath();
+	path pathToRuntimeConfig = executableDir / "ManagedApp.runtimeconfig.json";
+	path benchAssemblyPath = executableDir / "NetHostBench.Managed.dll";
+
+	if (!NetHost::Init())
+	{
+		std::cerr << "Failed to initialize .NET host.\n";
+		return -1;
+	}
+
+	NetHost::HostContext context = NetHost::NewContextForRuntimeConfig(pathToRuntimeConfig.c_str());
+
+	// HostComm is initialized from the benchmark assembly, so its managed side lives in the same load context as the benchmarks.
+	if (options.isUtilityStatsEnabled)
+		HostComm::EnableUtilityStats();
+
+	HostComm::RegisterNativeUtility<"bench_echo", int(void*, int)>(&BenchEcho);
+	HostComm::Init(context, benchAssemblyPath.c_str(), NH_STR("ManagedApp"), true);
+
+	auto loadAndGetFuncPointer = context.GetLoadAssemblyAndGetFuncPointer();
+	const char_t* assembly = benchAssemblyPath.c_str();
+
+	if (options.mode == "stress")
+	{
+		int exitCode = RunStress(options, context, assembly);
+
+		context.Close();
+		NetHost::Shutdown();
+		return exitCode;
+	}
+
+	if (options.mode == "columns")
+	{
+		int exitCode = RunColumns(options, context, assembly);
+
+		context.Close();
+		NetHost::Shutdown();
+		return exitCode;
+	}
+
+	if (options.mode == "reload")
+	{
+		int exitCode = RunReload(options, benchAssemblyPath);
+
+		context.Close();
+		NetHost::Shutdown();
+		return exitCode;
+	}
+
+	if (options.mode == "async" || options.mode == "mapped-file")
+	{
+		int exitCode = options.mode == "async" ? RunAsync(options) : RunMappedFile(options);
+
+		context.Close();
+		NetHost::Shutdown();
+		return exitCode;
+	}
+
+	auto defaultEntrypoint = loadAndGetFuncPointer.GetFunction<int(void*, int)>(assembly, BENCH_TYPE, NH_STR("DefaultEntrypoint"));
+	auto argPackEntrypoint = loadAndGetFuncPointer.GetFunction<int(void*, int)>(assembly, BENCH_TYPE, NH_STR("ArgPackEntrypoint"));
+	auto delegateEntrypoint = loadAndGetFuncPointer.GetFunction<int(void*, int)>(assembly, BENCH_TYPE, NH_STR("DelegateEntrypoint"), NH_STR("NetHostBench.BenchCallback, NetHostBench.Managed"));
+	auto unmanagedEntrypoint = loadAndGetFuncPointer.GetFunction<int(void*, int)>(assembly, BENCH_TYPE, NH_STR("UnmanagedEntrypoint"), NetHost::UNMANAGED_CALLERS_ONLY);
+	auto copyEntrypoint = loadAndGetFuncPointer.GetFunction<int(void*, int)>(assembly, BENCH_TYPE, NH_STR("CopyEntrypoint"), NetHost::UNMANAGED_CALLERS_ONLY);
+	auto runNativeCalls = loadAndGetFuncPointer.GetFunction<int64_t(int32_t, int64_t, int32_t)>(assembly, BENCH_TYPE, NH_STR("RunNativeCalls"), NetHost::UNMANAGED_CALLERS_ONLY);
+	auto getRuntimeDescription = loadAndGetFuncPointer.GetFunction<void(char*, int32_t)>(assembly, BENCH_TYPE, NH_STR("GetRuntimeDescription"), NetHost::UNMANAGED_CALLERS_ONLY);
+	int32_t batchEntrypoint = HostComm::RegisterBatchEntrypoint(BENCH_TYPE, NH_STR("DefaultEntrypoint"));
+
+	char runtime[256]{};
+	getRuntimeDescription(runtime, sizeof(runtime));
+
+	std::vector<BenchResult> results;
+
+	auto callInLoop = [](NetHost::ManagedFunction<int(void*, int)> function)
+	{
+		return [function](std::byte* args, int argBytes, uint64_t iterations)
+		{
+			volatile int sink = 0;
+			for (uint64_t i = 0; i < iterations; i++)
+				sink = sink + function(args, argBytes);
+		};
+	};
+
+	Measure(options, results, "default_signature", "native_to_managed", callInLoop(defaultEntrypoint));
+	Measure(options, results, "default_signature_arg_pack", "native_to_managed", [argPackEntrypoint](std::byte* args, int argBytes, uint64_t iterations)
+	{
+		volatile int sink = 0;
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			NetHost::ArgPack pack;
+			pack.Add<int32_t>(1).AddSpan(std::span<const std::byte>{ args, (size_t)argBytes });
+			sink = sink + pack.Call(argPackEntrypoint);
+		}
+	});
+
+	Measure(options, results, "delegate_type_name", "native_to_managed", callInLoop(delegateEntrypoint));
+	Measure(options, results, "unmanaged_callers_only", "native_to_managed", callInLoop(unmanagedEntrypoint));
+
+	Measure(options, results, "batched", "native_to_managed", [batchEntrypoint](std::byte* args, int argBytes, uint64_t iterations)
+	{
+		HostComm::CallBatch& batch = HostComm::CallBatch::ForCurrentThread();
+		for (uint64_t i = 0; i < iterations; i++)
+			batch.Append(batchEntrypoint, args, argBytes);
+
+		batch.Flush();
+	});
+
+	// The producer writes the data on the native side either way, into its own memory or right into the managed buffer.
+	Measure(options, results, "managed_array_copy", "native_to_managed", [copyEntrypoint](std::byte* args, int argBytes, uint64_t iterations)
+	{
+		volatile int sink = 0;
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			memset(args, (int)i, argBytes);
+			sink = sink + copyEntrypoint(args, argBytes);
+		}
+	});
+
+	{
+		// A buffer per thread is enough, since the handler returns it before Deliver() does.
+		std::vector<HostComm::BufferSizeClass> sizeClasses;
+		for (int argBytes : options.argSizes)
+			sizeClasses.push_back({ (size_t)std::max(argBytes, 1), (uint32_t)options.maxThreads });
+
+		HostComm::BufferPool pool{ sizeClasses };
+		int32_t consumer = HostComm::RegisterBufferHandler(BUFFER_POOL_BENCH_TYPE, NH_STR("Consume"));
+
+		Measure(options, results, "buffer_pool", "native_to_managed", [&pool, consumer](std::byte*, int argBytes, uint64_t iterations)
+		{
+			for (uint64_t i = 0; i < iterations; i++)
+			{
+				HostComm::PooledBuffer buffer = pool.Rent(argBytes);
+				memset(buffer.data.data(), (int)i, argBytes);
+				pool.Deliver(consumer, buffer, argBytes);
+			}
+		});
+
+		for (const HostComm::BufferClassStats& stats : pool.GetStats().classes)
+		{
+			std::cerr << "Buffer pool class of " << stats.bufferSize << " bytes: " << stats.rents << " rents, " << stats.returns << " returns, "
+				<< stats.failedRents << " failed, " << stats.peakInUse << "/" << stats.buffers << " in use at most\n";
+		}
+	}
+
+	// RunNativeCalls returns -1 without calling anything if it can't get the utility, which mustn't pass for a fast call.
+	int exitCode = 0;
+	auto measureNativeCalls = [&](const char* style, int32_t lookup)
+	{
+		std::atomic<bool> isFailing{ runNativeCalls(lookup, 1, 0) < 0 };
+		if (!isFailing)
+		{
+			Measure(options, results, style, "managed_to_native", [runNativeCalls, lookup, &isFailing](std::byte*, int argBytes, uint64_t iterations)
+			{
+				if (runNativeCalls(lookup, (int64_t)iterations, argBytes) < 0)
+					isFailing.store(true, std::memory_order_relaxed);
+			});
+		}
+
+		if (isFailing)
+		{
+			std::erase_if(results, [style](const BenchResult& result) { return result.style == style; });
+			std::cerr << style << " (managed_to_native) failed: the managed side couldn't get the bench_echo utility\n";
+			exitCode = -1;
+		}
+	};
+
+	measureNativeCalls("native_utility_delegate", 0);
+	measureNativeCalls("native_utility_function_pointer", 1);
+
+	WriteOutput(options, ToJson(runtime, results, options));
+
+	for (const HostComm::UtilityStats& stats : HostComm::GetUtilityStats().utilities)
+	{
+		if (stats.calls != 0)
+		{
+			std::cerr << "Utility " << stats.name << ": " << stats.calls << " calls, " << (double)stats.totalNs / (double)stats.calls << " ns/call, p50 <= "
+				<< stats.p50Ns << " ns, p99 <= " << stats.p99Ns << " ns\n";
+		}
+	}
+
+	context.Close();
+	NetHost::Shutdown();
+	return exitCode;
+}